@@ -27,17 +27,27 @@
 
 #include <array>
 #include <atomic>
+#include <bit>
+#include <chrono>
+#include <functional>
 #include <format>
 #include <map>
+#include <memory_resource>
 #include <mutex>
+#include <new>
 #include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <sstream>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include <UU/Assertions.h>
 #include <UU/BitBlock.h>
 #include <UU/MathLike.h>
-#include <UU/SmallVector.h>
+#include <UU/PageMap.h>
 #include <UU/Types.h>
 
 namespace UU {
@@ -65,6 +75,49 @@ struct Memory {
     Size capacity = 0;
 };
 
+// The allocator protocol ==========================================================================
+//
+// Every allocator has these members:
+//
+// Memory alloc(Size capacity)
+//     Returns a block of at least capacity bytes, or empty Memory if it cannot.
+// bool dealloc(Memory &mem)
+//     Frees mem if this allocator owns it, and returns whether it did.
+// void free(Memory &mem)
+//     Frees mem, which this allocator must own.
+// bool owns(const Memory &mem) const
+//     Returns whether mem came from this allocator.
+// bool expand(Memory &mem, Size delta)
+//     Grows mem by at least delta bytes without moving it, and returns whether it could.
+// bool reallocate(Memory &mem, Size capacity)
+//     Resizes mem to at least capacity bytes, moving it and its contents if need be, and 
+//     returns whether it could. mem is left as it was on failure.
+
+// Reallocates by allocating a new block from alloc, copying the contents, and freeing the old 
+// block. This is the fallback for allocators that cannot resize a block where it is.
+template <typename Alloc>
+bool reallocate_by_moving(Alloc &alloc, Memory &mem, Size capacity)
+{
+    if (capacity == mem.capacity) {
+        return true;
+    }
+    if (capacity == 0) {
+        alloc.dealloc(mem);
+        mem = Memory();
+        return true;
+    }
+    Memory fresh = alloc.alloc(capacity);
+    if (fresh.is_empty()) {
+        return false;
+    }
+    if (mem.not_empty()) {
+        memcpy(fresh.ptr, mem.ptr, std::min(mem.capacity, capacity));
+        alloc.dealloc(mem);
+    }
+    mem = fresh;
+    return true;
+}
+
 // NullAllocator ==================================================================================
 
 class NullAllocator
@@ -87,6 +140,9 @@ public:
     }
 
     bool owns(const Memory &mem) const { return mem.ptr == nullptr; }
+
+    bool expand(Memory &mem, Size delta) { return delta == 0; }
+    bool reallocate(Memory &mem, Size capacity) { return capacity == 0 && mem.is_empty(); }
 };
 
 // Freelist =======================================================================================
@@ -139,6 +195,18 @@ public:
         return ecap == Length || parent.owns(mem);
     }    
 
+    // every block on the list came from parent, so parent can resize any of them
+    bool expand(Memory &mem, Size delta) {
+        return delta == 0 || parent.expand(mem, delta);
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        if (align_up(capacity) == align_up(mem.capacity)) {
+            return true;
+        }
+        return reallocate_by_moving(*this, mem, capacity);
+    }
+
 private:
     struct Node { 
         Node *next = nullptr;
@@ -185,6 +253,25 @@ public:
 
     bool owns(const Memory &mem) const { return first.owns(mem) || second.owns(mem); }
 
+    bool expand(Memory &mem, Size delta) {
+        if (mem.capacity <= Threshold && first.owns(mem)) {
+            // growing past the threshold would leave the block on the wrong side for free()
+            return mem.capacity + delta <= Threshold && first.expand(mem, delta);
+        }
+        return second.expand(mem, delta);
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        bool in_first = mem.capacity <= Threshold && first.owns(mem);
+        if (in_first && capacity <= Threshold) {
+            return first.reallocate(mem, capacity);
+        }
+        if (!in_first && capacity > Threshold) {
+            return second.reallocate(mem, capacity);
+        }
+        return reallocate_by_moving(*this, mem, capacity);
+    }
+
 private:
     FirstAlloc first;
     SecondAlloc second;
@@ -222,6 +309,31 @@ public:
     }
 
     bool owns(const Memory &mem) const { return FirstAlloc::owns(mem) || SecondAlloc::owns(mem); }
+
+    bool expand(Memory &mem, Size delta) {
+        if (FirstAlloc::owns(mem)) {
+            return FirstAlloc::expand(mem, delta);
+        }
+        return SecondAlloc::expand(mem, delta);
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        if (FirstAlloc::owns(mem)) {
+            if (FirstAlloc::reallocate(mem, capacity)) {
+                return true;
+            }
+            // move the block to the second allocator
+            Memory fresh = SecondAlloc::alloc(capacity);
+            if (fresh.is_empty()) {
+                return false;
+            }
+            memcpy(fresh.ptr, mem.ptr, std::min(mem.capacity, capacity));
+            FirstAlloc::free(mem);
+            mem = fresh;
+            return true;
+        }
+        return SecondAlloc::reallocate(mem, capacity);
+    }
 };
 
 // StackAllocator =================================================================================
@@ -270,6 +382,32 @@ public:
         return mem.ptr >= base() && mem.ptr < base() + Count; 
     }    
 
+    // only the most recent block can change size in place
+    bool expand(Memory &mem, Size delta) {
+        if (delta == 0) {
+            return true;
+        }
+        Byte *mem_end = byte_ptr(mem.ptr) + align_up(mem.capacity);
+        Size edelta = align_up(delta);
+        if (ptr != mem_end || edelta > remaining()) {
+            return false;
+        }
+        ptr += edelta;
+        mem.capacity = align_up(mem.capacity) + edelta;
+        return true;
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        Byte *mem_ptr = byte_ptr(mem.ptr);
+        Size ecap = std::max(align_up(capacity), EChunk);
+        if (mem.not_empty() && ptr == mem_ptr + align_up(mem.capacity) && ecap <= Size(base() + Count - mem_ptr)) {
+            ptr = mem_ptr + ecap;
+            mem.capacity = ecap;
+            return true;
+        }
+        return reallocate_by_moving(*this, mem, capacity);
+    }
+
 private:
     UU_ALWAYS_INLINE 
     Byte *base() const { return reinterpret_cast<Byte *>(const_cast<Byte *>(bytes)); }
@@ -281,31 +419,44 @@ private:
     Byte *ptr;
 };
 
-// StatsAllocator =================================================================================
+// ArenaAllocator =================================================================================
 
-template <typename Alloc>
-class StatsAllocator : private Alloc
+// Bump allocates from a chain of page-aligned chunks and grows by adding chunks, so unlike
+// StackAllocator, it never runs out. Freeing the most recent allocation gives its space back,
+// and freeing anything else does nothing: the space comes back all at once, with rewind() to
+// a mark() taken earlier, or with free_all().
+//
+// Chunks are registered in the PageMap, so owns() is a single lookup.
+//
+class ArenaAllocator
 {
 public:
-    using Elapsed = std::chrono::duration<double>;
+    static constexpr Size DefaultChunkSize = 64 * 1024;
+
+    struct Mark {
+        const void *chunk = nullptr;
+        Byte *ptr = nullptr;
+    };
+
+    explicit ArenaAllocator(Size chunk_size = DefaultChunkSize) : 
+        m_chunk_size(PageMap::round_up_to_page_size(std::max(chunk_size, PageMap::PageSize))) {}
+
+    ArenaAllocator(const ArenaAllocator &) = delete;
+    ArenaAllocator &operator=(const ArenaAllocator &) = delete;
+
+    ~ArenaAllocator() { 
+        free_all(); 
+    }
 
     Memory alloc(Size capacity) {
-        auto mark = std::chrono::steady_clock::now();
-        Memory mem = Alloc::alloc(capacity);
-        auto done = std::chrono::steady_clock::now();
-        Elapsed elapsed = done - mark;
-        time_in_seconds += elapsed;
-        allocs++;
-        bytes_allocated += mem.capacity;
-        bytes_allocated_now += mem.capacity;
-        bytes_allocated_highwater = std::max(bytes_allocated_highwater, bytes_allocated_now);
-        auto sizes_it = sizes.find(capacity);
-        if (sizes_it == sizes.end()) {
-            sizes.emplace(capacity, 1);
-        }
-        else {
-            sizes_it->second++;
+        Size ecap = align_up(std::max(capacity, Size(1)));
+        if (UNLIKELY(m_chunk == nullptr || ecap > Size(m_end - m_ptr))) {
+            if (!add_chunk(ecap)) {
+                return Memory();
+            }
         }
+        Memory mem(m_ptr, ecap);
+        m_ptr += ecap;
         return mem;
     }
 
@@ -318,172 +469,281 @@ public:
     }
 
     void free(Memory &mem) {
-        if (!owns(mem)) {
-            return;
+        Byte *mem_ptr = byte_ptr(mem.ptr);
+        if (m_ptr == mem_ptr + align_up(mem.capacity)) {
+            m_ptr = mem_ptr;
         }
-        deallocs++;
-        bytes_deallocated += mem.capacity;
-        bytes_allocated_now -= mem.capacity;
-        Alloc::free(mem);
     }
 
-    bool owns(const Memory &mem) const { return Alloc::owns(mem); }    
+    bool owns(const Memory &mem) const {
+        return mem.ptr != nullptr && PageMap::get(mem.ptr) == this;
+    }
 
-    std::string stats() const {
-        // Size num_digits = number_of_digits(bytes_allocated);
-        // std::string num_fmt = "{0:" + integer_to_string(num_digits) + "}";
-        // std::string result;
-        // std::string allocs_fmt =                    std::format("allocs:                    {0}\n", num_fmt);
-        // std::string deallocs_fmt =                  std::format("deallocs:                  {0}\n", num_fmt);
-        // std::string bytes_allocated_fmt =           std::format("bytes allocated:           {0}\n", num_fmt);
-        // std::string bytes_deallocated_fmt =         std::format("bytes deallocated:         {0}\n", num_fmt);
-        // std::string bytes_allocated_now_fmt =       std::format("bytes allocated now:       {0}\n", num_fmt);
-        // std::string bytes_allocated_highwater_fmt = std::format("bytes allocated highwater: {0}\n", num_fmt);
-        // result += "============================================================\n";
-        // result += "Allocator stats\n";
-        // result += "------------------------------------------------------------\n";
-        // result += std::vformat(allocs_fmt, std::make_format_args(integer_to_string<Size>(allocs)));
-        // result += std::vformat(deallocs_fmt, std::make_format_args(integer_to_string<Size>(deallocs)));
-        // result += std::vformat(bytes_allocated_fmt, std::make_format_args(integer_to_string<Size>(bytes_allocated)));
-        // result += std::vformat(bytes_deallocated_fmt, std::make_format_args(integer_to_string<Size>(bytes_deallocated)));
-        // result += std::vformat(bytes_allocated_now_fmt, std::make_format_args(integer_to_string<Size>(bytes_allocated_now)));
-        // result += std::vformat(bytes_allocated_highwater_fmt, std::make_format_args(integer_to_string<Size>(bytes_allocated_highwater)));
-        // return result;
-        std::stringstream result;
-        result << "============================================================\n";
-        result << "Allocator stats\n";
-        result << "------------------------------------------------------------\n";
-        result << "time in seconds:           " << time_in_seconds.count() << std::endl;
-        result << "allocs:                    " << allocs << std::endl;
-        result << "deallocs:                  " << deallocs << std::endl;
-        result << "outstanding blocks:        " << (allocs - deallocs) << std::endl;
-        result << "bytes allocated:           " << bytes_allocated << std::endl;
-        result << "bytes deallocated:         " << bytes_deallocated << std::endl;
-        result << "bytes allocated now:       " << bytes_allocated_now << std::endl;
-        result << "bytes allocated highwater: " << bytes_allocated_highwater << std::endl;
-        result << "sizes: " << std::endl;
-        for (auto &s : sizes) {
-            result << "   " << s.first << " : " << s.second << std::endl;
+    // only the most recent block can change size in place
+    bool expand(Memory &mem, Size delta) {
+        if (delta == 0) {
+            return true;
         }
-        return result.str();
-    }    
+        Byte *mem_end = byte_ptr(mem.ptr) + align_up(mem.capacity);
+        Size edelta = align_up(delta);
+        if (m_ptr != mem_end || edelta > Size(m_end - m_ptr)) {
+            return false;
+        }
+        m_ptr += edelta;
+        mem.capacity = align_up(mem.capacity) + edelta;
+        return true;
+    }
 
-private:
-    Elapsed time_in_seconds = Elapsed(0);
-    Size allocs = 0;
-    Size deallocs = 0;
-    Size bytes_allocated = 0;
-    Size bytes_deallocated = 0;
-    Size bytes_allocated_now = 0;
-    Size bytes_allocated_highwater = 0;
-    std::map<Size, Size> sizes;
-};
+    bool reallocate(Memory &mem, Size capacity) {
+        Byte *mem_ptr = byte_ptr(mem.ptr);
+        Size ecap = align_up(std::max(capacity, Size(1)));
+        if (mem.not_empty() && m_ptr == mem_ptr + align_up(mem.capacity) && ecap <= Size(m_end - mem_ptr)) {
+            m_ptr = mem_ptr + ecap;
+            mem.capacity = ecap;
+            return true;
+        }
+        return reallocate_by_moving(*this, mem, capacity);
+    }
 
-// Mallocator =====================================================================================
+    Mark mark() const { 
+        return { m_chunk, m_ptr }; 
+    }
 
-class Mallocator
-{
-public:
-    Memory alloc(Size capacity) {
-        Memory mem = Memory(malloc(capacity), capacity);
-        LOG(Memory, "Mallocator alloc: %lu : %p", mem.capacity, mem.ptr);
-        return mem;
+    // Frees everything allocated since mark was taken.
+    void rewind(const Mark &mark) {
+        while (m_chunk && m_chunk != mark.chunk) {
+            release_chunk();
+        }
+        if (m_chunk) {
+            m_ptr = mark.ptr;
+        }
     }
 
-    bool dealloc(Memory &mem) {
-        free(mem);
+    void free_all() { 
+        rewind(Mark()); 
+    }
+
+    // The total size of the chunks this arena holds now.
+    Size bytes_reserved() const { 
+        return m_reserved; 
+    }
+
+private:
+    struct Chunk {
+        Chunk *prev;
+        Size length;
+    };
+
+    static constexpr Size HeaderSize = align_up(sizeof(Chunk));
+
+    bool add_chunk(Size ecap) {
+        Size length = std::max(m_chunk_size, PageMap::round_up_to_page_size(ecap + HeaderSize));
+        void *ptr = aligned_alloc(PageMap::PageSize, length);
+        if (ptr == nullptr) {
+            return false;
+        }
+        LOG(Memory, "ArenaAllocator add chunk: %lu : %p", length, ptr);
+        PageMap::set(ptr, length, this);
+        Chunk *chunk = static_cast<Chunk *>(ptr);
+        chunk->prev = m_chunk;
+        chunk->length = length;
+        m_chunk = chunk;
+        m_ptr = byte_ptr(ptr) + HeaderSize;
+        m_end = byte_ptr(ptr) + length;
+        m_reserved += length;
         return true;
     }
 
-    void free(Memory &mem) {
-        LOG(Memory, "Mallocator free: %lu : %p", mem.capacity, mem.ptr);
-        ::free(mem.ptr);
+    void release_chunk() {
+        Chunk *chunk = m_chunk;
+        Chunk *prev = chunk->prev;
+        LOG(Memory, "ArenaAllocator release chunk: %lu : %p", chunk->length, chunk);
+        PageMap::clear(chunk, chunk->length);
+        m_reserved -= chunk->length;
+        ::free(chunk);
+        m_chunk = prev;
+        if (prev) {
+            // rewind() sets m_ptr to the mark, if there is one, so this is just the limit
+            m_ptr = byte_ptr(prev) + prev->length;
+            m_end = byte_ptr(prev) + prev->length;
+        }
+        else {
+            m_ptr = nullptr;
+            m_end = nullptr;
+        }
     }
 
-    bool owns(const Memory &mem) const { return true; }
+    Chunk *m_chunk = nullptr;
+    Byte *m_ptr = nullptr;
+    Byte *m_end = nullptr;
+    Size m_chunk_size;
+    Size m_reserved = 0;
 };
 
-// MemoryBlock ====================================================================================
+// ThreadSlots ====================================================================================
 
-template <Size Capacity, Size Count> requires IsMutipleOf64<Count>
-struct MemoryBlock {
-    constexpr MemoryBlock() {}
-    
-    UU_ALWAYS_INLINE constexpr bool is_empty() const { return bits.is_empty(); }
-    UU_ALWAYS_INLINE constexpr bool not_empty() const { return !is_empty(); }
-    UU_ALWAYS_INLINE constexpr bool is_full() const { return bits.is_full(); }
-    UU_ALWAYS_INLINE constexpr bool not_full() const { return !is_full(); }
+// Hands out small, dense, per-thread indexes, so allocators can keep per-thread state in
+// plain arrays rather than in thread_local objects of their own. A thread claims a slot the
+// first time it asks for one and gives it back when it exits. Once all slots are taken,
+// or after the calling thread has started to exit, slot() returns NoSlot.
+//
+// Exit hooks run on a thread that holds a slot as it exits, before the slot is given back,
+// so allocators can return whatever they kept for it. slot() still works in a hook.
+class ThreadSlots
+{
+public:
+    static constexpr Size MaxSlots = 64;
+    static constexpr Size NoSlot = SizeMax;
 
-    constexpr Memory take() {
-        if (UNLIKELY(base == nullptr)) {
-            base = malloc(Capacity * Count);
-            extent = byte_ptr(base) + (Capacity * Count);
-        }
-        ASSERT(not_full());
-        UInt32 idx = bits.peek();
-        bits.set(idx);
-        // LOG(Memory, "MemoryBlock take: %d of %d : %lu", idx, Count, Capacity);
-        return { byte_ptr(base) + (idx * Capacity), Capacity };
+    using ExitHook = void (*)(void *context);
+
+    static void add_exit_hook(ExitHook hook, void *context) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.hooks.push_back({ hook, context });
     }
 
-    constexpr void put(const Memory &mem) { 
-        Size idx = (byte_ptr(mem.ptr) - byte_ptr(base)) / Capacity;
-        // LOG(Memory, "MemoryBlock put: %d", idx);
-        ASSERT(idx < Count);
-        bits.clear(idx);
+    // Once this returns, the hook is not running and won't run again.
+    static void remove_exit_hook(ExitHook hook, void *context) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::erase_if(r.hooks, [hook, context](const Hook &h) { return h.hook == hook && h.context == context; });
     }
 
-    constexpr void reset() { 
-        bits.reset();
+    static Size slot() {
+        Size s = t_slot;
+        if (LIKELY(s < MaxSlots)) {
+            return s;
+        }
+        if (s == Unclaimed) {
+            s = claim();
+        }
+        return s < MaxSlots ? s : NoSlot;
     }
 
-    constexpr void release() { 
-        // LOG(Memory, "MemoryBlock free: %p", base);
-        free(base);
-        base = nullptr;
-        extent = nullptr;
+private:
+    static constexpr Size Unclaimed = SizeMax - 1;
+
+    struct Hook {
+        ExitHook hook;
+        void *context;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        UInt64 used = 0;
+        std::vector<Hook> hooks;
+    };
+
+    // Returns the slot when the thread exits. This is separate from t_slot, which is trivially
+    // destructible, so allocations made during thread or process teardown stay well-defined.
+    struct Releaser {
+        ~Releaser() {
+            if (t_slot < MaxSlots) {
+                Registry &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                for (const Hook &h : r.hooks) {
+                    h.hook(h.context);
+                }
+                r.used &= ~(UInt64(1) << t_slot);
+            }
+            t_slot = NoSlot;
+        }
+    };
+
+    static Registry &registry() {
+        static Registry *r = new Registry;  // never destroyed
+        return *r;
     }
-    
-    bool contains(const Memory &mem) const {
-        return mem.ptr >= base && mem.ptr < extent;
-    }    
 
-    void *base = nullptr;
-    void *extent = nullptr;
-    BitBlock<Count / BitBlockBitsPerSubBlock> bits;
+    static Size claim() {
+        Registry &r = registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            if (r.used == UInt64Max) {
+                t_slot = NoSlot;
+                return NoSlot;
+            }
+            t_slot = std::countr_one(r.used);
+            r.used |= UInt64(1) << t_slot;
+        }
+        thread_local Releaser releaser;
+        return t_slot;
+    }
+
+    static inline thread_local Size t_slot = Unclaimed;
 };
 
-// BlockAllocator =================================================================================
+// StatsAllocator =================================================================================
 
-template <Size Count, Size LoFit, Size HiFit = LoFit, bool ChecksFit = false> requires 
-    IsMutipleOf64<Count> && IsLessThanOrEqual<LoFit, HiFit>
-class BlockAllocator
+// Counts what goes through Alloc, cheaply enough to leave on in production. Each ThreadSlots
+// slot has its own shard of counters, written only by the thread that holds the slot, so
+// counting takes plain relaxed loads and stores rather than locked read-modify-writes. Threads
+// without a slot share one overflow shard, which uses fetch_add. Request sizes go into a fixed
+// log2 histogram. When SampleInterval is nonzero, one alloc in SampleInterval per shard is
+// timed, and the time for all allocs is estimated from the sample; zero turns timing off.
+//
+// snapshot() and stats() may be called from any thread while others allocate. Each counter in
+// a snapshot is exact as of some moment during the call, but the counters are not read at the
+// same instant. The highwater mark is tracked in batches, so it may lag by up to
+// HighwaterBatch bytes per shard. StatsAllocator is as thread-safe as Alloc.
+//
+template <typename Alloc, Size SampleInterval = 64>
+class StatsAllocator : private Alloc
 {
 public:
-    using Block = MemoryBlock<HiFit, Count>;
+    static constexpr Size Shards = ThreadSlots::MaxSlots + 1;
+    static constexpr Size HistogramBuckets = 65;
+    static constexpr Int64 HighwaterBatch = 64 * 1024;
 
-    constexpr BlockAllocator() {}
+    using Elapsed = std::chrono::duration<double>;
 
-    constexpr bool fits(Size capacity) const { return capacity >= LoFit && capacity <= HiFit; }
+    struct Snapshot {
+        Size allocs = 0;
+        Size deallocs = 0;
+        Size expands = 0;
+        Size reallocs = 0;
+        Size bytes_allocated = 0;
+        Size bytes_deallocated = 0;
+        Size bytes_allocated_now = 0;
+        Size bytes_allocated_highwater = 0;
+        Size timed_allocs = 0;
+        Elapsed time_in_seconds = Elapsed(0);
+
+        // sizes[b] counts requests whose size needs b bits: [2^(b-1), 2^b), and sizes[0] counts zero
+        std::array<Size, HistogramBuckets> sizes = {};
+
+        Size outstanding_blocks() const { return allocs - deallocs; }
+    };
+
+    StatsAllocator() {
+        m_shards[Shards - 1].shared = true;
+    }
+    StatsAllocator(const StatsAllocator &) = delete;
+    StatsAllocator &operator=(const StatsAllocator &) = delete;
 
     Memory alloc(Size capacity) {
-        Size ecap = align_up(capacity);
+        Shard &shard = this_shard();
+        Size count = add(shard, shard.allocs, 1);
+        add(shard, shard.sizes[std::bit_width(capacity)], 1);
         Memory mem;
-        bool test_fit = true;
-        if constexpr (ChecksFit) {
-            test_fit = fits(ecap);
+        if (SampleInterval != 0 && count % SampleInterval == 0) {
+            auto mark = std::chrono::steady_clock::now();
+            mem = Alloc::alloc(capacity);
+            auto done = std::chrono::steady_clock::now();
+            UInt64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(done - mark).count();
+            add(shard, shard.timed_ns, ns);
+            add(shard, shard.timed_allocs, 1);
         }
-        if (test_fit && m_block.not_full()) {
-            ASSERT_WITH_MESSAGE(fits(ecap), "must fit in %lu - %lu ; got %lu", LoFit, HiFit, capacity);
-            mem = m_block.take();
-            LOG(Memory, "BlockAllocator alloc: %lu (%lu - %lu) : %p (%d => %p)", mem.capacity, LoFit, HiFit, mem.ptr, pthread_main_np(), pthread_self());
+        else {
+            mem = Alloc::alloc(capacity);
         }
+        count_bytes(shard, 0, mem.capacity);
         return mem;
     }
 
     bool dealloc(Memory &mem) {
         if (!owns(mem)) {
-            LOG(Memory, "BlockAllocator doesn't own: %lu (%lu - %lu) : %p (%d => %p)", mem.capacity, LoFit, HiFit, mem.ptr, pthread_main_np(), pthread_self());
             return false;
         }
         free(mem);
@@ -491,40 +751,763 @@ public:
     }
 
     void free(Memory &mem) {
-        LOG(Memory, "BlockAllocator free: %lu (%lu - %lu) : %p (%d => %p)", mem.capacity, LoFit, HiFit, mem.ptr, pthread_main_np(), pthread_self());
-        m_block.put(mem);
+        if (!owns(mem)) {
+            return;
+        }
+        Shard &shard = this_shard();
+        add(shard, shard.deallocs, 1);
+        count_bytes(shard, mem.capacity, 0);
+        Alloc::free(mem);
     }
 
-    void free_all() {
-        m_block.reset();
-        m_block.release();
+    bool owns(const Memory &mem) const { return Alloc::owns(mem); }    
+
+    bool expand(Memory &mem, Size delta) {
+        Size old_capacity = mem.capacity;
+        if (!Alloc::expand(mem, delta)) {
+            return false;
+        }
+        Shard &shard = this_shard();
+        add(shard, shard.expands, 1);
+        count_bytes(shard, old_capacity, mem.capacity);
+        return true;
     }
 
-    bool owns(const Memory &mem) const { 
-        return m_block.contains(mem);
-    }    
+    bool reallocate(Memory &mem, Size capacity) {
+        Size old_capacity = mem.capacity;
+        if (!Alloc::reallocate(mem, capacity)) {
+            return false;
+        }
+        Shard &shard = this_shard();
+        add(shard, shard.reallocs, 1);
+        count_bytes(shard, old_capacity, mem.capacity);
+        return true;
+    }
 
-    bool is_empty() const {
-        return m_block.is_empty();
+    Snapshot snapshot() const {
+        Snapshot result;
+        UInt64 timed_ns = 0;
+        for (const Shard &shard : m_shards) {
+            result.allocs += shard.allocs.load(std::memory_order_relaxed);
+            result.deallocs += shard.deallocs.load(std::memory_order_relaxed);
+            result.expands += shard.expands.load(std::memory_order_relaxed);
+            result.reallocs += shard.reallocs.load(std::memory_order_relaxed);
+            result.bytes_allocated += shard.bytes_allocated.load(std::memory_order_relaxed);
+            result.bytes_deallocated += shard.bytes_deallocated.load(std::memory_order_relaxed);
+            result.timed_allocs += shard.timed_allocs.load(std::memory_order_relaxed);
+            timed_ns += shard.timed_ns.load(std::memory_order_relaxed);
+            for (Size b = 0; b < HistogramBuckets; b++) {
+                result.sizes[b] += shard.sizes[b].load(std::memory_order_relaxed);
+            }
+        }
+        // shards are read one after another, so frees may be seen without their allocs
+        if (result.bytes_allocated > result.bytes_deallocated) {
+            result.bytes_allocated_now = result.bytes_allocated - result.bytes_deallocated;
+        }
+        result.bytes_allocated_highwater = std::max<Size>(m_highwater.load(std::memory_order_relaxed), 
+            result.bytes_allocated_now);
+        if (result.timed_allocs > 0) {
+            double per_alloc = double(timed_ns) / double(result.timed_allocs);
+            result.time_in_seconds = Elapsed(per_alloc * double(result.allocs) / 1e9);
+        }
+        return result;
     }
 
+    std::string stats() const {
+        Snapshot s = snapshot();
+        std::stringstream result;
+        result << "============================================================\n";
+        result << "Allocator stats\n";
+        result << "------------------------------------------------------------\n";
+        result << "time in seconds:           " << s.time_in_seconds.count() << std::endl;
+        result << "timed allocs:              " << s.timed_allocs << std::endl;
+        result << "allocs:                    " << s.allocs << std::endl;
+        result << "deallocs:                  " << s.deallocs << std::endl;
+        result << "expands:                   " << s.expands << std::endl;
+        result << "reallocs:                  " << s.reallocs << std::endl;
+        result << "outstanding blocks:        " << s.outstanding_blocks() << std::endl;
+        result << "bytes allocated:           " << s.bytes_allocated << std::endl;
+        result << "bytes deallocated:         " << s.bytes_deallocated << std::endl;
+        result << "bytes allocated now:       " << s.bytes_allocated_now << std::endl;
+        result << "bytes allocated highwater: " << s.bytes_allocated_highwater << std::endl;
+        result << "sizes: " << std::endl;
+        for (Size b = 0; b < HistogramBuckets; b++) {
+            if (s.sizes[b] == 0) {
+                continue;
+            }
+            Size lo = b == 0 ? 0 : Size(1) << (b - 1);
+            Size hi = b == 0 ? 0 : lo + (lo - 1);
+            result << "   " << lo << " - " << hi << " : " << s.sizes[b] << std::endl;
+        }
+        return result.str();
+    }    
+
 private:
-    Block m_block;
-};
+    struct alignas(64) Shard {
+        std::atomic<Size> allocs = 0;
+        std::atomic<Size> deallocs = 0;
+        std::atomic<Size> expands = 0;
+        std::atomic<Size> reallocs = 0;
+        std::atomic<Size> bytes_allocated = 0;
+        std::atomic<Size> bytes_deallocated = 0;
+        std::atomic<Size> timed_allocs = 0;
+        std::atomic<UInt64> timed_ns = 0;
+        std::atomic<Int64> pending_bytes = 0;
+        std::atomic<Size> sizes[HistogramBuckets] = {};
+        bool shared = false;
+    };
 
-// CascadingAllocator =============================================================================
+    UU_ALWAYS_INLINE Shard &this_shard() {
+        Size slot = ThreadSlots::slot();
+        return m_shards[slot == ThreadSlots::NoSlot ? Shards - 1 : slot];
+    }
 
-template <typename Alloc, Size MaxCount = 256> requires IsGreaterThanOne<MaxCount>
-class CascadingAllocator
-{
-public:
-    constexpr CascadingAllocator() {
-        for (Size idx = 0; idx < MaxCount; idx++) {
-            m_allocators[idx] = Alloc();
+    // Adds n to a counter in shard and returns the old value.
+    template <typename T>
+    UU_ALWAYS_INLINE static T add(Shard &shard, std::atomic<T> &counter, std::type_identity_t<T> n) {
+        if (UNLIKELY(shard.shared)) {
+            return counter.fetch_add(n, std::memory_order_relaxed);
         }
+        T value = counter.load(std::memory_order_relaxed);
+        counter.store(value + n, std::memory_order_relaxed);
+        return value;
     }
 
-    Memory alloc(Size capacity) {
+    void count_bytes(Shard &shard, Size old_capacity, Size new_capacity) {
+        Int64 delta = 0;
+        if (new_capacity > old_capacity) {
+            add(shard, shard.bytes_allocated, new_capacity - old_capacity);
+            delta = Int64(new_capacity - old_capacity);
+        }
+        else if (new_capacity < old_capacity) {
+            add(shard, shard.bytes_deallocated, old_capacity - new_capacity);
+            delta = -Int64(old_capacity - new_capacity);
+        }
+        // Live bytes reach the shared total in batches, which keeps the shared cache line
+        // out of the common path.
+        Int64 pending = add(shard, shard.pending_bytes, delta) + delta;
+        if (UNLIKELY(pending >= HighwaterBatch || pending <= -HighwaterBatch)) {
+            pending = shard.pending_bytes.exchange(0, std::memory_order_relaxed);
+            Int64 live = m_live_bytes.fetch_add(pending, std::memory_order_relaxed) + pending;
+            Size highwater = m_highwater.load(std::memory_order_relaxed);
+            while (live > 0 && Size(live) > highwater && 
+                !m_highwater.compare_exchange_weak(highwater, Size(live), std::memory_order_relaxed)) {}
+        }
+    }
+
+    Shard m_shards[Shards];
+    alignas(64) std::atomic<Int64> m_live_bytes = 0;
+    std::atomic<Size> m_highwater = 0;
+};
+
+// Mallocator =====================================================================================
+
+class Mallocator
+{
+public:
+    Memory alloc(Size capacity) {
+        Memory mem = Memory(malloc(capacity), capacity);
+        LOG(Memory, "Mallocator alloc: %lu : %p", mem.capacity, mem.ptr);
+        return mem;
+    }
+
+    bool dealloc(Memory &mem) {
+        free(mem);
+        return true;
+    }
+
+    void free(Memory &mem) {
+        LOG(Memory, "Mallocator free: %lu : %p", mem.capacity, mem.ptr);
+        ::free(mem.ptr);
+    }
+
+    // malloc can't say whether it made a block, but every other allocator here that hands 
+    // out blocks it doesn't keep inside itself registers their pages in the PageMap, so a 
+    // block on an unregistered page came from malloc. dealloc() doesn't check.
+    bool owns(const Memory &mem) const { return PageMap::get(mem.ptr) == nullptr; }
+
+    // malloc has no portable way to grow a block in place; realloc, below, may still manage it
+    bool expand(Memory &mem, Size delta) { return delta == 0; }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        if (capacity == 0) {
+            free(mem);
+            mem = Memory();
+            return true;
+        }
+        void *ptr = realloc(mem.ptr, capacity);
+        if (ptr == nullptr) {
+            return false;
+        }
+        LOG(Memory, "Mallocator realloc: %lu => %lu : %p => %p", mem.capacity, capacity, mem.ptr, ptr);
+        mem = Memory(ptr, capacity);
+        return true;
+    }
+
+    // any Mallocator can free what another allocated
+    constexpr bool operator==(const Mallocator &) const = default;
+};
+
+// MmapAllocator ==================================================================================
+
+// Maps large blocks straight from the kernel, in whole pages. Recently freed regions are kept
+// in a small cache, bucketed by the log2 of their page count, so a program that keeps
+// allocating and freeing big buffers, like whole-file contents, doesn't pay for a fresh mapping
+// and its page faults every time. Regions of HugePageSize or more are aligned to it and
+// advised with MADV_HUGEPAGE where the system has it.
+//
+// Regions are registered in the PageMap while they are mapped, so owns() is a single lookup.
+// A block must be freed with the capacity that alloc, expand, or reallocate last gave it. 
+// The cache is locked, so one MmapAllocator may be shared by many threads.
+//
+class MmapAllocator
+{
+public:
+    static constexpr Size HugePageSize = 2 * 1024 * 1024;
+    static constexpr Size BucketCount = 40;
+    static constexpr Size CacheSlots = 4;
+    static constexpr Size DefaultMaxCachedBytes = 64 * 1024 * 1024;
+
+    explicit MmapAllocator(Size max_cached_bytes = DefaultMaxCachedBytes) : 
+        m_max_cached_bytes(max_cached_bytes) {}
+
+    MmapAllocator(const MmapAllocator &) = delete;
+    MmapAllocator &operator=(const MmapAllocator &) = delete;
+
+    ~MmapAllocator() {
+        purge();
+    }
+
+    Memory alloc(Size capacity) {
+        Size length = round_up_to_page_size(capacity);
+        Memory mem = take_cached(length);
+        if (mem.is_empty()) {
+            mem = map(length);
+            if (mem.not_empty()) {
+                PageMap::set(mem.ptr, mem.capacity, this);
+            }
+        }
+        LOG(Memory, "MmapAllocator alloc: %lu : %p", mem.capacity, mem.ptr);
+        return mem;
+    }
+
+    bool dealloc(Memory &mem) {
+        free(mem);
+        return true;
+    }
+
+    void free(Memory &mem) {
+        if (mem.is_empty()) {
+            return;
+        }
+        LOG(Memory, "MmapAllocator free: %lu : %p", mem.capacity, mem.ptr);
+        Size length = round_up_to_page_size(mem.capacity);
+        if (!put_cached(mem.ptr, length)) {
+            unmap(mem.ptr, length);
+        }
+    }
+
+    bool owns(const Memory &mem) const { 
+        return mem.ptr != nullptr && PageMap::get(mem.ptr) == this; 
+    }
+
+    // A block can use the rest of its last page, and on Linux, grow in place with mremap.
+    bool expand(Memory &mem, Size delta) {
+        if (delta == 0) {
+            return true;
+        }
+        Size length = round_up_to_page_size(mem.capacity);
+        Size new_length = round_up_to_page_size(mem.capacity + delta);
+        if (new_length == length) {
+            mem.capacity = length;
+            return true;
+        }
+#if OS(LINUX)
+        if (mremap(mem.ptr, length, new_length, 0) != MAP_FAILED) {
+            PageMap::set(byte_ptr(mem.ptr) + length, new_length - length, this);
+            mem.capacity = new_length;
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    // Shrinking unmaps the tail. Growing remaps without copying on Linux, and moves elsewhere.
+    bool reallocate(Memory &mem, Size capacity) {
+        if (mem.is_empty()) {
+            mem = alloc(capacity);
+            return mem.not_empty();
+        }
+        Size length = round_up_to_page_size(mem.capacity);
+        Size new_length = round_up_to_page_size(capacity);
+        if (new_length <= length) {
+            if (new_length < length) {
+                unmap(byte_ptr(mem.ptr) + new_length, length - new_length);
+            }
+            mem.capacity = new_length;
+            return true;
+        }
+#if OS(LINUX)
+        // clear first: once mremap moves the region, another thread may map the old pages
+        // and register them, and a late clear would wipe that out
+        PageMap::clear(mem.ptr, length);
+        void *ptr = mremap(mem.ptr, length, new_length, MREMAP_MAYMOVE);
+        if (ptr == MAP_FAILED) {
+            PageMap::set(mem.ptr, length, this);
+            return false;
+        }
+        PageMap::set(ptr, new_length, this);
+        advise(ptr, new_length);
+        mem = Memory(ptr, new_length);
+        return true;
+#else
+        return reallocate_by_moving(*this, mem, capacity);
+#endif
+    }
+
+    // Unmaps every cached region.
+    void purge() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Size b = 0; b < BucketCount; b++) {
+            for (Size idx = 0; idx < m_counts[b]; idx++) {
+                unmap(m_cache[b][idx].ptr, m_cache[b][idx].length);
+            }
+            m_counts[b] = 0;
+        }
+        m_cached_bytes = 0;
+    }
+
+    Size cached_bytes() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cached_bytes;
+    }
+
+    static Size page_size() {
+        static const Size size = static_cast<Size>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    static Size round_up_to_page_size(Size length) {
+        Size page = page_size();
+        return (std::max(length, Size(1)) + page - 1) & ~(page - 1);
+    }
+
+private:
+    struct Region {
+        void *ptr;
+        Size length;
+    };
+
+    // regions in bucket b are [2^b, 2^(b+1)) pages long
+    static Size bucket(Size length) {
+        return std::min<Size>(std::bit_width(length / page_size()) - 1, BucketCount - 1);
+    }
+
+    static void advise(void *ptr, Size length) {
+#if defined(MADV_HUGEPAGE)
+        if (length >= HugePageSize) {
+            madvise(ptr, length, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    static void unmap(void *ptr, Size length) {
+        PageMap::clear(ptr, length);
+        munmap(ptr, length);
+    }
+
+    static Memory map(Size length) {
+        if (length < HugePageSize) {
+            void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+            return ptr == MAP_FAILED ? Memory() : Memory(ptr, length);
+        }
+        // map extra, then trim, so the region starts on a huge page boundary
+        Size padded = length + HugePageSize;
+        void *ptr = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return Memory();
+        }
+        Byte *start = byte_ptr(ptr);
+        Byte *aligned = reinterpret_cast<Byte *>((reinterpret_cast<uintptr_t>(start) + HugePageSize - 1) & ~(HugePageSize - 1));
+        if (aligned > start) {
+            munmap(start, aligned - start);
+        }
+        Size tail = padded - (aligned - start) - length;
+        if (tail > 0) {
+            munmap(aligned + length, tail);
+        }
+        advise(aligned, length);
+        return Memory(aligned, length);
+    }
+
+    // Takes the most recently cached region in length's bucket that is at least length long.
+    Memory take_cached(Size length) {
+        Size b = bucket(length);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Size idx = m_counts[b]; idx > 0; idx--) {
+            Region region = m_cache[b][idx - 1];
+            if (region.length >= length) {
+                for (Size j = idx; j < m_counts[b]; j++) {
+                    m_cache[b][j - 1] = m_cache[b][j];
+                }
+                m_counts[b]--;
+                m_cached_bytes -= region.length;
+                return Memory(region.ptr, region.length);
+            }
+        }
+        return Memory();
+    }
+
+    // Caches a region, dropping the oldest in its bucket if the bucket is full. Returns false
+    // if the region is too big to keep, so the caller should unmap it.
+    bool put_cached(void *ptr, Size length) {
+        Size b = bucket(length);
+        Region evicted = { nullptr, 0 };
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (length > m_max_cached_bytes - std::min(m_cached_bytes, m_max_cached_bytes)) {
+                return false;
+            }
+            if (m_counts[b] == CacheSlots) {
+                evicted = m_cache[b][0];
+                for (Size j = 1; j < CacheSlots; j++) {
+                    m_cache[b][j - 1] = m_cache[b][j];
+                }
+                m_counts[b]--;
+                m_cached_bytes -= evicted.length;
+            }
+            m_cache[b][m_counts[b]] = { ptr, length };
+            m_counts[b]++;
+            m_cached_bytes += length;
+        }
+        if (evicted.ptr) {
+            unmap(evicted.ptr, evicted.length);
+        }
+        return true;
+    }
+
+    mutable std::mutex m_mutex;
+    Region m_cache[BucketCount][CacheSlots] = {};
+    Size m_counts[BucketCount] = {};
+    Size m_cached_bytes = 0;
+    Size m_max_cached_bytes;
+};
+
+// MemoryBlock ====================================================================================
+
+template <Size Capacity, Size Count> requires IsMutipleOf64<Count>
+struct MemoryBlock {
+    // Blocks are page-aligned and a whole number of pages, so they can be registered in the PageMap.
+    static constexpr Size Length = PageMap::round_up_to_page_size(Capacity * Count);
+
+    constexpr MemoryBlock() {}
+    
+    UU_ALWAYS_INLINE constexpr bool is_empty() const { return bits.is_empty(); }
+    UU_ALWAYS_INLINE constexpr bool not_empty() const { return !is_empty(); }
+    UU_ALWAYS_INLINE constexpr bool is_full() const { return bits.is_full(); }
+    UU_ALWAYS_INLINE constexpr bool not_full() const { return !is_full(); }
+
+    constexpr Memory take() {
+        if (UNLIKELY(base == nullptr)) {
+            base = aligned_alloc(PageMap::PageSize, Length);
+            extent = byte_ptr(base) + (Capacity * Count);
+        }
+        ASSERT(not_full());
+        UInt32 idx = bits.peek();
+        bits.set(idx);
+        // LOG(Memory, "MemoryBlock take: %d of %d : %lu", idx, Count, Capacity);
+        return { byte_ptr(base) + (idx * Capacity), Capacity };
+    }
+
+    constexpr void put(const Memory &mem) { 
+        Size idx = (byte_ptr(mem.ptr) - byte_ptr(base)) / Capacity;
+        // LOG(Memory, "MemoryBlock put: %d", idx);
+        ASSERT(idx < Count);
+        bits.clear(idx);
+    }
+
+    constexpr void reset() { 
+        bits.reset();
+    }
+
+    constexpr bool is_allocated() const { 
+        return base != nullptr; 
+    }
+
+    constexpr void release() { 
+        // LOG(Memory, "MemoryBlock free: %p", base);
+        free(base);
+        base = nullptr;
+        extent = nullptr;
+    }
+    
+    bool contains(const Memory &mem) const {
+        return mem.ptr >= base && mem.ptr < extent;
+    }    
+
+    // Calls f with every slot in use, in address order.
+    template <typename F>
+    void for_each_taken(F &&f) {
+        if (base == nullptr) {
+            return;
+        }
+        for (Size idx = 0; idx < Count; idx++) {
+            if (bits.test(idx)) {
+                f(Memory(byte_ptr(base) + (idx * Capacity), Capacity));
+            }
+        }
+    }
+
+    void *base = nullptr;
+    void *extent = nullptr;
+    // beyond a few words, the summary keeps finding a free slot from becoming a linear scan
+    using Bits = std::conditional_t<(Count / BitBlockBitsPerSubBlock > 4), 
+        HierarchicalBitBlock<Count / BitBlockBitsPerSubBlock>, BitBlock<Count / BitBlockBitsPerSubBlock>>;
+    Bits bits;
+};
+
+// BlockAllocator =================================================================================
+
+template <Size Count, Size LoFit, Size HiFit = LoFit, bool ChecksFit = false> requires 
+    IsMutipleOf64<Count> && IsLessThanOrEqual<LoFit, HiFit>
+class BlockAllocator
+{
+public:
+    using Block = MemoryBlock<HiFit, Count>;
+
+    constexpr BlockAllocator() {}
+
+    constexpr bool fits(Size capacity) const { return capacity >= LoFit && capacity <= HiFit; }
+
+    Memory alloc(Size capacity) {
+        Size ecap = align_up(capacity);
+        Memory mem;
+        bool test_fit = true;
+        if constexpr (ChecksFit) {
+            test_fit = fits(ecap);
+        }
+        if (test_fit && m_block.not_full()) {
+            ASSERT_WITH_MESSAGE(fits(ecap), "must fit in %lu - %lu ; got %lu", LoFit, HiFit, capacity);
+            bool fresh = !m_block.is_allocated();
+            mem = m_block.take();
+            if (fresh) {
+                PageMap::set(m_block.base, Block::Length, this);
+            }
+            LOG(Memory, "BlockAllocator alloc: %lu (%lu - %lu) : %p (%d => %p)", mem.capacity, LoFit, HiFit, mem.ptr, pthread_main_np(), pthread_self());
+        }
+        return mem;
+    }
+
+    bool dealloc(Memory &mem) {
+        if (!owns(mem)) {
+            LOG(Memory, "BlockAllocator doesn't own: %lu (%lu - %lu) : %p (%d => %p)", mem.capacity, LoFit, HiFit, mem.ptr, pthread_main_np(), pthread_self());
+            return false;
+        }
+        free(mem);
+        return true;
+    }
+
+    void free(Memory &mem) {
+        LOG(Memory, "BlockAllocator free: %lu (%lu - %lu) : %p (%d => %p)", mem.capacity, LoFit, HiFit, mem.ptr, pthread_main_np(), pthread_self());
+        m_block.put(mem);
+    }
+
+    void free_all() {
+        if (m_block.is_allocated()) {
+            PageMap::clear(m_block.base, Block::Length);
+        }
+        m_block.reset();
+        m_block.release();
+    }
+
+    bool owns(const Memory &mem) const { 
+        return m_block.contains(mem);
+    }    
+
+    // every slot is HiFit bytes, so a block can grow or shrink in place within that
+    bool expand(Memory &mem, Size delta) {
+        if (mem.capacity + delta > HiFit) {
+            return false;
+        }
+        mem.capacity += delta;
+        return true;
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        if (mem.is_empty() || align_up(capacity) > HiFit) {
+            return false;
+        }
+        mem.capacity = HiFit;
+        return true;
+    }
+
+    bool is_empty() const {
+        return m_block.is_empty();
+    }
+
+    // Calls f with every block currently allocated.
+    template <typename F>
+    void for_each_allocated(F &&f) {
+        m_block.for_each_taken(f);
+    }
+
+private:
+    Block m_block;
+};
+
+// ConcurrentBlockAllocator =======================================================================
+
+// A BlockAllocator that any number of threads can allocate from and free to at once, with no
+// lock. Slots are claimed and returned with atomic operations on an AtomicBitBlock, and each
+// thread starts its search at a word picked from its ThreadSlots slot, so threads allocating
+// together mostly touch different words. Whichever thread first needs the backing store
+// creates it; if two race, one keeps its store and the other frees its own.
+//
+// free_all() is the one call that must not overlap any other.
+//
+template <Size Count, Size LoFit, Size HiFit = LoFit> requires 
+    IsMutipleOf64<Count> && IsLessThanOrEqual<LoFit, HiFit>
+class ConcurrentBlockAllocator
+{
+public:
+    static constexpr Size Length = PageMap::round_up_to_page_size(HiFit * Count);
+
+    ConcurrentBlockAllocator() {}
+    ConcurrentBlockAllocator(const ConcurrentBlockAllocator &) = delete;
+    ConcurrentBlockAllocator &operator=(const ConcurrentBlockAllocator &) = delete;
+
+    ~ConcurrentBlockAllocator() {
+        free_all();
+    }
+
+    constexpr bool fits(Size capacity) const { return capacity >= LoFit && capacity <= HiFit; }
+
+    Memory alloc(Size capacity) {
+        ASSERT_WITH_MESSAGE(fits(align_up(capacity)), "must fit in %lu - %lu ; got %lu", LoFit, HiFit, capacity);
+        Byte *base = ensure_base();
+        if (UNLIKELY(base == nullptr)) {
+            return Memory();
+        }
+        Size slot = ThreadSlots::slot();
+        UInt32 idx = m_bits.take(slot == ThreadSlots::NoSlot ? 0 : slot % Bits::BlockCount);
+        if (idx == UInt32(-1)) {
+            return Memory();
+        }
+        return { base + (idx * HiFit), HiFit };
+    }
+
+    bool dealloc(Memory &mem) {
+        if (!owns(mem)) {
+            return false;
+        }
+        free(mem);
+        return true;
+    }
+
+    void free(Memory &mem) {
+        Size idx = (byte_ptr(mem.ptr) - m_base.load(std::memory_order_relaxed)) / HiFit;
+        ASSERT(idx < Count);
+        bool was_set = m_bits.clear(idx);
+        ASSERT_WITH_MESSAGE(was_set, "double free: %p", mem.ptr);
+        UNUSED_PARAM(was_set);
+    }
+
+    void free_all() {
+        Byte *base = m_base.exchange(nullptr, std::memory_order_acq_rel);
+        if (base != nullptr) {
+            PageMap::clear(base, Length);
+            ::free(base);
+        }
+        m_bits.reset();
+    }
+
+    bool owns(const Memory &mem) const { 
+        Byte *base = m_base.load(std::memory_order_acquire);
+        return base != nullptr && mem.ptr >= base && mem.ptr < base + (HiFit * Count);
+    }    
+
+    // every slot is HiFit bytes, so a block can grow or shrink in place within that
+    bool expand(Memory &mem, Size delta) {
+        if (mem.capacity + delta > HiFit) {
+            return false;
+        }
+        mem.capacity += delta;
+        return true;
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        if (mem.is_empty() || align_up(capacity) > HiFit) {
+            return false;
+        }
+        mem.capacity = HiFit;
+        return true;
+    }
+
+    bool is_empty() const {
+        return m_bits.is_empty();
+    }
+
+    bool is_full() const {
+        return m_bits.is_full();
+    }
+
+private:
+    using Bits = AtomicBitBlock<Count / BitBlockBitsPerSubBlock>;
+
+    Byte *ensure_base() {
+        Byte *base = m_base.load(std::memory_order_acquire);
+        if (LIKELY(base != nullptr)) {
+            return base;
+        }
+        Byte *fresh = byte_ptr(aligned_alloc(PageMap::PageSize, Length));
+        if (fresh == nullptr) {
+            return nullptr;
+        }
+        // register before publishing, so no slot is handed out from an unregistered block
+        PageMap::set(fresh, Length, this);
+        if (m_base.compare_exchange_strong(base, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return fresh;
+        }
+        PageMap::clear(fresh, Length);
+        ::free(fresh);
+        return base;
+    }
+
+    std::atomic<Byte *> m_base = nullptr;
+    Bits m_bits;
+};
+
+// CascadingAllocator =============================================================================
+
+// Spreads allocations over up to MaxCount allocators of the same kind, creating each one's
+// backing store as it is first needed. When an allocator empties, its store is kept for reuse
+// rather than freed at once, so a workload that hovers around a block boundary doesn't free
+// and reallocate the same block over and over. Up to MaxRetained empty allocators are kept,
+// fewer if set_retention() says so. Each is freed when it has sat empty for longer than the
+// retention time, checked whenever another allocator empties, or when trim() is called.
+//
+template <typename Alloc, Size MaxCount = 256, Size MaxRetained = 2> requires 
+    IsGreaterThanOne<MaxCount> && IsLessThanOrEqual<MaxRetained, MaxCount>
+class CascadingAllocator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr Clock::duration DefaultRetainTime = std::chrono::seconds(1);
+
+    constexpr CascadingAllocator() {
+        for (Size idx = 0; idx < MaxCount; idx++) {
+            m_allocators[idx] = Alloc();
+        }
+    }
+
+    CascadingAllocator(const CascadingAllocator &) = delete;
+    CascadingAllocator &operator=(const CascadingAllocator &) = delete;
+
+    ~CascadingAllocator() {
+        trim();
+    }
+
+    Memory alloc(Size capacity) {
         Size ecap = align_up(capacity);
         Memory mem;
         // search from most recent allocator
@@ -532,14 +1515,26 @@ public:
             mem = m_allocators[idx].alloc(ecap);
             if (mem.not_empty()) {
                 index = idx;
+                unretain(idx);
                 return mem;
             }
+            // before starting a fresh allocator, reuse a retained one
+            if (m_retained_count > 0) {
+                Size retained = m_retained[m_retained_count - 1].idx;
+                mem = m_allocators[retained].alloc(ecap);
+                if (mem.not_empty()) {
+                    index = retained;
+                    m_retained_count--;
+                    return mem;
+                }
+            }
         }
         // search from start
         for (Size idx = 0; idx < index; idx++) {
             mem = m_allocators[idx].alloc(ecap);
             if (mem.not_empty()) {
                 index = idx;
+                unretain(idx);
                 return mem;
             }
         }
@@ -547,29 +1542,14 @@ public:
     }
 
     bool dealloc(Memory &mem) {
-        // search from most recent allocator
-        for (Size idx = index; idx < MaxCount; idx++) {
-            Alloc &a = m_allocators[idx];
-            if (a.dealloc(mem)) {
-                if (a.is_empty()) {
-                    LOG(Memory, "CascadingAllocator freeing allocator: %llu", idx);
-                    a.free_all();
-                }
-                return true;
-            }
+        Alloc *a = owner(mem);
+        if (a == nullptr || !a->dealloc(mem)) {
+            return false;
         }
-        // search from start
-        for (Size idx = 0; idx < index; idx++) {
-            Alloc &a = m_allocators[idx];
-            if (a.dealloc(mem)) {
-                if (a.is_empty()) {
-                    LOG(Memory, "CascadingAllocator freeing allocator: %llu", idx);
-                    a.free_all();
-                }
-                return true;
-            }
+        if (a->is_empty()) {
+            retain(a - m_allocators);
         }
-        return false;
+        return true;
     }
 
     void free(Memory &mem) {
@@ -577,41 +1557,245 @@ public:
     }
 
     bool owns(const Memory &mem) const { 
+        const Alloc *a = owner(mem);
+        return a != nullptr && a->owns(mem);
+    }    
+
+    bool expand(Memory &mem, Size delta) {
+        Alloc *a = owner(mem);
+        return a != nullptr && a->expand(mem, delta);
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        Alloc *a = owner(mem);
+        return a != nullptr && a->reallocate(mem, capacity);
+    }
+
+    // Keeps up to count empty allocators, capped at MaxRetained, each for up to time. A count
+    // of zero frees allocators as soon as they empty.
+    void set_retention(Size count, Clock::duration time) {
+        m_retain_limit = std::min(count, MaxRetained);
+        m_retain_time = time;
+        while (m_retained_count > m_retain_limit) {
+            release_oldest();
+        }
+    }
+
+    // Frees every retained empty allocator, and returns how many there were.
+    Size trim() {
+        Size count = m_retained_count;
+        while (m_retained_count > 0) {
+            release_oldest();
+        }
+        return count;
+    }
+
+    Size retained_count() const {
+        return m_retained_count;
+    }
+
+    // Calls f with every block currently allocated.
+    template <typename F>
+    void for_each_allocated(F &&f) {
         for (Size idx = 0; idx < MaxCount; idx++) {
-            if (m_allocators[idx].owns(mem)) {
-                return true;
-            }
+            m_allocators[idx].for_each_allocated(f);
         }
-        return false;
-    }    
+    }
+
+    // Frees every allocator's backing store, whether or not its blocks have been deallocated.
+    void free_all() {
+        for (Size idx = 0; idx < MaxCount; idx++) {
+            m_allocators[idx].free_all();
+        }
+        m_retained_count = 0;
+        index = 0;
+    }
 
 private:
+    struct Retained {
+        Size idx;
+        Clock::time_point since;
+    };
+
+    // The PageMap knows which allocator owns the page mem falls in, and whether that allocator
+    // is one of ours is just a range check, so there is no need to scan the allocators in turn.
+    UU_ALWAYS_INLINE Alloc *owner(const Memory &mem) const {
+        auto ptr = static_cast<const Alloc *>(PageMap::get(mem.ptr));
+        std::less<const Alloc *> less;
+        if (ptr == nullptr || less(ptr, m_allocators) || !less(ptr, m_allocators + MaxCount)) {
+            return nullptr;
+        }
+        return const_cast<Alloc *>(ptr);
+    }
+
+    void retain(Size idx) {
+        if (m_retain_limit == 0) {
+            LOG(Memory, "CascadingAllocator freeing allocator: %lu", idx);
+            m_allocators[idx].free_all();
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        while (m_retained_count > 0 && now - m_retained[0].since > m_retain_time) {
+            release_oldest();
+        }
+        if (m_retained_count == m_retain_limit) {
+            release_oldest();
+        }
+        LOG(Memory, "CascadingAllocator retaining allocator: %lu", idx);
+        m_retained[m_retained_count] = { idx, now };
+        m_retained_count++;
+    }
+
+    // Called when allocator idx has handed out a block, so it is no longer empty.
+    UU_ALWAYS_INLINE void unretain(Size idx) {
+        for (Size r = 0; r < m_retained_count; r++) {
+            if (m_retained[r].idx == idx) {
+                remove_retained(r);
+                return;
+            }
+        }
+    }
+
+    void release_oldest() {
+        Size idx = m_retained[0].idx;
+        LOG(Memory, "CascadingAllocator freeing allocator: %lu", idx);
+        m_allocators[idx].free_all();
+        remove_retained(0);
+    }
+
+    void remove_retained(Size r) {
+        for (Size j = r + 1; j < m_retained_count; j++) {
+            m_retained[j - 1] = m_retained[j];
+        }
+        m_retained_count--;
+    }
+
     Alloc m_allocators[MaxCount];
     Size index = 0;
+    Retained m_retained[MaxRetained == 0 ? 1 : MaxRetained] = {};
+    Size m_retained_count = 0;
+    Size m_retain_limit = MaxRetained;
+    Clock::duration m_retain_time = DefaultRetainTime;
+};
+
+// SizeClasses ====================================================================================
+
+// A table of allocation size classes, generated at compile time. The classes run from MinSize
+// to MaxSize, with ClassesPerDoubling evenly spaced classes between each power of two and the
+// next, so rounding a size up to its class wastes at most 1/ClassesPerDoubling of the block.
+// Finding the class for a size takes a few bit operations rather than a search.
+//
+// For example, the default table is 32, 48, 64, 96, 128, 192, 256 ... 16384, 24576, 32768.
+//
+template <Size MinSize = 32, Size MaxSize = 32768, Size ClassesPerDoubling = 2> requires 
+    IsPowerOfTwo<MinSize> && IsPowerOfTwo<MaxSize> && IsPowerOfTwo<ClassesPerDoubling> && 
+    IsLessThan<MinSize, MaxSize> && IsLessThanOrEqual<alignof(void *) * ClassesPerDoubling, MinSize>
+struct SizeClasses
+{
+    static constexpr Size MinClassSize = MinSize;
+    static constexpr Size MaxClassSize = MaxSize;
+    static constexpr Size MinShift = std::countr_zero(MinSize);
+    static constexpr Size MaxShift = std::countr_zero(MaxSize);
+    static constexpr Size SpacingShift = std::countr_zero(ClassesPerDoubling);
+    static constexpr Size Count = (MaxShift - MinShift) * ClassesPerDoubling + 1;
+
+    static constexpr std::array<Size, Count> Sizes = [] {
+        std::array<Size, Count> sizes = {};
+        sizes[0] = MinSize;
+        Size idx = 1;
+        for (Size base = MinSize; base < MaxSize; base *= 2) {
+            for (Size step = 1; step <= ClassesPerDoubling; step++) {
+                sizes[idx++] = base + (step * base / ClassesPerDoubling);
+            }
+        }
+        return sizes;
+    }();
+
+    // Returns the index of the smallest class that can hold size, which must be no more 
+    // than MaxSize.
+    UU_ALWAYS_INLINE static constexpr Size index(Size size) {
+        ASSERT(size <= MaxSize);
+        if (size <= MinSize) {
+            return 0;
+        }
+        // size is in (2^k, 2^(k+1)], and j picks one of the ClassesPerDoubling steps above 2^k
+        Size x = size - 1;
+        Size k = static_cast<Size>(std::bit_width(x)) - 1;
+        Size j = (x - (Size(1) << k)) >> (k - SpacingShift);
+        return ((k - MinShift) << SpacingShift) + j + 1;
+    }
+
+    UU_ALWAYS_INLINE static constexpr Size size_for(Size size) {
+        return Sizes[index(size)];
+    }
 };
 
 // GPAllocator =====================================================================================
 
+using GPSizeClasses = SizeClasses<>;
+
+// Slots in each block of a GPAllocator size class, so a block comes to about 256 KiB: up to
+// 4096 slots for the smallest classes, down to 64 for the largest.
+constexpr Size gp_class_slots(Size class_size) {
+    constexpr Size BlockBytes = 256 * 1024;
+    Size slots = (BlockBytes / class_size) & ~Size(63);
+    return std::min<Size>(std::max<Size>(slots, 64), 4096);
+}
+
+// The shared allocator for one GPAllocator size class. With blocks this large, 64 of them
+// are enough to cascade over.
+template <Size I>
+using GPClassAllocator = CascadingAllocator<BlockAllocator<gp_class_slots(GPSizeClasses::Sizes[I]), 
+    I == 0 ? 0 : GPSizeClasses::Sizes[I - 1] + 1, GPSizeClasses::Sizes[I]>, 64>;
+
+// Small allocations are served from per-thread magazines: fixed-size stacks of free blocks,
+// one for each size class, that take no lock. An empty magazine refills from the shared
+// CascadingAllocator for its class with a batch of blocks under the lock, and a full one
+// drains half its blocks back to the same place. Blocks freed by a thread other than the one
+// that allocated them simply land in the freeing thread's magazine. Allocations larger than
+// the largest size class go to MmapAllocator.
+//
+// Every block lies on pages registered in the PageMap to something inside the GPAllocator, so
+// owns() is a lookup and a range check, and a GPAllocator can tell its blocks from those of
+// another GPAllocator or of malloc.
+//
+// Threads beyond ThreadSlots::MaxSlots use the shared allocators directly, under the lock.
+// When a thread exits, its magazines are drained back to the shared allocators.
+//
 class GPAllocator
 {
-    static constexpr Size Size0 =    0;
-    static constexpr Size Size1 =   32;
-    static constexpr Size Size2 =   64;
-    static constexpr Size Size3 =   96;
-    static constexpr Size Size4 =  128;
-    static constexpr Size Size5 =  256;
-    static constexpr Size Size6 =  384;
-    static constexpr Size Size7 =  512;
-    static constexpr Size Size8 = 1024;
-
-    using Size1Allocator = CascadingAllocator<BlockAllocator<256, Size0, Size1>>;
-    using Size2Allocator = CascadingAllocator<BlockAllocator<256, Size1 + 1, Size2>>;
-    using Size3Allocator = CascadingAllocator<BlockAllocator<256, Size2 + 1, Size3>>;
-    using Size4Allocator = CascadingAllocator<BlockAllocator<256, Size3 + 1, Size4>>;
-    using Size5Allocator = CascadingAllocator<BlockAllocator<256, Size4 + 1, Size5>>;
-    using Size6Allocator = CascadingAllocator<BlockAllocator<256, Size5 + 1, Size6>>;
-    using Size7Allocator = CascadingAllocator<BlockAllocator<256, Size6 + 1, Size7>>;
-    using Size8Allocator = CascadingAllocator<BlockAllocator<256, Size7 + 1, Size8>>;
+public:
+    using Classes = GPSizeClasses;
+    static constexpr Size ClassCount = Classes::Count;
+    static constexpr Size MaxClassSize = Classes::MaxClassSize;
+
+private:
+    static constexpr UInt32 MagazineCapacity = 32;
+
+    // Magazines for large classes hold fewer blocks, so an idle thread doesn't sit on more 
+    // than about MagazineBytes in any one class.
+    static constexpr Size MagazineBytes = 64 * 1024;
+    static constexpr std::array<UInt32, ClassCount> MagazineLimits = [] {
+        std::array<UInt32, ClassCount> limits = {};
+        for (Size cls = 0; cls < ClassCount; cls++) {
+            Size count = MagazineBytes / Classes::Sizes[cls];
+            limits[cls] = static_cast<UInt32>(count < 2 ? 2 : (count > MagazineCapacity ? MagazineCapacity : count));
+        }
+        return limits;
+    }();
+
+    struct alignas(64) Magazine {
+        UInt32 count = 0;
+        void *ptrs[MagazineCapacity];
+    };
+
+    struct ThreadCache {
+        Magazine magazines[ClassCount];
+    };
+
+    template <Size... I>
+    static std::tuple<GPClassAllocator<I>...> make_allocators(std::index_sequence<I...>);
+    using Allocators = decltype(make_allocators(std::make_index_sequence<ClassCount>()));
 
     UU_ALWAYS_INLINE void lock() { 
         mutex.lock(); 
@@ -622,143 +1806,472 @@ class GPAllocator
     }
 
 public:
+    GPAllocator() {
+        ThreadSlots::add_exit_hook(flush_exiting_thread, this);
+    }
+
+    GPAllocator(const GPAllocator &) = delete;
+    GPAllocator &operator=(const GPAllocator &) = delete;
+
+    ~GPAllocator() {
+        ThreadSlots::remove_exit_hook(flush_exiting_thread, this);
+        for (auto &cache : caches) {
+            ThreadCache *ptr = cache.exchange(nullptr);
+            if (ptr) {
+                ptr->~ThreadCache();
+                ::free(ptr);
+            }
+        }
+    }
+
     Memory alloc(Size capacity) {
         Size ecapacity = align_up(capacity);
-        Memory mem;
-        if (ecapacity > Size8) {
+        if (ecapacity > MaxClassSize) {
+            return large.alloc(ecapacity);
+        }
+        Size cls = Classes::index(ecapacity);
+        ThreadCache *cache = thread_cache();
+        if (UNLIKELY(cache == nullptr)) {
             lock();
-            mem = mallocator.alloc(ecapacity);
+            Memory mem = shared_alloc(cls);
             unlock();
+            return mem;
         }
-        else {
-            if (ecapacity <= Size1) {
-                lock();
-                mem = a1.alloc(ecapacity);
-                unlock();
-            }
-            else if (ecapacity <= Size2) {
-                lock();
-                mem = a2.alloc(ecapacity);
-                unlock();
-            }
-            else if (ecapacity <= Size3) {
-                lock();
-                mem = a3.alloc(ecapacity);
-                unlock();
-            }
-            else if (ecapacity <= Size4) {
-                lock();
-                mem = a4.alloc(ecapacity);
-                unlock();
-            }
-            else if (ecapacity <= Size5) {
-                lock();
-                mem = a5.alloc(ecapacity);
-                unlock();
-            }
-            else if (ecapacity <= Size6) {
-                lock();
-                mem = a6.alloc(ecapacity);
-                unlock();
-            }
-            else if (ecapacity <= Size7) {
-                lock();
-                mem = a7.alloc(ecapacity);
-                unlock();
-            }
-            else if (ecapacity <= Size8) {
-                lock();
-                mem = a8.alloc(ecapacity);
-                unlock();
+        Magazine &magazine = cache->magazines[cls];
+        if (UNLIKELY(magazine.count == 0)) {
+            refill(cls, magazine);
+            if (magazine.count == 0) {
+                return Memory();
             }
-            if (mem.is_empty()) {
-                lock();
-                mem = mallocator.alloc(ecapacity);
-                unlock();
+        }
+        magazine.count--;
+        return Memory(magazine.ptrs[magazine.count], Classes::Sizes[cls]);
+    }
+
+    bool dealloc(Memory &mem) {
+        if (mem.capacity > MaxClassSize) {
+            return large.dealloc(mem);
+        }
+        Size cls = Classes::index(mem.capacity);
+        ThreadCache *cache = thread_cache();
+        if (UNLIKELY(cache == nullptr)) {
+            lock();
+            shared_dealloc(cls, mem);
+            unlock();
+            return true;
+        }
+        Magazine &magazine = cache->magazines[cls];
+        if (UNLIKELY(magazine.count >= MagazineLimits[cls])) {
+            drain(cls, magazine, MagazineLimits[cls] / 2);
+        }
+        magazine.ptrs[magazine.count] = mem.ptr;
+        magazine.count++;
+        return true;
+    }
+
+    void free(Memory &mem) {
+        dealloc(mem);
+    }
+
+    bool owns(const Memory &mem) const { 
+        auto owner = static_cast<const Byte *>(PageMap::get(mem.ptr));
+        auto self = reinterpret_cast<const Byte *>(this);
+        std::less<const Byte *> less;
+        return owner != nullptr && !less(owner, self) && less(owner, self + sizeof(GPAllocator));
+    }
+
+    // A small block can grow in place up to the size of its class. 
+    bool expand(Memory &mem, Size delta) {
+        if (delta == 0) {
+            return true;
+        }
+        if (mem.capacity > MaxClassSize) {
+            return large.expand(mem, delta);
+        }
+        Size class_size = Classes::size_for(mem.capacity);
+        if (align_up(mem.capacity + delta) > class_size) {
+            return false;
+        }
+        mem.capacity = class_size;
+        return true;
+    }
+
+    // Resizes in place within a size class, with MmapAllocator between large blocks, and by 
+    // moving otherwise.
+    bool reallocate(Memory &mem, Size capacity) {
+        if (mem.is_empty()) {
+            mem = alloc(capacity);
+            return mem.not_empty();
+        }
+        Size ecapacity = align_up(capacity);
+        if (mem.capacity > MaxClassSize && ecapacity > MaxClassSize) {
+            return large.reallocate(mem, ecapacity);
+        }
+        if (mem.capacity <= MaxClassSize && ecapacity <= MaxClassSize && ecapacity > 0) {
+            Size cls = Classes::index(mem.capacity);
+            if (Classes::index(ecapacity) == cls) {
+                mem.capacity = Classes::Sizes[cls];
+                return true;
+            }
+        }
+        return reallocate_by_moving(*this, mem, capacity);
+    }
+
+    // Returns every block cached by the calling thread to the shared allocators.
+    void flush_thread_cache() {
+        ThreadCache *cache = thread_cache<false>();
+        if (cache) {
+            for (Size cls = 0; cls < ClassCount; cls++) {
+                drain(cls, cache->magazines[cls], cache->magazines[cls].count);
             }
         }
-        return mem;
     }
 
-    UU_ALWAYS_INLINE void mallocator_dealloc(Memory &mem) {
+    // Gives back memory that is held but not in use: the calling thread's magazines, the empty
+    // blocks each size class keeps for reuse, empty overflow chunks, and cached large regions.
+    // Long-running services can call this when they go idle.
+    void trim() {
+        flush_thread_cache();
         lock();
-        mallocator.dealloc(mem);
+        std::apply([](auto &...allocator) { (allocator.trim(), ...); }, allocators);
+        overflow.trim();
         unlock();
+        large.purge();
     }
 
-    bool dealloc(Memory &mem) {
-        if (mem.capacity > Size8) {
-            mallocator_dealloc(mem);
-            return true;
+private:
+    // so blocks cached for an exiting thread's slot don't sit idle until another thread takes it
+    static void flush_exiting_thread(void *self) {
+        static_cast<GPAllocator *>(self)->flush_thread_cache();
+    }
+
+    template <bool Create = true>
+    UU_ALWAYS_INLINE ThreadCache *thread_cache() {
+        Size slot = ThreadSlots::slot();
+        if (UNLIKELY(slot == ThreadSlots::NoSlot)) {
+            return nullptr;
         }
-        bool b = false;
-        if (mem.capacity <= Size1) {
-            lock();
-            b = a1.dealloc(mem);
-            unlock();
+        // only the thread holding a slot ever installs its cache, so there is no race here
+        ThreadCache *cache = caches[slot].load(std::memory_order_acquire);
+        if (UNLIKELY(cache == nullptr) && Create) {
+            void *ptr = aligned_alloc(alignof(ThreadCache), sizeof(ThreadCache));
+            if (ptr == nullptr) {
+                return nullptr;
+            }
+            cache = new (ptr) ThreadCache;
+            caches[slot].store(cache, std::memory_order_release);
         }
-        else if (mem.capacity <= Size2) {
-            lock();
-            b = a2.dealloc(mem);
-            unlock();
+        return cache;
+    }
+
+    template <Size I>
+    static Memory class_alloc(GPAllocator &self) {
+        return std::get<I>(self.allocators).alloc(Classes::Sizes[I]);
+    }
+
+    template <Size I>
+    static bool class_dealloc(GPAllocator &self, Memory &mem) {
+        return std::get<I>(self.allocators).dealloc(mem);
+    }
+
+    using ClassAllocFn = Memory (*)(GPAllocator &);
+    using ClassDeallocFn = bool (*)(GPAllocator &, Memory &);
+
+    template <Size... I>
+    static constexpr std::array<ClassAllocFn, ClassCount> class_alloc_table(std::index_sequence<I...>) {
+        return { &class_alloc<I>... };
+    }
+
+    template <Size... I>
+    static constexpr std::array<ClassDeallocFn, ClassCount> class_dealloc_table(std::index_sequence<I...>) {
+        return { &class_dealloc<I>... };
+    }
+
+    // Blocks for a size class whose shared allocator is full. They are cut from chunks that
+    // each serve one class and are registered in the PageMap, like every other block, so
+    // owns() knows them too. Chunks are aligned to their size, so a freed block finds its
+    // chunk by masking its address. A chunk counts its live blocks, and trim() gives back the
+    // ones with none. Must hold the lock.
+    class Overflow
+    {
+    public:
+        static constexpr Size ChunkSize = 256 * 1024;
+
+        Overflow() {}
+        Overflow(const Overflow &) = delete;
+        Overflow &operator=(const Overflow &) = delete;
+
+        ~Overflow() {
+            for (Size cls = 0; cls < ClassCount; cls++) {
+                while (m_chunks[cls]) {
+                    release_chunk(cls, m_chunks[cls]);
+                }
+            }
         }
-        else if (mem.capacity <= Size3) {
-            lock();
-            b = a3.dealloc(mem);
-            unlock();
+
+        Memory alloc(Size cls) {
+            Size size = Classes::Sizes[cls];
+            Chunk *chunk = m_chunks[cls];
+            // freeing moves a chunk to the front, so the first chunk usually has room
+            while (chunk && !has_room(chunk, size)) {
+                chunk = chunk->next;
+            }
+            if (UNLIKELY(chunk == nullptr)) {
+                chunk = add_chunk(cls);
+                if (chunk == nullptr) {
+                    return Memory();
+                }
+            }
+            move_to_front(cls, chunk);
+            chunk->live++;
+            if (chunk->free) {
+                FreeBlock *block = chunk->free;
+                chunk->free = block->next;
+                return Memory(block, size);
+            }
+            Memory mem(chunk->ptr, size);
+            chunk->ptr += size;
+            return mem;
         }
-        else if (mem.capacity <= Size4) {
-            lock();
-            b = a4.dealloc(mem);
-            unlock();
+
+        void dealloc(Size cls, Memory &mem) {
+            Chunk *chunk = reinterpret_cast<Chunk *>(reinterpret_cast<uintptr_t>(mem.ptr) & ~(ChunkSize - 1));
+            ASSERT(chunk->live > 0);
+            FreeBlock *block = static_cast<FreeBlock *>(mem.ptr);
+            block->next = chunk->free;
+            chunk->free = block;
+            chunk->live--;
+            move_to_front(cls, chunk);
         }
-        else if (mem.capacity <= Size5) {
-            lock();
-            b = a5.dealloc(mem);
-            unlock();
+
+        // Frees every chunk with no live blocks, and returns how many there were.
+        Size trim() {
+            Size count = 0;
+            for (Size cls = 0; cls < ClassCount; cls++) {
+                Chunk *chunk = m_chunks[cls];
+                while (chunk) {
+                    Chunk *next = chunk->next;
+                    if (chunk->live == 0) {
+                        release_chunk(cls, chunk);
+                        count++;
+                    }
+                    chunk = next;
+                }
+            }
+            return count;
         }
-        else if (mem.capacity <= Size6) {
-            lock();
-            b = a6.dealloc(mem);
-            unlock();
+
+    private:
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        struct Chunk {
+            Chunk *prev;
+            Chunk *next;
+            FreeBlock *free;
+            Byte *ptr;
+            Size live;
+        };
+
+        // keeps blocks as aligned as the size classes themselves
+        static constexpr Size HeaderSize = 64;
+        static_assert(sizeof(Chunk) <= HeaderSize);
+
+        static bool has_room(const Chunk *chunk, Size size) {
+            return chunk->free || size <= Size(byte_ptr(const_cast<Chunk *>(chunk)) + ChunkSize - chunk->ptr);
         }
-        else if (mem.capacity <= Size7) {
-            lock();
-            b = a7.dealloc(mem);
-            unlock();
+
+        Chunk *add_chunk(Size cls) {
+            void *ptr = aligned_alloc(ChunkSize, ChunkSize);
+            if (ptr == nullptr) {
+                return nullptr;
+            }
+            LOG(Memory, "GPAllocator add overflow chunk: %lu : %p", Classes::Sizes[cls], ptr);
+            PageMap::set(ptr, ChunkSize, this);
+            Chunk *chunk = static_cast<Chunk *>(ptr);
+            *chunk = { nullptr, m_chunks[cls], nullptr, byte_ptr(ptr) + HeaderSize, 0 };
+            if (m_chunks[cls]) {
+                m_chunks[cls]->prev = chunk;
+            }
+            m_chunks[cls] = chunk;
+            return chunk;
         }
-        else if (mem.capacity <= Size8) {
-            lock();
-            b = a8.dealloc(mem);
-            unlock();
+
+        void unlink(Size cls, Chunk *chunk) {
+            if (chunk->prev) {
+                chunk->prev->next = chunk->next;
+            }
+            else {
+                m_chunks[cls] = chunk->next;
+            }
+            if (chunk->next) {
+                chunk->next->prev = chunk->prev;
+            }
+            chunk->prev = nullptr;
+            chunk->next = nullptr;
         }
-        else {
-            b = true;
-            mallocator_dealloc(mem);
+
+        void move_to_front(Size cls, Chunk *chunk) {
+            if (m_chunks[cls] == chunk) {
+                return;
+            }
+            unlink(cls, chunk);
+            chunk->next = m_chunks[cls];
+            m_chunks[cls]->prev = chunk;
+            m_chunks[cls] = chunk;
         }
-        if (!b) {
-            mallocator_dealloc(mem);
+
+        void release_chunk(Size cls, Chunk *chunk) {
+            LOG(Memory, "GPAllocator release overflow chunk: %lu : %p", Classes::Sizes[cls], chunk);
+            unlink(cls, chunk);
+            PageMap::clear(chunk, ChunkSize);
+            ::free(chunk);
         }
-        return true;
+
+        Chunk *m_chunks[ClassCount] = {};
+    };
+
+    // Takes one block of class cls from the shared allocators. Must hold the lock.
+    Memory shared_alloc(Size cls) {
+        static constexpr auto table = class_alloc_table(std::make_index_sequence<ClassCount>());
+        Memory mem = table[cls](*this);
+        if (mem.is_empty()) {
+            mem = overflow.alloc(cls);
+        }
+        return mem;
     }
 
-    void free(Memory &mem) {
-        dealloc(mem);
+    // Gives one block of class cls back to the shared allocators. Must hold the lock.
+    void shared_dealloc(Size cls, Memory &mem) {
+        static constexpr auto table = class_dealloc_table(std::make_index_sequence<ClassCount>());
+        if (!table[cls](*this, mem)) {
+            overflow.dealloc(cls, mem);
+        }
     }
 
-    bool owns(const Memory &mem) const { return true; }
+    void refill(Size cls, Magazine &magazine) {
+        UInt32 batch = MagazineLimits[cls] / 2;
+        lock();
+        while (magazine.count < batch) {
+            Memory mem = shared_alloc(cls);
+            if (mem.is_empty()) {
+                break;
+            }
+            magazine.ptrs[magazine.count] = mem.ptr;
+            magazine.count++;
+        }
+        unlock();
+    }
 
-private:
-    Size1Allocator a1;
-    Size2Allocator a2;
-    Size3Allocator a3;
-    Size4Allocator a4;
-    Size5Allocator a5;
-    Size6Allocator a6;
-    Size7Allocator a7;
-    Size8Allocator a8;
-    Mallocator mallocator;
+    void drain(Size cls, Magazine &magazine, UInt32 count) {
+        ASSERT(count <= magazine.count);
+        lock();
+        // oldest blocks first, so the most recently freed ones stay hot in the magazine
+        for (UInt32 idx = 0; idx < count; idx++) {
+            Memory mem(magazine.ptrs[idx], Classes::Sizes[cls]);
+            shared_dealloc(cls, mem);
+        }
+        unlock();
+        magazine.count -= count;
+        for (UInt32 idx = 0; idx < magazine.count; idx++) {
+            magazine.ptrs[idx] = magazine.ptrs[idx + count];
+        }
+    }
+
+    Allocators allocators;
+    Overflow overflow;
+    MmapAllocator large;  // has its own lock, so large blocks don't take ours
     std::mutex mutex;
+    std::array<std::atomic<ThreadCache *>, ThreadSlots::MaxSlots> caches = {};
+};
+
+
+// DynamicAllocator ===============================================================================
+
+// A runtime interface to the alloc/dealloc/owns protocol, so allocators of different types
+// can be chosen and swapped while a program runs, as Context does with its allocator stack.
+class DynamicAllocator
+{
+public:
+    virtual ~DynamicAllocator() {}
+    virtual Memory alloc(Size capacity) = 0;
+    virtual bool dealloc(Memory &mem) = 0;
+    virtual bool owns(const Memory &mem) const = 0;
+    virtual bool expand(Memory &mem, Size delta) = 0;
+    virtual bool reallocate(Memory &mem, Size capacity) = 0;
+    void free(Memory &mem) { dealloc(mem); }
+};
+
+// Wraps any allocator in the DynamicAllocator interface. The wrapped allocator must outlive this.
+template <typename Alloc>
+class DynamicAllocatorAdapter : public DynamicAllocator
+{
+public:
+    explicit DynamicAllocatorAdapter(Alloc &alloc) : m_alloc(alloc) {}
+
+    Memory alloc(Size capacity) override { return m_alloc.alloc(capacity); }
+    bool dealloc(Memory &mem) override { return m_alloc.dealloc(mem); }
+    bool owns(const Memory &mem) const override { return m_alloc.owns(mem); }
+    bool expand(Memory &mem, Size delta) override { return m_alloc.expand(mem, delta); }
+    bool reallocate(Memory &mem, Size capacity) override { return m_alloc.reallocate(mem, capacity); }
+
+    Alloc &allocator() { return m_alloc; }
+
+private:
+    Alloc &m_alloc;
+};
+
+// MemoryResourceAdapter ==========================================================================
+
+// Wraps any allocator in the std::pmr::memory_resource interface, so std::pmr containers can
+// allocate from it. Requests aligned to no more than a pointer go to the allocator, and those
+// that need more, which the Memory protocol doesn't promise, go to upstream. When the 
+// allocator fails, allocate() throws std::bad_alloc. The wrapped allocator and upstream must
+// outlive this. Two adapters are equal when they wrap the same allocator.
+//
+// memory_resource only passes back the size that was asked for, not the capacity alloc gave,
+// so the allocator must accept a block back with that size, as GPAllocator, Mallocator and
+// MmapAllocator do. A StatsAllocator wrapped this way overstates bytes_allocated_now by the
+// difference.
+template <typename Alloc>
+class MemoryResourceAdapter : public std::pmr::memory_resource
+{
+public:
+    explicit MemoryResourceAdapter(Alloc &alloc, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) : 
+        m_alloc(alloc), m_upstream(upstream) {}
+
+    Alloc &allocator() { return m_alloc; }
+    std::pmr::memory_resource *upstream() const { return m_upstream; }
+
+private:
+    void *do_allocate(Size bytes, Size alignment) override {
+        if (UNLIKELY(alignment > alignof(void *))) {
+            return m_upstream->allocate(bytes, alignment);
+        }
+        Memory mem = m_alloc.alloc(bytes == 0 ? 1 : bytes);
+        if (UNLIKELY(mem.is_empty())) {
+            throw std::bad_alloc();
+        }
+        return mem.ptr;
+    }
+
+    void do_deallocate(void *ptr, Size bytes, Size alignment) override {
+        if (UNLIKELY(alignment > alignof(void *))) {
+            m_upstream->deallocate(ptr, bytes, alignment);
+            return;
+        }
+        Memory mem(ptr, align_up(bytes == 0 ? 1 : bytes));
+        m_alloc.dealloc(mem);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        auto *adapter = dynamic_cast<const MemoryResourceAdapter *>(&other);
+        return adapter != nullptr && &adapter->m_alloc == &m_alloc;
+    }
+
+    Alloc &m_alloc;
+    std::pmr::memory_resource *m_upstream;
 };
 
 
@@ -32,6 +32,7 @@
 
 #include "Assertions.h"
 #include "Array.h"
+#include "Context.h"
 
 namespace UU {
 
@@ -42,6 +43,7 @@ struct Struct32B { alignas(32) void *X; };
 }  // namespace
 
 static_assert(sizeof(Array<void *, 0>) == sizeof(unsigned) * 2 + sizeof(void *), "wasted space in Array size 0");
+static_assert(sizeof(Array<void *, 0, ContextAllocatorRef>) == sizeof(Array<void *, 0>), "wasted space for a stateless allocator");
 static_assert(alignof(Array<Struct16B, 0>) >= alignof(Struct16B), "wrong alignment for 16-byte aligned T");
 static_assert(alignof(Array<Struct32B, 0>) >= alignof(Struct32B), "wrong alignment for 32-byte aligned T");
 static_assert(sizeof(Array<Struct16B, 0>) >= alignof(Struct16B), "missing padding for 16-byte aligned T");
@@ -98,32 +100,16 @@ static SizeT calculate_new_capacity(SizeT min_size, SizeT t_size, SizeT old_capa
 
 // Note: Moving this function into the header may cause performance regression.
 template <class SizeT>
-void *ArrayBase<SizeT>::allocate_for_grow(SizeT min_size, SizeT t_size, SizeT &new_capacity) 
+SizeT ArrayBase<SizeT>::capacity_for_grow(SizeT min_size) const
 {
-    new_capacity = calculate_new_capacity(min_size, t_size, this->capacity());
-    return malloc(new_capacity * t_size);
+    return calculate_new_capacity(min_size, SizeT(0), this->capacity());
 }
 
-// Note: Moving this function into the header may cause performance regression.
-template <class ArraySizeType>
-void ArrayBase<ArraySizeType>::grow_pod(void *first_element, ArraySizeType min_size, ArraySizeType t_size) 
+template <class SizeT>
+void ArrayBase<SizeT>::report_allocation_failure(Size bytes)
 {
-    ArraySizeType new_capacity = calculate_new_capacity(min_size, t_size, this->capacity());
-    void *base;
-
-    if (this->base() == first_element) {
-        base = malloc(new_capacity * t_size);
-
-        // Copy the elements over.  No need to run dtors on PODs.
-        memcpy(base, this->base(), size() * t_size);
-    } 
-    else {
-        // If this wasn't grown from the inline copy, grow the allocated space.
-        base = realloc(this->base(), new_capacity * t_size);
-    }
-
-    set_base(base);
-    set_capacity(new_capacity);
+    ASSERT_WITH_MESSAGE(false, "Array unable to allocate %lu bytes", bytes);
+    CRASH();
 }
 
 template class UU::ArrayBase<uint32_t>;
@@ -33,8 +33,11 @@
 #ifndef UU_ARRAY_H
 #define UU_ARRAY_H
 
+#include <cstring>
+#include <memory>
 #include <type_traits>
 
+#include <UU/Allocator.h>
 #include <UU/Assertions.h>
 #include <UU/Types.h>
 
@@ -89,12 +92,12 @@ protected:
         m_capacity = capacity;
     }
 
-    // A helper for grow(). Defined out of line to reduce code duplication.
-    void *allocate_for_grow(SizeT min_size, SizeT t_size, SizeT &new_capacity);
+    // The capacity to grow to, with room for at least min_size elements and always at least
+    // one more than now. Defined out of line to reduce code duplication.
+    SizeT capacity_for_grow(SizeT min_size) const;
 
-    // An implementation of grow() for POD types.
-    // Defined out of line to reduce code duplication.
-    void grow_pod(void *first_element, SizeT min_size, SizeT t_size);
+    // Report that the allocator couldn't provide the bytes for a grow.
+    [[noreturn]] static void report_allocation_failure(Size bytes);
 
     // data members
     void *m_base;
@@ -107,16 +110,17 @@ using ArraySizeType =
     typename std::conditional<sizeof(T) < 4 && sizeof(void *) >= 8, uint64_t, uint32_t>::type;
 
 // Figure out the offset of the first element.
-template <class T, typename = void> struct ArrayAlignmentAndSize {
+template <class T, typename AllocatorT> struct ArrayAlignmentAndSize {
     using SizeT = ArraySizeType<T>;
     alignas(ArrayBase<SizeT>) char m_align[sizeof(ArrayBase<SizeT>)];
+    [[no_unique_address]] AllocatorT m_allocator;
     alignas(T) char m_first_element[sizeof(T)];
 };
 
 // This is the part of ArrayTypedBase which does not depend on whether
-// the type T is a POD. The extra dummy template argument avoids
+// the type T is a POD. The allocator template argument also avoids
 // requiring T to be complete.
-template <typename T, typename = void>
+template <typename T, typename AllocatorT>
 class ArrayCommon : public ArrayBase<ArraySizeType<T>> {
     using SizeT = ArraySizeType<T>;
     using ArrayBaseT = ArrayBase<SizeT>;
@@ -125,17 +129,54 @@ class ArrayCommon : public ArrayBase<ArraySizeType<T>> {
     // with small-size of 0 for T with lots of alignment, it's important that
     // ArrayStorage is properly-aligned even for small-size of 0.
     void *first_element() const {
-        auto offset = offsetof(ArrayAlignmentAndSize<T>, m_first_element);
+        using Layout = ArrayAlignmentAndSize<T, AllocatorT>;
+        auto offset = offsetof(Layout, m_first_element);
         auto addr = reinterpret_cast<const char *>(this) + offset;
         return const_cast<void *>(reinterpret_cast<const void *>(addr));
     }
     // Space after 'm_first_element' is clobbered, do not add any instance vars after it.
 
 protected:
-    ArrayCommon(SizeT size) : ArrayBaseT(first_element(), size) {}
+    ArrayCommon(SizeT size, const AllocatorT &allocator) : ArrayBaseT(first_element(), size), m_allocator(allocator) {}
+
+    // Allocate room for capacity elements. Crashes if the allocator can't provide it.
+    void *allocate(SizeT capacity) {
+        Memory mem = m_allocator.alloc(Size(capacity) * sizeof(T));
+        if (UNLIKELY(mem.is_empty())) {
+            ArrayBaseT::report_allocation_failure(Size(capacity) * sizeof(T));
+        }
+        return mem.ptr;
+    }
+
+    // Give back an allocation with room for capacity elements. It goes back with the size
+    // it was asked for, which may be less than the allocator handed out.
+    void deallocate(void *base, SizeT capacity) {
+        Memory mem(base, Size(capacity) * sizeof(T));
+        m_allocator.dealloc(mem);
+    }
+
+    // Grow the allocated memory to new_capacity without moving it, if the allocator can.
+    bool expand_in_place(SizeT new_capacity) {
+        if (is_using_inline_storage()) {
+            return false;
+        }
+        Memory mem(this->base(), Size(this->capacity()) * sizeof(T));
+        if (!m_allocator.expand(mem, Size(new_capacity - this->capacity()) * sizeof(T))) {
+            return false;
+        }
+        this->set_capacity(new_capacity);
+        return true;
+    }
+
+    // An implementation of grow() for POD types.
+    void grow_pod(SizeT min_size);
+
+    bool has_same_allocator(const ArrayCommon &a) const {
+        return m_allocator == a.m_allocator;
+    }
 
-    void grow_pod(SizeT min_size, SizeT t_size) {
-        ArrayBaseT::grow_pod(first_element(), min_size, t_size);
+    void swap_allocator(ArrayCommon &a) {
+        std::swap(m_allocator, a.m_allocator);
     }
 
     // Return true if the array is using its inline storage and false 
@@ -263,6 +304,8 @@ public:
     using ArrayBaseT::is_empty;
     using ArrayBaseT::size;
 
+    const AllocatorT &allocator() const { return m_allocator; }
+
     iterator begin() { return (iterator)this->base(); }
     const_iterator begin() const { return (const_iterator)this->base(); }
     iterator end() { return begin() + size(); }
@@ -309,8 +352,39 @@ public:
         ASSERT(!is_empty());
         return end()[-1];
     }
+
+private:
+    [[no_unique_address]] AllocatorT m_allocator;
+    // Space after this is the first element. Do not add any instance vars after it.
 };
 
+// Define out-of-line to dissuade the C++ compiler from inlining it.
+template <typename T, typename AllocatorT>
+UU_NEVER_INLINE void ArrayCommon<T, AllocatorT>::grow_pod(ArraySizeType<T> min_size) 
+{
+    SizeT new_capacity = this->capacity_for_grow(min_size);
+    if (!this->is_using_inline_storage()) {
+        // Grow in place if the allocator can, and otherwise let it move the block. 
+        // For Mallocator, that's realloc.
+        Memory mem(this->base(), Size(this->capacity()) * sizeof(T));
+        Size new_bytes = Size(new_capacity) * sizeof(T);
+        if (m_allocator.expand(mem, new_bytes - mem.capacity) || m_allocator.reallocate(mem, new_bytes)) {
+            this->set_base(mem.ptr);
+            this->set_capacity(new_capacity);
+            return;
+        }
+    }
+
+    // Copy the elements over.  No need to run dtors on PODs.
+    void *base = allocate(new_capacity);
+    memcpy(base, this->base(), this->size() * sizeof(T));
+    if (!this->is_using_inline_storage()) {
+        deallocate(this->base(), this->capacity());
+    }
+    this->set_base(base);
+    this->set_capacity(new_capacity);
+}
+
 // ArrayTypedBase<TriviallyCopyable = false> - This is where we put
 // method implementations that are designed to work with non-trivial T's.
 //
@@ -319,19 +393,22 @@ public:
 // copy these types with memcpy, there is no way for the type to observe this.
 // This catches the important case of std::pair<POD, POD>, which is not
 // trivially assignable.
-template <typename T, bool = (std::is_trivially_copy_constructible<T>::value) &&
-                             (std::is_trivially_move_constructible<T>::value) &&
-                             std::is_trivially_destructible<T>::value>
-class ArrayTypedBase : public ArrayCommon<T> 
+template <typename T, typename AllocatorT, bool = (std::is_trivially_copy_constructible<T>::value) &&
+                                                 (std::is_trivially_move_constructible<T>::value) &&
+                                                 std::is_trivially_destructible<T>::value>
+class ArrayTypedBase : public ArrayCommon<T, AllocatorT> 
 {
-    friend class ArrayCommon<T>;
+    friend class ArrayCommon<T, AllocatorT>;
 
 protected:
     static constexpr bool TakesElementsByValue = false;
     using SizeT = ArraySizeType<T>;
     using ElementT = const T &;
 
-    ArrayTypedBase(SizeT size) : ArrayCommon<T>(size) {}
+    // True if elements can be moved to new storage with memcpy, as POD elements are.
+    static constexpr bool Relocatable = IsTriviallyRelocatable<T>;
+
+    ArrayTypedBase(SizeT size, const AllocatorT &allocator) : ArrayCommon<T, AllocatorT>(size, allocator) {}
 
     static void call_destructors_on_range(T *start, T *end) {
         while (start != end) {
@@ -362,8 +439,8 @@ protected:
     // Allocate enough for min_size and pass back its size in new_capacity. 
     // This is the first step of grow().
     T *allocate_for_grow(SizeT min_size, SizeT &new_capacity) {
-        using A = ArrayBase<SizeT>;
-        return static_cast<T *>(A::allocate_for_grow(min_size, sizeof(T), new_capacity));
+        new_capacity = this->capacity_for_grow(min_size);
+        return static_cast<T *>(this->allocate(new_capacity));
     }
 
     // Move existing elements over to the newly-allocated elements, the middle step of grow().
@@ -427,27 +504,43 @@ public:
 };
 
 // Define out-of-line to dissuade the C++ compiler from inlining it.
-template <typename T, bool TriviallyCopyable>
-void ArrayTypedBase<T, TriviallyCopyable>::grow(ArraySizeType<T> min_size) {
-    ArraySizeType<T> new_capacity;
-    T *new_elements = allocate_for_grow(min_size, new_capacity);
+template <typename T, typename AllocatorT, bool TriviallyCopyable>
+void ArrayTypedBase<T, AllocatorT, TriviallyCopyable>::grow(ArraySizeType<T> min_size) {
+    // relocatable elements can grow like POD elements, realloc and all
+    if constexpr (Relocatable) {
+        this->grow_pod(min_size);
+        return;
+    }
+
+    // growing in place needs no moves at all
+    ArraySizeType<T> new_capacity = this->capacity_for_grow(min_size);
+    if (this->expand_in_place(new_capacity)) {
+        return;
+    }
+    T *new_elements = static_cast<T *>(this->allocate(new_capacity));
     move_elements_for_grow(new_elements);
     transfer_allocation_for_grow(new_elements, new_capacity);
 }
 
 // Define out-of-line to dissuade the C++ compiler from inlining it.
-template <typename T, bool TriviallyCopyable>
-void ArrayTypedBase<T, TriviallyCopyable>::move_elements_for_grow(T *new_elements) {
+template <typename T, typename AllocatorT, bool TriviallyCopyable>
+void ArrayTypedBase<T, AllocatorT, TriviallyCopyable>::move_elements_for_grow(T *new_elements) {
+    if constexpr (Relocatable) {
+        if (this->not_empty()) {
+            memcpy(reinterpret_cast<void *>(new_elements), this->begin(), this->size() * sizeof(T));
+        }
+        return;
+    }
     this->uninitialized_move(this->begin(), this->end(), new_elements);
     call_destructors_on_range(this->begin(), this->end());
 }
 
 // Define this out-of-line to dissuade the C++ compiler from inlining it.
-template <typename T, bool TriviallyCopyable>
-void ArrayTypedBase<T, TriviallyCopyable>::transfer_allocation_for_grow(T *new_elements, ArraySizeType<T> new_capacity) {
+template <typename T, typename AllocatorT, bool TriviallyCopyable>
+void ArrayTypedBase<T, AllocatorT, TriviallyCopyable>::transfer_allocation_for_grow(T *new_elements, ArraySizeType<T> new_capacity) {
     // If this wasn't grown from the inline copy, deallocate the old space.
     if (!this->is_using_inline_storage()) {
-        free(this->begin());
+        this->deallocate(this->begin(), this->capacity());
     }
     this->set_base(new_elements);
     this->set_capacity(new_capacity);
@@ -456,9 +549,9 @@ void ArrayTypedBase<T, TriviallyCopyable>::transfer_allocation_for_grow(T *new_e
 // ArrayTypedBase<TriviallyCopyable = true> - These are the method implementations 
 // designed to work with trivially copyable T's, allowing use of memcpy instead of 
 // calling copy/move constructors and non-trivial destructors.
-template <typename T>
-class ArrayTypedBase<T, true> : public ArrayCommon<T> {
-    friend class ArrayCommon<T>;
+template <typename T, typename AllocatorT>
+class ArrayTypedBase<T, AllocatorT, true> : public ArrayCommon<T, AllocatorT> {
+    friend class ArrayCommon<T, AllocatorT>;
 
 protected:
     using SizeT = ArraySizeType<T>;
@@ -471,7 +564,7 @@ protected:
     // parameters by value.
     using ElementT = typename std::conditional<TakesElementsByValue, T, const T &>::type;
 
-    ArrayTypedBase(SizeT size) : ArrayCommon<T>(size) {}
+    ArrayTypedBase(SizeT size, const AllocatorT &allocator) : ArrayCommon<T, AllocatorT>(size, allocator) {}
 
     // No need to do a destroy loop for trivial elements.
     static void call_destructors_on_range(T *, T *) {}
@@ -507,7 +600,7 @@ protected:
 
     // Double the size of the allocated memory, guaranteeing space for at
     // least one more element or min_size if specified.
-    void grow(SizeT min_size = 0) { this->grow_pod(min_size, sizeof(T)); }
+    void grow(SizeT min_size = 0) { this->grow_pod(min_size); }
 
     // Reserve enough space to add one element, and return the updated element
     // pointer in case it was a reference to the storage.
@@ -551,10 +644,10 @@ public:
 
 // Common code factored out of the Array class to reduce code duplication 
 // based on the Array 'N' template parameter.
-template <typename T>
-class ArrayForm : public ArrayTypedBase<T> 
+template <typename T, typename AllocatorT = Mallocator>
+class ArrayForm : public ArrayTypedBase<T, AllocatorT> 
 {
-    using SuperClass = ArrayTypedBase<T>;
+    using SuperClass = ArrayTypedBase<T, AllocatorT>;
 
 public:
     using iterator = typename SuperClass::iterator;
@@ -565,16 +658,18 @@ public:
         "sizeof(SizeT) must equal sizeof(ArraySizeType<T>)");
 
 protected:
-    using ArrayTypedBase<T>::TakesElementsByValue;
+    using SuperClass::TakesElementsByValue;
     using ElementT = typename SuperClass::ElementT;
 
     // Default ctor - Initialize to is_empty.
-    explicit ArrayForm(unsigned N) : ArrayTypedBase<T>(N) {}
+    explicit ArrayForm(unsigned N, const AllocatorT &allocator = AllocatorT()) : SuperClass(N, allocator) {}
 
+    // Take over a's allocated buffer. It must be able to go back to this array's allocator.
     void assign_remote(ArrayForm &&a) {
+        ASSERT(this->has_same_allocator(a));
         this->call_destructors_on_range(this->begin(), this->end());
         if (!this->is_using_inline_storage()) {
-            free(this->begin());
+            this->deallocate(this->begin(), this->capacity());
         }
         this->set_base(a.base());
         // essential to set capacity before size to prevent asserts from firing
@@ -590,7 +685,7 @@ public:
         // Subclass has already destructed this array's elements.
         // If this wasn't grown from the inline copy, deallocate the old space.
         if (!this->is_using_inline_storage()) {
-            free(this->begin());
+            this->deallocate(this->begin(), this->capacity());
         }
     }
 
@@ -739,6 +834,13 @@ public:
         // Drop the last element.
         // Return an iterator to the position passed in.
         iterator result_it = it;
+        if constexpr (IsTriviallyRelocatable<T>) {
+            // destroy the element, then slide the bytes of the rest over it
+            it->~T();
+            memmove(reinterpret_cast<void *>(it), it + 1, (this->end() - (it + 1)) * sizeof(T));
+            this->decrement_size();
+            return result_it;
+        }
         std::move(it + 1, this->end(), it);
         this->pop_back();
         return result_it;
@@ -756,6 +858,13 @@ public:
         // Drop the elements in the range.
         // Return an iterator to the position passed in.
         iterator result_it = begin_it;
+        if constexpr (IsTriviallyRelocatable<T>) {
+            // destroy the range, then slide the bytes of the rest over it
+            this->call_destructors_on_range(begin_it, end_it);
+            memmove(reinterpret_cast<void *>(begin_it), end_it, (this->end() - end_it) * sizeof(T));
+            this->set_size(SizeT(this->size() - (end_it - begin_it)));
+            return result_it;
+        }
         iterator it = std::move(end_it, this->end(), begin_it);
         this->call_destructors_on_range(it, this->end());
         this->set_size(SizeT(it - this->begin()));
@@ -963,8 +1072,8 @@ public:
     bool operator>=(const ArrayForm &a) const { return !(*this < a); }
 };
 
-template <typename T>
-void ArrayForm<T>::swap(ArrayForm<T> &a) 
+template <typename T, typename AllocatorT>
+void ArrayForm<T, AllocatorT>::swap(ArrayForm<T, AllocatorT> &a) 
 {
     using SizeT = ArraySizeType<T>;
 
@@ -978,13 +1087,17 @@ void ArrayForm<T>::swap(ArrayForm<T> &a)
         this->set_base(a.base());
         a.set_base(base_tmp);
         
+        // capacities first, since set_size checks against them
+        SizeT capacity_tmp = this->capacity();
+        this->set_capacity(a.capacity());
+        a.set_capacity(capacity_tmp);
+
         SizeT size_tmp = this->size();
         this->set_size(a.size());
         a.set_size(size_tmp);
 
-        SizeT capacity_tmp = this->capacity();
-        this->set_capacity(a.capacity());
-        a.set_capacity(capacity_tmp);
+        // buffers move with the allocators that own them
+        this->swap_allocator(a);
         return;
     }
 
@@ -1016,8 +1129,8 @@ void ArrayForm<T>::swap(ArrayForm<T> &a)
     }
 }
 
-template <typename T>
-ArrayForm<T> &ArrayForm<T>::operator=(const ArrayForm<T> &a) 
+template <typename T, typename AllocatorT>
+ArrayForm<T, AllocatorT> &ArrayForm<T, AllocatorT>::operator=(const ArrayForm<T, AllocatorT> &a) 
 {
     using SizeT = ArraySizeType<T>;
 
@@ -1067,8 +1180,8 @@ ArrayForm<T> &ArrayForm<T>::operator=(const ArrayForm<T> &a)
     return *this;
 }
 
-template <typename T>
-ArrayForm<T> &ArrayForm<T>::operator=(ArrayForm<T> &&a) 
+template <typename T, typename AllocatorT>
+ArrayForm<T, AllocatorT> &ArrayForm<T, AllocatorT>::operator=(ArrayForm<T, AllocatorT> &&a) 
 {
     using SizeT = ArraySizeType<T>;
 
@@ -1077,8 +1190,9 @@ ArrayForm<T> &ArrayForm<T>::operator=(ArrayForm<T> &&a)
     }
 
     // If passed-in array isn't using inline storage, clear this array
-    // and steal the passed-in array's buffer.
-    if (!a.is_using_inline_storage()) {
+    // and steal the passed-in array's buffer, as long as it can go back
+    // to this array's allocator.
+    if (!a.is_using_inline_storage() && this->has_same_allocator(a)) {
         this->assign_remote(std::move(a));
         return *this;
     }
@@ -1138,7 +1252,7 @@ template <typename T> struct alignas(T) ArrayStorage<T, 0> {};
 
 // Forward declaration of Array so that CalculateArrayDefaultInlinedElements 
 // can reference sizeof(Array<T, 0>).
-template <typename T, unsigned N> class Array;
+template <typename T, unsigned N, typename AllocatorT> class Array;
 
 // Helper class for calculating the default number of inline elements for Array<T>.
 //
@@ -1179,7 +1293,7 @@ template <typename T> struct CalculateArrayDefaultInlinedElements
 
     // Discount the size of the header itself when calculating the maximum inline
     // bytes.
-    static constexpr size_t PreferredInlineBytes = ArrayPreferredArraySize - sizeof(Array<T, 0>);
+    static constexpr size_t PreferredInlineBytes = ArrayPreferredArraySize - sizeof(Array<T, 0, Mallocator>);
     static constexpr size_t NumElementsThatFit = PreferredInlineBytes / sizeof(T);
     static constexpr size_t value = NumElementsThatFit == 0 ? 1 : NumElementsThatFit;
 };
@@ -1196,69 +1310,83 @@ template <typename T> struct CalculateArrayDefaultInlinedElements
 //
 // Not exception safe.
 //
+// Storage beyond the inline elements comes from AllocatorT, a handle with alloc, dealloc,
+// expand and reallocate, like Mallocator, ContextAllocatorRef or AllocatorRef<Alloc>. The
+// default, Mallocator, takes no space and uses malloc and realloc. A stateful handle like 
+// AllocatorRef<ArenaAllocator> ties the array to one allocator, so it can be freed along with
+// everything else allocated there. Copies and moves carry the handle along, and an array 
+// only takes over another's buffer when their allocators are equal.
+//
+// Elements of types marked IsTriviallyRelocatable, like String, grow and erase with memcpy, 
+// memmove and realloc, rather than a move and a destructor call for each element.
+//
 // This class is based (mightily) on SmallVector.h from the LLVM project. 
 // See their documentation:
 // https://llvm.org/docs/ProgrammersManual.html#llvm-adt-smallvector-h
 //
-template <typename T, unsigned N = CalculateArrayDefaultInlinedElements<T>::value>
-class Array : public ArrayForm<T>, ArrayStorage<T, N> 
+template <typename T, unsigned N = CalculateArrayDefaultInlinedElements<T>::value, typename AllocatorT = Mallocator>
+class Array : public ArrayForm<T, AllocatorT>, ArrayStorage<T, N> 
 {
+    using Form = ArrayForm<T, AllocatorT>;
+
 public:
     using SizeT = ArraySizeType<T>;
 
-    Array() : ArrayForm<T>(N) {}
+    Array() : Form(N) {}
+
+    explicit Array(const AllocatorT &allocator) : Form(N, allocator) {}
 
     ~Array() {
         this->call_destructors_on_range(this->begin(), this->end());
     }
 
-    explicit Array(SizeT size, const T &Value = T()) : ArrayForm<T>(N) {
+    explicit Array(SizeT size, const T &Value = T(), const AllocatorT &allocator = AllocatorT()) : Form(N, allocator) {
         this->assign(size, Value);
     }
 
     template <typename I, typename = std::enable_if_t<IsInputIteratorCategory<I>>>
-        Array(I begin_it, I end_it) : ArrayForm<T>(N) {
+        Array(I begin_it, I end_it) : Form(N) {
         this->append(begin_it, end_it);
     }
 
     template <typename IR>
-    explicit Array(const iterator_range<IR> &R) : ArrayForm<T>(N) {
+    explicit Array(const iterator_range<IR> &R) : Form(N) {
         this->append(R.begin(), R.end());
     }
 
-    Array(std::initializer_list<T> il) : ArrayForm<T>(N) {
+    Array(std::initializer_list<T> il, const AllocatorT &allocator = AllocatorT()) : Form(N, allocator) {
         this->assign(il);
     }
 
-    Array(const Array &a) : ArrayForm<T>(N) {
+    Array(const Array &a) : Form(N, a.allocator()) {
         if (!a.is_empty()) {
-            ArrayForm<T>::operator=(a);
+            Form::operator=(a);
         }
     }
 
     Array &operator=(const Array &a) {
-        ArrayForm<T>::operator=(a);
+        Form::operator=(a);
         return *this;
     }
 
-    Array(Array &&a) : ArrayForm<T>(N) {
+    Array(Array &&a) : Form(N, a.allocator()) {
         if (!a.is_empty()) {
-            ArrayForm<T>::operator=(::std::move(a));
+            Form::operator=(::std::move(a));
         }
     }
 
-    Array(ArrayForm<T> &&a) : ArrayForm<T>(N) {
+    Array(Form &&a) : Form(N, a.allocator()) {
         if (!a.is_empty()) {
-            ArrayForm<T>::operator=(::std::move(a));
+            Form::operator=(::std::move(a));
         }
     }
 
     Array &operator=(Array &&a) {
         if (N) {
-            ArrayForm<T>::operator=(::std::move(a));
+            Form::operator=(::std::move(a));
             return *this;
         }
-        // ArrayForm<T>::operator= does not leverage N==0. Optimize the case.
+        // Form::operator= does not leverage N==0. Optimize the case.
         if (this == &a) {
             return *this;
         }
@@ -1266,14 +1394,17 @@ public:
             this->call_destructors_on_range(this->begin(), this->end());
             this->set_size(0);
         } 
-        else {
+        else if (this->has_same_allocator(a)) {
             this->assign_remote(std::move(a));
         }
+        else {
+            Form::operator=(::std::move(a));
+        }
         return *this;
     }
 
-    Array &operator=(ArrayForm<T> &&a) {
-        ArrayForm<T>::operator=(::std::move(a));
+    Array &operator=(Form &&a) {
+        Form::operator=(::std::move(a));
         return *this;
     }
 
@@ -1283,8 +1414,8 @@ public:
     }
 };
 
-template <typename T, unsigned N>
-UU_ALWAYS_INLINE size_t capacity_in_bytes(const Array<T, N> &a) {
+template <typename T, unsigned N, typename AllocatorT>
+UU_ALWAYS_INLINE size_t capacity_in_bytes(const Array<T, N, AllocatorT> &a) {
     return a.capacity_in_bytes();
 }
 
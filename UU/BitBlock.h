@@ -25,6 +25,7 @@
 #ifndef UU_BIT_BLOCK_H
 #define UU_BIT_BLOCK_H
 
+#include <atomic>
 #include <bit>
 
 #include <UU/Assertions.h>
@@ -133,6 +134,209 @@ private:
     UInt64 m_block;
 };
 
+// A BitBlock of C sub-blocks with a summary on top: one bit per sub-block, set when that
+// sub-block is full, along with a count of set bits. Finding the first clear bit looks at one
+// summary word and then one sub-block, and is_full(), is_empty() and count() read the count,
+// so all of these stay O(1) at 4096 bits. Beyond that, peek() scans one summary word per
+// 4096 bits.
+template <Size C> requires IsGreaterThanZero<C>
+class HierarchicalBitBlock {
+public:
+    static constexpr Size BlockCount = C;
+    static constexpr Size SummaryCount = (C + BitBlockBitsPerSubBlock - 1) / BitBlockBitsPerSubBlock;
+
+    constexpr HierarchicalBitBlock() { reset(); }
+
+    constexpr Size bits() const { return BlockCount * BitBlockBitsPerSubBlock; }
+    constexpr Size size() const { return bits(); }
+
+    constexpr void fill() { 
+        for (Size blk = 0; blk < BlockCount; blk++) {
+            m_blocks[blk] = UInt64Max;
+        }
+        for (Size s = 0; s < SummaryCount; s++) {
+            m_full[s] = UInt64Max;
+        }
+        m_count = bits();
+    }
+
+    constexpr void set(Size idx) { 
+        ASSERT(idx < bits());
+        Size blk = idx >> BitBlockBitShift;
+        UInt64 mask = UInt64(1) << (idx & (BitBlockBitsPerSubBlock - 1));
+        if (m_blocks[blk] & mask) {
+            return;
+        }
+        m_blocks[blk] |= mask;
+        m_count++;
+        if (m_blocks[blk] == UInt64Max) {
+            m_full[blk >> BitBlockBitShift] |= UInt64(1) << (blk & (BitBlockBitsPerSubBlock - 1));
+        }
+    }
+
+    constexpr void clear(Size idx) { 
+        ASSERT(idx < bits());
+        Size blk = idx >> BitBlockBitShift;
+        UInt64 mask = UInt64(1) << (idx & (BitBlockBitsPerSubBlock - 1));
+        if ((m_blocks[blk] & mask) == 0) {
+            return;
+        }
+        m_blocks[blk] &= ~mask;
+        m_count--;
+        m_full[blk >> BitBlockBitShift] &= ~(UInt64(1) << (blk & (BitBlockBitsPerSubBlock - 1)));
+    }
+
+    constexpr bool test(Size idx) const { 
+        ASSERT(idx < bits());
+        return m_blocks[idx >> BitBlockBitShift] & (UInt64(1) << (idx & (BitBlockBitsPerSubBlock - 1)));
+    }
+
+    constexpr void reset() { 
+        for (Size blk = 0; blk < BlockCount; blk++) {
+            m_blocks[blk] = 0;
+        }
+        for (Size s = 0; s < SummaryCount; s++) {
+            m_full[s] = 0;
+        }
+        // summary bits past the last sub-block read as full, so peek() never picks them
+        if constexpr (BlockCount % BitBlockBitsPerSubBlock != 0) {
+            m_full[SummaryCount - 1] = UInt64Max << (BlockCount % BitBlockBitsPerSubBlock);
+        }
+        m_count = 0;
+    }
+
+    constexpr bool is_empty() const { return m_count == 0; }
+    constexpr bool not_empty() const { return !is_empty(); }
+    constexpr bool is_full() const { return m_count == bits(); }
+    constexpr bool not_full() const { return !is_full(); }
+    constexpr UInt32 count() const { return static_cast<UInt32>(m_count); }
+
+    constexpr UInt32 peek() const { 
+        for (Size s = 0; s < SummaryCount; s++) {
+            if (m_full[s] != UInt64Max) {
+                Size blk = (s * BitBlockBitsPerSubBlock) + std::countr_one(m_full[s]);
+                return static_cast<UInt32>((blk * BitBlockBitsPerSubBlock) + std::countr_one(m_blocks[blk]));
+            }
+        }
+        return -1; 
+    }
+
+    constexpr UInt32 take() { 
+        ASSERT(not_full());
+        UInt32 idx = peek();
+        set(idx);
+        return idx;
+    }
+
+private:
+    UInt64 m_blocks[BlockCount];
+    UInt64 m_full[SummaryCount];
+    Size m_count = 0;
+};
+
+// A BitBlock that many threads can set, clear and take bits from at once, with no lock. take()
+// claims a clear bit with a compare-and-swap on its word, starting from a word the caller 
+// picks, so threads that start in different places seldom contend. Since bits can change
+// while they are being read, is_empty(), is_full() and count() are only snapshots, and
+// take() returns -1 rather than asserting when it finds no clear bit.
+//
+// Clearing a bit releases, and taking it acquires, so whatever a thread wrote to a slot before
+// clearing its bit is visible to the thread that takes it next.
+template <Size C> requires IsGreaterThanZero<C>
+class AtomicBitBlock {
+public:
+    static constexpr Size BlockCount = C;
+
+    AtomicBitBlock() { reset(); }
+
+    AtomicBitBlock(const AtomicBitBlock &) = delete;
+    AtomicBitBlock &operator=(const AtomicBitBlock &) = delete;
+
+    constexpr Size bits() const { return BlockCount * BitBlockBitsPerSubBlock; }
+    constexpr Size size() const { return bits(); }
+
+    void fill() { 
+        for (Size blk = 0; blk < BlockCount; blk++) {
+            m_blocks[blk].store(UInt64Max, std::memory_order_relaxed);
+        }
+    }
+
+    void reset() { 
+        for (Size blk = 0; blk < BlockCount; blk++) {
+            m_blocks[blk].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns whether the bit was clear before.
+    bool set(Size idx) { 
+        ASSERT(idx < bits());
+        UInt64 mask = mask_for(idx);
+        return (m_blocks[idx >> BitBlockBitShift].fetch_or(mask, std::memory_order_acq_rel) & mask) == 0;
+    }
+
+    // Returns whether the bit was set before.
+    bool clear(Size idx) { 
+        ASSERT(idx < bits());
+        UInt64 mask = mask_for(idx);
+        return (m_blocks[idx >> BitBlockBitShift].fetch_and(~mask, std::memory_order_release) & mask) != 0;
+    }
+
+    bool test(Size idx) const { 
+        ASSERT(idx < bits());
+        return m_blocks[idx >> BitBlockBitShift].load(std::memory_order_acquire) & mask_for(idx);
+    }
+
+    bool is_empty() const { 
+        for (Size blk = 0; blk < BlockCount; blk++) {
+            if (m_blocks[blk].load(std::memory_order_relaxed) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool not_empty() const { return !is_empty(); }
+
+    bool is_full() const { 
+        for (Size blk = 0; blk < BlockCount; blk++) {
+            if (m_blocks[blk].load(std::memory_order_relaxed) != UInt64Max) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool not_full() const { return !is_full(); }
+
+    UInt32 count() const { 
+        UInt32 c = 0;
+        for (Size blk = 0; blk < BlockCount; blk++) {
+            c += std::popcount(m_blocks[blk].load(std::memory_order_relaxed));
+        }
+        return c;
+    }
+
+    // Sets the first clear bit found searching from sub-block start, wrapping around, and 
+    // returns its index, or -1 if every bit was set.
+    UInt32 take(Size start = 0) { 
+        for (Size n = 0; n < BlockCount; n++) {
+            Size blk = (start + n) % BlockCount;
+            UInt64 word = m_blocks[blk].load(std::memory_order_relaxed);
+            while (word != UInt64Max) {
+                UInt64 bit = std::countr_one(word);
+                if (m_blocks[blk].compare_exchange_weak(word, word | (UInt64(1) << bit), 
+                    std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return static_cast<UInt32>((blk * BitBlockBitsPerSubBlock) + bit);
+                }
+            }
+        }
+        return -1; 
+    }
+
+private:
+    static constexpr UInt64 mask_for(Size idx) { return UInt64(1) << (idx & (BitBlockBitsPerSubBlock - 1)); }
+
+    std::atomic<UInt64> m_blocks[BlockCount];
+};
+
 }  // namespace UU
 
 #endif // UU_BIT_BLOCK_H
@@ -0,0 +1,651 @@
+//
+// ByteSearch.cpp
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <bit>
+#include <cstring>
+
+#include "ByteSearch.h"
+#include "Compiler.h"
+#include "Platform.h"
+
+#if defined(__AVX2__) || CPU(X86_SSE2)
+#include <immintrin.h>
+#define UU_BYTE_SEARCH_SIMD 1
+#if defined(__AVX2__) || defined(__SSSE3__)
+#define UU_BYTE_SEARCH_SHUFFLE 1
+#endif
+#elif CPU(ARM64)
+#include <arm_neon.h>
+#define UU_BYTE_SEARCH_SIMD 1
+#define UU_BYTE_SEARCH_SHUFFLE 1
+#endif
+
+namespace UU {
+
+#if UU_BYTE_SEARCH_SIMD
+
+// Lanes =========================================================================================
+
+// One SIMD register of bytes. mask() turns a comparison result into an integer with the bits
+// in LaneBits set for each matching lane, Stride bits apart, so bit scans find lanes.
+struct Lanes
+{
+#if defined(__AVX2__)
+    using Reg = __m256i;
+    static constexpr Size Width = 32;
+    static constexpr int Stride = 1;
+    static constexpr UInt64 LaneBits = UInt64Max;
+
+    static UU_ALWAYS_INLINE Reg splat(char c) { return _mm256_set1_epi8(c); }
+    static UU_ALWAYS_INLINE Reg load(const char *ptr) { return _mm256_loadu_si256(reinterpret_cast<const Reg *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg eq(Reg a, Reg b) { return _mm256_cmpeq_epi8(a, b); }
+    static UU_ALWAYS_INLINE Reg both(Reg a, Reg b) { return _mm256_and_si256(a, b); }
+    static UU_ALWAYS_INLINE UInt64 mask(Reg r) { return UInt32(_mm256_movemask_epi8(r)); }
+    static constexpr UInt64 AllLanes = UInt32Max;
+
+    static UU_ALWAYS_INLINE void store(char *ptr, Reg r) { _mm256_storeu_si256(reinterpret_cast<Reg *>(ptr), r); }
+    static UU_ALWAYS_INLINE Reg flip(Reg a, Reg b) { return _mm256_xor_si256(a, b); }
+    static UU_ALWAYS_INLINE Reg in_range(Reg r, char lo, char hi) { 
+        // shifted so the range starts at the lowest signed byte, since there's only a signed compare
+        Reg shifted = _mm256_sub_epi8(r, _mm256_set1_epi8(char(UInt8(lo) + 128)));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8(char(-128 + (hi - lo + 1))), shifted); 
+    }
+    static UU_ALWAYS_INLINE Reg either(Reg a, Reg b) { return _mm256_or_si256(a, b); }
+    static UU_ALWAYS_INLINE Reg none() { return _mm256_setzero_si256(); }
+    static UU_ALWAYS_INLINE Reg table(const UInt8 *ptr) { 
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr))); 
+    }
+    static UU_ALWAYS_INLINE Reg low_nibbles(Reg r) { return _mm256_and_si256(r, _mm256_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg high_nibbles(Reg r) { return _mm256_and_si256(_mm256_srli_epi16(r, 4), _mm256_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg lookup(Reg table, Reg nibbles) { return _mm256_shuffle_epi8(table, nibbles); }
+    static UU_ALWAYS_INLINE Reg select(Reg mask, Reg a, Reg b) { return _mm256_blendv_epi8(b, a, mask); }
+#elif CPU(X86_SSE2)
+    using Reg = __m128i;
+    static constexpr Size Width = 16;
+    static constexpr int Stride = 1;
+    static constexpr UInt64 LaneBits = UInt64Max;
+
+    static UU_ALWAYS_INLINE Reg splat(char c) { return _mm_set1_epi8(c); }
+    static UU_ALWAYS_INLINE Reg load(const char *ptr) { return _mm_loadu_si128(reinterpret_cast<const Reg *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg eq(Reg a, Reg b) { return _mm_cmpeq_epi8(a, b); }
+    static UU_ALWAYS_INLINE Reg both(Reg a, Reg b) { return _mm_and_si128(a, b); }
+    static UU_ALWAYS_INLINE UInt64 mask(Reg r) { return UInt16(_mm_movemask_epi8(r)); }
+    static constexpr UInt64 AllLanes = UInt16Max;
+
+    static UU_ALWAYS_INLINE void store(char *ptr, Reg r) { _mm_storeu_si128(reinterpret_cast<Reg *>(ptr), r); }
+    static UU_ALWAYS_INLINE Reg flip(Reg a, Reg b) { return _mm_xor_si128(a, b); }
+    static UU_ALWAYS_INLINE Reg in_range(Reg r, char lo, char hi) { 
+        // shifted so the range starts at the lowest signed byte, since there's only a signed compare
+        Reg shifted = _mm_sub_epi8(r, _mm_set1_epi8(char(UInt8(lo) + 128)));
+        return _mm_cmplt_epi8(shifted, _mm_set1_epi8(char(-128 + (hi - lo + 1)))); 
+    }
+    static UU_ALWAYS_INLINE Reg either(Reg a, Reg b) { return _mm_or_si128(a, b); }
+    static UU_ALWAYS_INLINE Reg none() { return _mm_setzero_si128(); }
+#if defined(__SSSE3__)
+    static UU_ALWAYS_INLINE Reg table(const UInt8 *ptr) { return _mm_loadu_si128(reinterpret_cast<const Reg *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg low_nibbles(Reg r) { return _mm_and_si128(r, _mm_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg high_nibbles(Reg r) { return _mm_and_si128(_mm_srli_epi16(r, 4), _mm_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg lookup(Reg table, Reg nibbles) { return _mm_shuffle_epi8(table, nibbles); }
+    static UU_ALWAYS_INLINE Reg select(Reg mask, Reg a, Reg b) { 
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); 
+    }
+#endif
+#else
+    // NEON has no movemask, but narrowing each 16-bit pair of lanes by 4 bits leaves 4 bits 
+    // per byte, and keeping the top one of each makes a mask with one bit per lane.
+    using Reg = uint8x16_t;
+    static constexpr Size Width = 16;
+    static constexpr int Stride = 4;
+    static constexpr UInt64 LaneBits = 0x8888888888888888ULL;
+
+    static UU_ALWAYS_INLINE Reg splat(char c) { return vdupq_n_u8(UInt8(c)); }
+    static UU_ALWAYS_INLINE Reg load(const char *ptr) { return vld1q_u8(reinterpret_cast<const UInt8 *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg eq(Reg a, Reg b) { return vceqq_u8(a, b); }
+    static UU_ALWAYS_INLINE Reg both(Reg a, Reg b) { return vandq_u8(a, b); }
+    static UU_ALWAYS_INLINE UInt64 mask(Reg r) { 
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(r), 4)), 0) & LaneBits; 
+    }
+    static constexpr UInt64 AllLanes = LaneBits;
+
+    static UU_ALWAYS_INLINE void store(char *ptr, Reg r) { vst1q_u8(reinterpret_cast<UInt8 *>(ptr), r); }
+    static UU_ALWAYS_INLINE Reg flip(Reg a, Reg b) { return veorq_u8(a, b); }
+    static UU_ALWAYS_INLINE Reg in_range(Reg r, char lo, char hi) { 
+        return vcleq_u8(vsubq_u8(r, vdupq_n_u8(UInt8(lo))), vdupq_n_u8(UInt8(hi - lo))); 
+    }
+    static UU_ALWAYS_INLINE Reg either(Reg a, Reg b) { return vorrq_u8(a, b); }
+    static UU_ALWAYS_INLINE Reg none() { return vdupq_n_u8(0); }
+    static UU_ALWAYS_INLINE Reg table(const UInt8 *ptr) { return vld1q_u8(ptr); }
+    static UU_ALWAYS_INLINE Reg low_nibbles(Reg r) { return vandq_u8(r, vdupq_n_u8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg high_nibbles(Reg r) { return vshrq_n_u8(r, 4); }
+    static UU_ALWAYS_INLINE Reg lookup(Reg table, Reg nibbles) { return vqtbl1q_u8(table, nibbles); }
+    static UU_ALWAYS_INLINE Reg select(Reg mask, Reg a, Reg b) { return vbslq_u8(mask, a, b); }
+#endif
+
+    static UU_ALWAYS_INLINE Size first_lane(UInt64 mask) { return std::countr_zero(mask) / Stride; }
+    static UU_ALWAYS_INLINE Size last_lane(UInt64 mask) { return (63 - std::countl_zero(mask)) / Stride; }
+    static UU_ALWAYS_INLINE UInt64 clear_first_lane(UInt64 mask) { return mask & (mask - 1); }
+    static UU_ALWAYS_INLINE UInt64 clear_last_lane(UInt64 mask) { return mask & ~(UInt64(1) << (63 - std::countl_zero(mask))); }
+};
+
+// The lanes of the block at ptr that equal c.
+static UU_ALWAYS_INLINE UInt64 byte_mask(const char *ptr, Lanes::Reg c)
+{
+    return Lanes::mask(Lanes::eq(Lanes::load(ptr), c));
+}
+
+// The lanes of the block of candidate positions at ptr whose first and last bytes match the needle's.
+static UU_ALWAYS_INLINE UInt64 ends_mask(const char *ptr, Size last_offset, Lanes::Reg first, Lanes::Reg last)
+{
+    return Lanes::mask(Lanes::both(Lanes::eq(Lanes::load(ptr), first), Lanes::eq(Lanes::load(ptr + last_offset), last)));
+}
+
+// The block with its ASCII letters changed to lower or upper case, by flipping the case bit
+// of the letters in the other case.
+static UU_ALWAYS_INLINE Lanes::Reg lowered(Lanes::Reg r)
+{
+    return Lanes::flip(r, Lanes::both(Lanes::in_range(r, 'A', 'Z'), Lanes::splat(0x20)));
+}
+
+static UU_ALWAYS_INLINE Lanes::Reg raised(Lanes::Reg r)
+{
+    return Lanes::flip(r, Lanes::both(Lanes::in_range(r, 'a', 'z'), Lanes::splat(0x20)));
+}
+
+// The lanes of the block of candidate positions at ptr whose first and last bytes match the 
+// needle's, which are given in lower case, ignoring the case of ASCII letters.
+static UU_ALWAYS_INLINE UInt64 folded_ends_mask(const char *ptr, Size last_offset, Lanes::Reg first, Lanes::Reg last)
+{
+    return Lanes::mask(Lanes::both(Lanes::eq(lowered(Lanes::load(ptr)), first), 
+        Lanes::eq(lowered(Lanes::load(ptr + last_offset)), last)));
+}
+
+#endif  // UU_BYTE_SEARCH_SIMD
+
+static UU_ALWAYS_INLINE char lower_ascii(char c)
+{
+    return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c;
+}
+
+static UU_ALWAYS_INLINE char upper_ascii(char c)
+{
+    return c >= 'a' && c <= 'z' ? char(c - ('a' - 'A')) : c;
+}
+
+// The bytes between the first and last of the needle. Candidates already match at both ends.
+static UU_ALWAYS_INLINE bool middle_matches(const char *ptr, const char *needle, Size needle_length)
+{
+    return needle_length <= 2 || memcmp(ptr + 1, needle + 1, needle_length - 2) == 0;
+}
+
+// find_byte =====================================================================================
+
+const char *find_byte(const char *first, const char *last, char c)
+{
+    const char *ptr = first;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(last - first) >= Lanes::Width) {
+        Lanes::Reg splat = Lanes::splat(c);
+        for (; ptr + Lanes::Width <= last; ptr += Lanes::Width) {
+            UInt64 mask = byte_mask(ptr, splat);
+            if (mask) {
+                return ptr + Lanes::first_lane(mask);
+            }
+        }
+        // one more block, overlapping the last, for the bytes left over
+        if (ptr < last) {
+            ptr = last - Lanes::Width;
+            UInt64 mask = byte_mask(ptr, splat);
+            if (mask) {
+                return ptr + Lanes::first_lane(mask);
+            }
+        }
+        return nullptr;
+    }
+#endif
+    for (; ptr < last; ptr++) {
+        if (*ptr == c) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+const char *rfind_byte(const char *first, const char *last, char c)
+{
+    const char *ptr = last;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(last - first) >= Lanes::Width) {
+        Lanes::Reg splat = Lanes::splat(c);
+        while (Size(ptr - first) >= Lanes::Width) {
+            ptr -= Lanes::Width;
+            UInt64 mask = byte_mask(ptr, splat);
+            if (mask) {
+                return ptr + Lanes::last_lane(mask);
+            }
+        }
+        if (ptr > first) {
+            UInt64 mask = byte_mask(first, splat);
+            if (mask) {
+                return first + Lanes::last_lane(mask);
+            }
+        }
+        return nullptr;
+    }
+#endif
+    while (ptr > first) {
+        ptr--;
+        if (*ptr == c) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+// find_substring ================================================================================
+
+const char *find_substring(const char *first, const char *last, const char *needle, Size needle_length)
+{
+    if (needle_length == 0) {
+        return first;
+    }
+    if (needle_length > Size(last - first)) {
+        return nullptr;
+    }
+    if (needle_length == 1) {
+        return find_byte(first, last, needle[0]);
+    }
+
+    // candidates are the positions in [first, end)
+    const char *end = last - needle_length + 1;
+    const Size last_offset = needle_length - 1;
+    const char *ptr = first;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(end - first) >= Lanes::Width) {
+        Lanes::Reg first_byte = Lanes::splat(needle[0]);
+        Lanes::Reg last_byte = Lanes::splat(needle[last_offset]);
+        for (;;) {
+            if (ptr + Lanes::Width > end) {
+                if (ptr == end) {
+                    return nullptr;
+                }
+                // the last block overlaps positions already ruled out, which can't match now either
+                ptr = end - Lanes::Width;
+            }
+            UInt64 mask = ends_mask(ptr, last_offset, first_byte, last_byte);
+            while (mask) {
+                const char *candidate = ptr + Lanes::first_lane(mask);
+                if (middle_matches(candidate, needle, needle_length)) {
+                    return candidate;
+                }
+                mask = Lanes::clear_first_lane(mask);
+            }
+            if (ptr + Lanes::Width == end) {
+                return nullptr;
+            }
+            ptr += Lanes::Width;
+        }
+    }
+#endif
+    for (; ptr < end; ptr++) {
+        if (ptr[0] == needle[0] && ptr[last_offset] == needle[last_offset] && middle_matches(ptr, needle, needle_length)) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+const char *rfind_substring(const char *first, const char *last, const char *needle, Size needle_length)
+{
+    if (needle_length == 0) {
+        return last;
+    }
+    if (needle_length > Size(last - first)) {
+        return nullptr;
+    }
+    if (needle_length == 1) {
+        return rfind_byte(first, last, needle[0]);
+    }
+
+    // candidates are the positions in [first, end)
+    const char *end = last - needle_length + 1;
+    const Size last_offset = needle_length - 1;
+    const char *ptr = end;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(end - first) >= Lanes::Width) {
+        Lanes::Reg first_byte = Lanes::splat(needle[0]);
+        Lanes::Reg last_byte = Lanes::splat(needle[last_offset]);
+        while (ptr > first) {
+            // the first block may overlap positions already ruled out, which can't match now either
+            ptr = Size(ptr - first) >= Lanes::Width ? ptr - Lanes::Width : first;
+            UInt64 mask = ends_mask(ptr, last_offset, first_byte, last_byte);
+            while (mask) {
+                const char *candidate = ptr + Lanes::last_lane(mask);
+                if (middle_matches(candidate, needle, needle_length)) {
+                    return candidate;
+                }
+                mask = Lanes::clear_last_lane(mask);
+            }
+        }
+        return nullptr;
+    }
+#endif
+    while (ptr > first) {
+        ptr--;
+        if (ptr[0] == needle[0] && ptr[last_offset] == needle[last_offset] && middle_matches(ptr, needle, needle_length)) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+// ASCII case ====================================================================================
+
+template <bool Lower>
+static UU_ALWAYS_INLINE void change_case_ascii(char *first, char *last)
+{
+    char *ptr = first;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(last - first) >= Lanes::Width) {
+        for (; ptr + Lanes::Width <= last; ptr += Lanes::Width) {
+            Lanes::Reg r = Lanes::load(ptr);
+            Lanes::store(ptr, Lower ? lowered(r) : raised(r));
+        }
+        // one more block, overlapping the last, which is harmless since changing case twice
+        // does no more than changing it once
+        if (ptr < last) {
+            ptr = last - Lanes::Width;
+            Lanes::Reg r = Lanes::load(ptr);
+            Lanes::store(ptr, Lower ? lowered(r) : raised(r));
+        }
+        return;
+    }
+#endif
+    for (; ptr < last; ptr++) {
+        *ptr = Lower ? lower_ascii(*ptr) : upper_ascii(*ptr);
+    }
+}
+
+void to_lower_ascii(char *first, char *last)
+{
+    change_case_ascii<true>(first, last);
+}
+
+void to_upper_ascii(char *first, char *last)
+{
+    change_case_ascii<false>(first, last);
+}
+
+int compare_case_insensitive(const char *a, const char *b, Size length)
+{
+    Size idx = 0;
+#if UU_BYTE_SEARCH_SIMD
+    for (; idx + Lanes::Width <= length; idx += Lanes::Width) {
+        UInt64 same = Lanes::mask(Lanes::eq(lowered(Lanes::load(a + idx)), lowered(Lanes::load(b + idx))));
+        if (same != Lanes::AllLanes) {
+            idx += Lanes::first_lane(~same & Lanes::AllLanes);
+            return int(UInt8(lower_ascii(a[idx]))) - int(UInt8(lower_ascii(b[idx])));
+        }
+    }
+#endif
+    for (; idx < length; idx++) {
+        char ca = lower_ascii(a[idx]);
+        char cb = lower_ascii(b[idx]);
+        if (ca != cb) {
+            return int(UInt8(ca)) - int(UInt8(cb));
+        }
+    }
+    return 0;
+}
+
+const char *find_substring_case_insensitive(const char *first, const char *last, const char *needle, Size needle_length)
+{
+    if (needle_length == 0) {
+        return first;
+    }
+    if (needle_length > Size(last - first)) {
+        return nullptr;
+    }
+
+    // candidates are the positions in [first, end), and the middle of each is compared only 
+    // when both its ends match
+    const char *end = last - needle_length + 1;
+    const Size last_offset = needle_length - 1;
+    const char first_byte = lower_ascii(needle[0]);
+    const char last_byte = lower_ascii(needle[last_offset]);
+    auto middle_matches = [needle, needle_length](const char *ptr) {
+        return needle_length <= 2 || compare_case_insensitive(ptr + 1, needle + 1, needle_length - 2) == 0;
+    };
+    const char *ptr = first;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(end - first) >= Lanes::Width) {
+        Lanes::Reg first_lanes = Lanes::splat(first_byte);
+        Lanes::Reg last_lanes = Lanes::splat(last_byte);
+        for (;;) {
+            if (ptr + Lanes::Width > end) {
+                if (ptr == end) {
+                    return nullptr;
+                }
+                ptr = end - Lanes::Width;
+            }
+            UInt64 mask = folded_ends_mask(ptr, last_offset, first_lanes, last_lanes);
+            while (mask) {
+                const char *candidate = ptr + Lanes::first_lane(mask);
+                if (middle_matches(candidate)) {
+                    return candidate;
+                }
+                mask = Lanes::clear_first_lane(mask);
+            }
+            if (ptr + Lanes::Width == end) {
+                return nullptr;
+            }
+            ptr += Lanes::Width;
+        }
+    }
+#endif
+    for (; ptr < end; ptr++) {
+        if (lower_ascii(ptr[0]) == first_byte && lower_ascii(ptr[last_offset]) == last_byte && middle_matches(ptr)) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+// ByteSet =======================================================================================
+
+#if UU_BYTE_SEARCH_SIMD
+
+// The lanes of a block that hold bytes in a set. Small sets compare each of their bytes against 
+// the block. Larger ones look up the row for each lane's low nibble in the bitmap, then the bit 
+// in it for the high nibble, with byte shuffles, where the CPU has them.
+class SetLanes
+{
+public:
+#if UU_BYTE_SEARCH_SHUFFLE
+    static constexpr Size MaxListed = 4;
+#else
+    static constexpr Size MaxListed = ByteSet::ListCapacity;
+#endif
+
+    explicit SetLanes(const ByteSet &set) : m_size(set.size()) {
+        if (m_size <= MaxListed) {
+            for (Size idx = 0; idx < m_size; idx++) {
+                m_listed[idx] = Lanes::splat(set.listed()[idx]);
+            }
+            return;
+        }
+#if UU_BYTE_SEARCH_SHUFFLE
+        static constexpr UInt8 Bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+        m_low_rows = Lanes::table(set.m_rows[0].data());
+        m_high_rows = Lanes::table(set.m_rows[1].data());
+        m_bits = Lanes::table(Bits);
+#endif
+    }
+
+    // False when the set is too large to list and there are no byte shuffles, which leaves 
+    // testing the bytes one at a time.
+    bool is_usable() const {
+#if UU_BYTE_SEARCH_SHUFFLE
+        return true;
+#else
+        return m_size <= MaxListed;
+#endif
+    }
+
+    UU_ALWAYS_INLINE UInt64 mask(const char *ptr) const {
+        Lanes::Reg r = Lanes::load(ptr);
+        if (m_size <= MaxListed) {
+            Lanes::Reg result = Lanes::none();
+            for (Size idx = 0; idx < m_size; idx++) {
+                result = Lanes::either(result, Lanes::eq(r, m_listed[idx]));
+            }
+            return Lanes::mask(result);
+        }
+#if UU_BYTE_SEARCH_SHUFFLE
+        Lanes::Reg low = Lanes::low_nibbles(r);
+        Lanes::Reg high = Lanes::high_nibbles(r);
+        Lanes::Reg in_high_half = Lanes::in_range(high, 8, 15);
+        Lanes::Reg rows = Lanes::select(in_high_half, Lanes::lookup(m_high_rows, low), Lanes::lookup(m_low_rows, low));
+        Lanes::Reg bits = Lanes::lookup(m_bits, high);
+        return Lanes::mask(Lanes::eq(Lanes::both(rows, bits), bits));
+#else
+        return 0;
+#endif
+    }
+
+private:
+    Size m_size = 0;
+    Lanes::Reg m_listed[MaxListed];
+#if UU_BYTE_SEARCH_SHUFFLE
+    Lanes::Reg m_low_rows;
+    Lanes::Reg m_high_rows;
+    Lanes::Reg m_bits;
+#endif
+};
+
+#endif  // UU_BYTE_SEARCH_SIMD
+
+template <bool In>
+static UU_ALWAYS_INLINE const char *find_first_in_set(const char *first, const char *last, const ByteSet &set)
+{
+    const char *ptr = first;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(last - first) >= Lanes::Width) {
+        SetLanes lanes(set);
+        if (lanes.is_usable()) {
+            auto mask = [&lanes](const char *p) { 
+                UInt64 m = lanes.mask(p);
+                return In ? m : ~m & Lanes::AllLanes;
+            };
+            for (; ptr + Lanes::Width <= last; ptr += Lanes::Width) {
+                UInt64 m = mask(ptr);
+                if (m) {
+                    return ptr + Lanes::first_lane(m);
+                }
+            }
+            // one more block, overlapping the last, for the bytes left over
+            if (ptr < last) {
+                ptr = last - Lanes::Width;
+                UInt64 m = mask(ptr);
+                if (m) {
+                    return ptr + Lanes::first_lane(m);
+                }
+            }
+            return nullptr;
+        }
+    }
+#endif
+    for (; ptr < last; ptr++) {
+        if (set.contains(*ptr) == In) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+template <bool In>
+static UU_ALWAYS_INLINE const char *find_last_in_set(const char *first, const char *last, const ByteSet &set)
+{
+    const char *ptr = last;
+#if UU_BYTE_SEARCH_SIMD
+    if (Size(last - first) >= Lanes::Width) {
+        SetLanes lanes(set);
+        if (lanes.is_usable()) {
+            auto mask = [&lanes](const char *p) { 
+                UInt64 m = lanes.mask(p);
+                return In ? m : ~m & Lanes::AllLanes;
+            };
+            while (Size(ptr - first) >= Lanes::Width) {
+                ptr -= Lanes::Width;
+                UInt64 m = mask(ptr);
+                if (m) {
+                    return ptr + Lanes::last_lane(m);
+                }
+            }
+            if (ptr > first) {
+                UInt64 m = mask(first);
+                if (m) {
+                    return first + Lanes::last_lane(m);
+                }
+            }
+            return nullptr;
+        }
+    }
+#endif
+    while (ptr > first) {
+        ptr--;
+        if (set.contains(*ptr) == In) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+const char *find_first_in(const char *first, const char *last, const ByteSet &set)
+{
+    if (set.size() == 1) {
+        return find_byte(first, last, set.listed()[0]);
+    }
+    return find_first_in_set<true>(first, last, set);
+}
+
+const char *find_first_not_in(const char *first, const char *last, const ByteSet &set)
+{
+    return find_first_in_set<false>(first, last, set);
+}
+
+const char *find_last_in(const char *first, const char *last, const ByteSet &set)
+{
+    if (set.size() == 1) {
+        return rfind_byte(first, last, set.listed()[0]);
+    }
+    return find_last_in_set<true>(first, last, set);
+}
+
+const char *find_last_not_in(const char *first, const char *last, const ByteSet &set)
+{
+    return find_last_in_set<false>(first, last, set);
+}
+
+}  // namespace UU
@@ -0,0 +1,132 @@
+//
+// ByteSearch.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_BYTE_SEARCH_H
+#define UU_BYTE_SEARCH_H
+
+#include <array>
+#include <string_view>
+
+#include <UU/Types.h>
+
+namespace UU {
+
+class SetLanes;
+
+// ByteSet ========================================================================================
+
+// A set of bytes, compiled once for finding the first or last byte in or out of the set. It 
+// keeps a bitmap for testing one byte at a time, the bytes themselves when there are only a 
+// few, to be compared against a block at once, and, for larger sets, the bitmap rearranged for
+// byte shuffle instructions to look up a block at once. Sets can be made in constant 
+// evaluation, so the ones used over and over can be made when the program is compiled.
+class ByteSet
+{
+public:
+    // Sets up to this size keep their bytes listed.
+    static constexpr Size ListCapacity = 8;
+
+    constexpr ByteSet() {}
+    constexpr explicit ByteSet(std::string_view bytes) { 
+        for (char c : bytes) {
+            add(c);
+        }
+    }
+
+    constexpr void add(char c) {
+        if (contains(c)) {
+            return;
+        }
+        UInt8 b = UInt8(c);
+        m_bits[b >> 6] |= UInt64(1) << (b & 63);
+        // a row for each low nibble, with a bit for each high nibble, split in two halves
+        m_rows[b >> 7][b & 0x0f] |= UInt8(1 << ((b >> 4) & 7));
+        if (m_size < ListCapacity) {
+            m_list[m_size] = c;
+        }
+        m_size++;
+    }
+
+    constexpr bool contains(char c) const { 
+        UInt8 b = UInt8(c);
+        return (m_bits[b >> 6] >> (b & 63)) & 1; 
+    }
+
+    // The bytes in the set, in the order they were added, if there are no more than 
+    // ListCapacity of them, and otherwise none.
+    constexpr std::string_view listed() const { 
+        return m_size <= ListCapacity ? std::string_view(m_list.data(), m_size) : std::string_view(); 
+    }
+
+    constexpr Size size() const { return m_size; }
+    constexpr bool is_empty() const { return m_size == 0; }
+    constexpr bool not_empty() const { return m_size != 0; }
+
+private:
+    friend class SetLanes;
+
+    std::array<UInt64, 4> m_bits = {};
+    std::array<std::array<UInt8, 16>, 2> m_rows = {};
+    std::array<char, ListCapacity> m_list = {};
+    Size m_size = 0;
+};
+
+// Search kernels for byte strings. They compare 16 or 32 bytes at a time with SIMD 
+// instructions: NEON on ARM64, SSE2 on x86-64, or AVX2 when the compiler targets it. On other
+// CPUs, they fall back to plain loops. Each returns a pointer to the match it finds in 
+// [first, last), or nullptr if there is none.
+
+// The first or last occurrence of c.
+const char *find_byte(const char *first, const char *last, char c);
+const char *rfind_byte(const char *first, const char *last, char c);
+
+// The first or last occurrence of the needle, which must lie entirely in [first, last). 
+// Candidates are found by comparing the first and last bytes of the needle at once against
+// each block of positions, and only those get a full compare. An empty needle matches at first,
+// or at last for rfind_substring.
+const char *find_substring(const char *first, const char *last, const char *needle, Size needle_length);
+const char *rfind_substring(const char *first, const char *last, const char *needle, Size needle_length);
+
+// ASCII letters in [first, last) changed to lower or upper case in place. Other bytes, 
+// including those of multibyte UTF-8 sequences, are left as they are.
+void to_lower_ascii(char *first, char *last);
+void to_upper_ascii(char *first, char *last);
+
+// Compares length bytes as memcmp() does, as if every ASCII letter were in lower case.
+int compare_case_insensitive(const char *a, const char *b, Size length);
+
+// Like find_substring(), but ASCII letters in the haystack match those in the needle in 
+// either case. The haystack is folded a block at a time as it is searched, not copied.
+const char *find_substring_case_insensitive(const char *first, const char *last, const char *needle, Size needle_length);
+
+// The first or last byte in [first, last) that is in the set, or that isn't.
+const char *find_first_in(const char *first, const char *last, const ByteSet &set);
+const char *find_first_not_in(const char *first, const char *last, const ByteSet &set);
+const char *find_last_in(const char *first, const char *last, const ByteSet &set);
+const char *find_last_not_in(const char *first, const char *last, const ByteSet &set);
+
+}  // namespace UU
+
+#endif  // UU_BYTE_SEARCH_H
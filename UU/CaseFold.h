@@ -0,0 +1,63 @@
+//
+// CaseFold.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef UU_CASE_FOLD_H
+#define UU_CASE_FOLD_H
+
+#include <string_view>
+
+#include <UU/Types.h>
+
+namespace UU {
+
+// Unicode simple case folding, for comparing and searching UTF-8 text without regard to case.
+// The mappings are the C and S entries of the Unicode Character Database's CaseFolding.txt, 
+// which map each character to one other, so folding never changes the number of runes. The 
+// F entries, which fold characters like U+00DF ß to several, and the Turkic T entries, are 
+// not used. Invalid UTF-8 is read as U+FFFD.
+//
+// ASCII-only case insensitivity, which is much faster, is in ByteSearch.h.
+
+// c case folded, or c itself if it has no folding.
+Rune fold_case(Rune c);
+
+// The runes of the UTF-8 string, case folded.
+RuneString fold_case(std::string_view str);
+
+// Compares the UTF-8 strings rune by rune, after folding, and returns a value less than, 
+// equal to, or greater than zero, as memcmp() does.
+int compare_case_insensitive_utf8(std::string_view a, std::string_view b);
+
+// The offset of the first match at or after pos, which must be at the start of a rune, or 
+// SizeMax. The haystack is folded as it is searched, not copied. Since a character and its 
+// folding can have UTF-8 sequences of different lengths, the length of the match in the 
+// haystack is stored in match_length, when given. An empty needle matches at pos.
+Size find_folded_utf8(std::string_view haystack, const RuneString &folded_needle, Size pos = 0, 
+    Size *match_length = nullptr);
+Size find_case_insensitive_utf8(std::string_view haystack, std::string_view needle, Size pos = 0, 
+    Size *match_length = nullptr);
+
+}  // namespace UU
+
+#endif  // UU_CASE_FOLD_H
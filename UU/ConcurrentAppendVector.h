@@ -0,0 +1,239 @@
+//
+// ConcurrentAppendVector.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_CONCURRENT_APPEND_VECTOR_H
+#define UU_CONCURRENT_APPEND_VECTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <UU/Allocator.h>
+#include <UU/Array.h>
+#include <UU/Assertions.h>
+#include <UU/Compiler.h>
+#include <UU/Types.h>
+
+namespace UU {
+
+// ConcurrentAppendVector =========================================================================
+
+// A vector that any number of threads can append to at once, without a lock. Each push_back()
+// claims the next index with one atomic increment and constructs its element in place, so 
+// elements never move once they are made. Storage is a fixed table of segments, with the 
+// first holding FirstSegmentSize elements and each one after holding twice as many as the one
+// before. A segment is allocated by whichever writer first needs it.
+//
+// Appending is the only thing that may happen concurrently. Reading elements, taking them
+// out with take_array(), sorting them with sorted_view() or clearing the vector must wait
+// until the writers are done, for example after joining their threads or after a
+// ThreadPool::parallel_for returns. The order of elements is the order their indices were
+// claimed, which varies from run to run.
+//
+// AllocatorT must be safe to call from many threads at once, as Mallocator is. 
+//
+template <typename T, Size FirstSegmentSize = 64, typename AllocatorT = Mallocator>
+    requires IsPowerOfTwo<FirstSegmentSize> && IsLessThanOrEqual<alignof(T), alignof(std::max_align_t)>
+class ConcurrentAppendVector
+{
+public:
+    static constexpr Size FirstSegmentShift = std::countr_zero(FirstSegmentSize);
+    static constexpr Size MaxSegments = 64 - FirstSegmentShift;
+
+    ConcurrentAppendVector() {}
+    explicit ConcurrentAppendVector(const AllocatorT &allocator) : m_allocator(allocator) {}
+
+    ConcurrentAppendVector(const ConcurrentAppendVector &) = delete;
+    ConcurrentAppendVector &operator=(const ConcurrentAppendVector &) = delete;
+
+    ~ConcurrentAppendVector() {
+        clear();
+    }
+
+    // appending, from any thread =================================================================
+
+    // Appends t and returns its index.
+    Size push_back(const T &t) { return emplace_back(t); }
+    Size push_back(T &&t) { return emplace_back(std::move(t)); }
+
+    // Constructs an element from args at the end and returns its index.
+    template <typename... Args>
+    Size emplace_back(Args &&...args) {
+        Size index = m_size.fetch_add(1, std::memory_order_relaxed);
+        ::new ((void *)slot(index)) T(std::forward<Args>(args)...);
+        return index;
+    }
+
+    // Makes sure the segments for count elements are allocated, so appends up to that many 
+    // don't have to allocate.
+    void reserve(Size count) {
+        if (count == 0) {
+            return;
+        }
+        Size last = segment_for(count - 1);
+        for (Size seg = 0; seg <= last; seg++) {
+            ensure_segment(seg);
+        }
+    }
+
+    // The number of indices claimed so far. Once the writers are done, that's the number of elements.
+    Size size() const { return m_size.load(std::memory_order_acquire); }
+    UU_NO_DISCARD bool is_empty() const { return size() == 0; }
+    UU_NO_DISCARD bool not_empty() const { return !is_empty(); }
+
+    // reading, after appending ===================================================================
+
+    T &operator[](Size index) {
+        ASSERT(index < size());
+        return *element_at(index);
+    }
+
+    const T &operator[](Size index) const {
+        ASSERT(index < size());
+        return *element_at(index);
+    }
+
+    // Calls f(T *first, Size count) for each segment's run of elements, in index order.
+    template <typename F>
+    void for_each_segment(F f) {
+        Size remaining = size();
+        for (Size seg = 0; remaining > 0; seg++) {
+            Size count = std::min(remaining, segment_size(seg));
+            f(m_segments[seg].load(std::memory_order_acquire), count);
+            remaining -= count;
+        }
+    }
+
+    template <typename F>
+    void for_each(F f) {
+        for_each_segment([&f](T *first, Size count) {
+            for (Size idx = 0; idx < count; idx++) {
+                f(first[idx]);
+            }
+        });
+    }
+
+    // Moves every element, in index order, into one contiguous Array, and leaves this vector empty.
+    template <unsigned N = 0, typename ArrayAllocatorT = Mallocator>
+    Array<T, N, ArrayAllocatorT> take_array(const ArrayAllocatorT &allocator = ArrayAllocatorT()) {
+        Array<T, N, ArrayAllocatorT> result(allocator);
+        result.reserve(size());
+        for_each([&result](T &t) { result.push_back(std::move(t)); });
+        clear();
+        return result;
+    }
+
+    // Pointers to every element, sorted by compare, for walking the elements in order 
+    // without moving them.
+    template <typename Compare = std::less<T>>
+    Array<const T *, 0> sorted_view(Compare compare = Compare()) const {
+        Array<const T *, 0> result;
+        result.reserve(size());
+        const_cast<ConcurrentAppendVector *>(this)->for_each([&result](const T &t) { result.push_back(&t); });
+        std::stable_sort(result.begin(), result.end(), [&compare](const T *a, const T *b) { return compare(*a, *b); });
+        return result;
+    }
+
+    // Destroys every element and frees every segment.
+    void clear() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for_each([](T &t) { t.~T(); });
+        }
+        for (Size seg = 0; seg < MaxSegments; seg++) {
+            T *segment = m_segments[seg].load(std::memory_order_relaxed);
+            if (segment == nullptr) {
+                break;
+            }
+            Memory mem(segment, segment_size(seg) * sizeof(T));
+            m_allocator.dealloc(mem);
+            m_segments[seg].store(nullptr, std::memory_order_relaxed);
+        }
+        m_size.store(0, std::memory_order_release);
+    }
+
+private:
+    static constexpr Size segment_size(Size seg) {
+        return FirstSegmentSize << seg;
+    }
+
+    // Segment seg starts at index FirstSegmentSize * (2^seg - 1), so the segment for an index 
+    // is found from the highest bit of index + FirstSegmentSize.
+    UU_ALWAYS_INLINE static Size segment_for(Size index) {
+        return std::bit_width(index + FirstSegmentSize) - 1 - FirstSegmentShift;
+    }
+
+    UU_ALWAYS_INLINE static Size offset_in_segment(Size index, Size seg) {
+        return index + FirstSegmentSize - segment_size(seg);
+    }
+
+    UU_ALWAYS_INLINE T *element_at(Size index) const {
+        Size seg = segment_for(index);
+        return m_segments[seg].load(std::memory_order_acquire) + offset_in_segment(index, seg);
+    }
+
+    UU_ALWAYS_INLINE T *slot(Size index) {
+        Size seg = segment_for(index);
+        T *segment = m_segments[seg].load(std::memory_order_acquire);
+        if (UNLIKELY(segment == nullptr)) {
+            segment = ensure_segment(seg);
+        }
+        return segment + offset_in_segment(index, seg);
+    }
+
+    // Allocates segment seg if no other thread has yet. When two threads race to do it, 
+    // the loser frees its block and uses the winner's.
+    UU_NEVER_INLINE T *ensure_segment(Size seg) {
+        ASSERT_WITH_MESSAGE(seg < MaxSegments, "ConcurrentAppendVector is full");
+        T *segment = m_segments[seg].load(std::memory_order_acquire);
+        if (segment != nullptr) {
+            return segment;
+        }
+        Size bytes = segment_size(seg) * sizeof(T);
+        Memory mem = m_allocator.alloc(bytes);
+        if (UNLIKELY(mem.is_empty())) {
+            ASSERT_WITH_MESSAGE(false, "Allocation of ConcurrentAppendVector segment failed: %lu", bytes);
+            CRASH();
+        }
+        T *expected = nullptr;
+        if (m_segments[seg].compare_exchange_strong(expected, static_cast<T *>(mem.ptr), 
+                std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return static_cast<T *>(mem.ptr);
+        }
+        m_allocator.dealloc(mem);
+        return expected;
+    }
+
+    std::atomic<T *> m_segments[MaxSegments] = {};
+    alignas(64) std::atomic<Size> m_size = 0;
+    [[no_unique_address]] AllocatorT m_allocator;
+};
+
+}  // namespace UU
+
+#endif  // UU_CONCURRENT_APPEND_VECTOR_H
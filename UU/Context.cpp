@@ -29,17 +29,53 @@
 
 namespace UU {
 
-// static SmallVector<Context *, 4> g_contexts;
-// void Context::init() { g_contexts.emplace_back(new Context); }
+BaseAllocator &base_allocator() 
+{
+    // never destroyed, so blocks freed by static destructors still have somewhere to go
+    static BaseAllocator *allocator = new BaseAllocator;
+    return *allocator;
+}
+
+std::pmr::memory_resource *base_memory_resource()
+{
+    static MemoryResourceAdapter<BaseAllocator> *resource = new MemoryResourceAdapter<BaseAllocator>(base_allocator());
+    return resource;
+}
 
-static Context g_context;
-// thread_local static int g_context_counter = 0;
+// constant-initialized and trivially destructible, so it is safe to use at any point in
+// a thread's life, including from the destructors of other thread_local objects
+static thread_local constinit Context t_context;
 
 void Context::init() {}
-Context &Context::get() {
-    // g_context_counter++;
-    // printf("t: %p : %p : %d\n", pthread_self(), &g_context, g_context_counter);
-    return g_context;
+
+Context &Context::get() 
+{
+    return t_context;
+}
+
+void Context::push_allocator(DynamicAllocator &allocator)
+{
+    ASSERT_WITH_MESSAGE(m_allocator.m_depth < Allocator::MaxDepth, "Context allocator stack overflow");
+    m_allocator.m_stack[m_allocator.m_depth] = &allocator;
+    m_allocator.m_depth++;
+}
+
+void Context::pop_allocator(DynamicAllocator &allocator)
+{
+    ASSERT(m_allocator.m_depth > 0);
+    ASSERT_WITH_MESSAGE(m_allocator.m_stack[m_allocator.m_depth - 1] == &allocator, 
+        "Context allocators must be popped in reverse order of pushing");
+    m_allocator.m_depth--;
+    m_allocator.m_stack[m_allocator.m_depth] = nullptr;
+}
+
+DynamicAllocator &Context::current_allocator()
+{
+    if (m_allocator.m_depth > 0) {
+        return *m_allocator.m_stack[m_allocator.m_depth - 1];
+    }
+    static DynamicAllocatorAdapter<BaseAllocator> *base_adapter = new DynamicAllocatorAdapter<BaseAllocator>(base_allocator());
+    return *base_adapter;
 }
 
 }  // namespace UU
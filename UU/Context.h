@@ -25,32 +25,224 @@
 #ifndef UU_CONTEXT_H
 #define UU_CONTEXT_H
 
-#include <vector>
+#include <optional>
 
 #include <UU/Allocator.h>
-#include <UU/SmallVector.h>
 
 namespace UU {
 
-// using Allocator = StatsAllocator<GPAllocator>;
-using Allocator = GPAllocator;
-// using Allocator = Mallocator;
-// using Allocator = StatsAllocator<Mallocator>;
+// The allocator used when nothing has been pushed on a thread's Context. It is shared by
+// every thread, which is what makes it safe to free a block on a thread other than the one
+// that allocated it.
+// using BaseAllocator = StatsAllocator<GPAllocator>;
+using BaseAllocator = GPAllocator;
+// using BaseAllocator = Mallocator;
+// using BaseAllocator = StatsAllocator<Mallocator>;
 
+BaseAllocator &base_allocator();
+
+// A std::pmr::memory_resource that allocates from base_allocator(), for standard containers
+// that should share its pooling.
+std::pmr::memory_resource *base_memory_resource();
+
+// The allocator Context hands out. It sends allocations to the allocator on top of the calling
+// thread's stack, or to base_allocator() when the stack is empty. Each block goes back to the
+// topmost allocator on the stack that owns it, or to base_allocator() if none does.
+//
+// That depends on owns() telling an allocator's blocks from everyone else's. GPAllocator,
+// MmapAllocator and the block and arena allocators look a block's page up in the PageMap.
+// Mallocator claims blocks on pages no allocator registered, which is any block from malloc,
+// so two Mallocators on the stack may free each other's blocks, which is harmless.
+//
+// A block that neither the stack nor base_allocator() owns came from an allocator that has
+// since been popped. Giving it to base_allocator() would have it handed out again, so it is
+// dropped instead: an arena gets the space back when it is rewound or freed, and a block from
+// anything else leaks. Free blocks before their allocator is popped to avoid that.
+//
+class ContextAllocator
+{
+public:
+    static constexpr Size MaxDepth = 16;
+
+    constexpr ContextAllocator() {}
+
+    UU_ALWAYS_INLINE Memory alloc(Size capacity) {
+        if (LIKELY(m_depth == 0)) {
+            return base_allocator().alloc(capacity);
+        }
+        return m_stack[m_depth - 1]->alloc(capacity);
+    }
+
+    UU_ALWAYS_INLINE bool dealloc(Memory &mem) {
+        for (Size idx = m_depth; idx > 0; idx--) {
+            DynamicAllocator *allocator = m_stack[idx - 1];
+            if (allocator->owns(mem)) {
+                return allocator->dealloc(mem);
+            }
+        }
+        if (UNLIKELY(!base_allocator().owns(mem))) {
+            LOG(Memory, "ContextAllocator dropping block from a popped allocator: %lu : %p", mem.capacity, mem.ptr);
+            return false;
+        }
+        return base_allocator().dealloc(mem);
+    }
+
+    void free(Memory &mem) { dealloc(mem); }
+    bool owns(const Memory &mem) const { return true; }
+
+    // Resizes in place when the owner can, and otherwise moves the block to wherever 
+    // alloc() sends new blocks now.
+    bool expand(Memory &mem, Size delta) {
+        for (Size idx = m_depth; idx > 0; idx--) {
+            DynamicAllocator *allocator = m_stack[idx - 1];
+            if (allocator->owns(mem)) {
+                return allocator->expand(mem, delta);
+            }
+        }
+        return base_allocator().owns(mem) && base_allocator().expand(mem, delta);
+    }
+
+    bool reallocate(Memory &mem, Size capacity) {
+        if (LIKELY(m_depth == 0)) {
+            if (LIKELY(mem.is_empty() || base_allocator().owns(mem))) {
+                return base_allocator().reallocate(mem, capacity);
+            }
+            return reallocate_by_moving(*this, mem, capacity);
+        }
+        DynamicAllocator *top = m_stack[m_depth - 1];
+        if (mem.is_empty() || top->owns(mem)) {
+            return top->reallocate(mem, capacity);
+        }
+        return reallocate_by_moving(*this, mem, capacity);
+    }
+
+private:
+    friend class Context;
+
+    // plain array, so the thread_local Context that holds this needs no destructor
+    DynamicAllocator *m_stack[MaxDepth] = {};
+    Size m_depth = 0;
+};
+
+using Allocator = ContextAllocator;
+
+// Each thread has its own Context, with its own stack of allocators. Push an allocator to
+// send the thread's allocations to it until it is popped again, or better, use an
+// AllocatorScope or ArenaScope to do the pushing and popping.
 class Context
 {
 public:
     static void init();
     static Context &get();
 
-    Context() {}
+    constexpr Context() {}
     Allocator &allocator() { return m_allocator; }
 
+    void push_allocator(DynamicAllocator &allocator);
+    void pop_allocator(DynamicAllocator &allocator);
+
+    // The allocator on top of the stack, or an adapter for base_allocator() if the stack is empty.
+    DynamicAllocator &current_allocator();
+    Size allocator_depth() const { return m_allocator.m_depth; }
+
 private:
+    Context(const Context &) = delete;
+    Context &operator=(const Context &) = delete;
+
     Allocator m_allocator;
 };
 
+// A handle to the calling thread's Context allocator, for BasicString and others that take an
+// allocator handle as a template parameter. It has no state, so it costs no space, and any two
+// of them are interchangeable.
+struct ContextAllocatorRef
+{
+    UU_ALWAYS_INLINE Memory alloc(Size capacity) { return Context::get().allocator().alloc(capacity); }
+    UU_ALWAYS_INLINE bool dealloc(Memory &mem) { return Context::get().allocator().dealloc(mem); }
+    UU_ALWAYS_INLINE bool expand(Memory &mem, Size delta) { return Context::get().allocator().expand(mem, delta); }
+    UU_ALWAYS_INLINE bool reallocate(Memory &mem, Size capacity) { 
+        return Context::get().allocator().reallocate(mem, capacity); 
+    }
+    constexpr bool operator==(const ContextAllocatorRef &) const = default;
+};
 
+// A copyable handle to a particular allocator, for BasicString and others that take an
+// allocator handle as a template parameter. Two handles are equal when they refer to the same
+// allocator, which must outlive them. A default-constructed handle goes to the calling thread's 
+// Context, like ContextAllocatorRef, so containers can still make scratch values of their type.
+template <typename Alloc>
+class AllocatorRef
+{
+public:
+    constexpr AllocatorRef() {}
+    constexpr AllocatorRef(Alloc &alloc) : m_alloc(&alloc) {}
+
+    Memory alloc(Size capacity) { 
+        return m_alloc ? m_alloc->alloc(capacity) : Context::get().allocator().alloc(capacity); 
+    }
+    
+    bool dealloc(Memory &mem) { 
+        return m_alloc ? m_alloc->dealloc(mem) : Context::get().allocator().dealloc(mem); 
+    }
+
+    bool expand(Memory &mem, Size delta) { 
+        return m_alloc ? m_alloc->expand(mem, delta) : Context::get().allocator().expand(mem, delta); 
+    }
+
+    bool reallocate(Memory &mem, Size capacity) { 
+        return m_alloc ? m_alloc->reallocate(mem, capacity) : Context::get().allocator().reallocate(mem, capacity); 
+    }
+
+    Alloc *allocator() const { return m_alloc; }
+
+    constexpr bool operator==(const AllocatorRef &) const = default;
+
+private:
+    Alloc *m_alloc = nullptr;
+};
+
+// Pushes an allocator on the calling thread's Context for as long as the scope lasts. The
+// allocator must outlive the scope. Blocks allocated in the scope should be freed before it
+// ends; after that, Context no longer knows their allocator and drops them when they are freed.
+template <typename Alloc>
+class AllocatorScope
+{
+public:
+    explicit AllocatorScope(Alloc &alloc) : m_adapter(alloc) { 
+        Context::get().push_allocator(m_adapter); 
+    }
+    
+    ~AllocatorScope() { 
+        Context::get().pop_allocator(m_adapter); 
+    }
+
+    AllocatorScope(const AllocatorScope &) = delete;
+    AllocatorScope &operator=(const AllocatorScope &) = delete;
+
+    Alloc &allocator() { return m_adapter.allocator(); }
+
+private:
+    DynamicAllocatorAdapter<Alloc> m_adapter;
+};
+
+// Pushes an arena on the calling thread's Context for as long as the scope lasts. The default
+// constructor makes a private arena that frees everything allocated from it when the scope
+// ends, so strings made in the scope must not outlive it. The other constructor uses an
+// arena the caller owns, and leaves it as it is, so strings made in the scope may outlive
+// the scope but not the arena, and freeing them after the scope leaves their space to the
+// arena's own rewind() or free_all().
+class ArenaScope
+{
+public:
+    ArenaScope() : m_owned_arena(std::in_place), m_scope(*m_owned_arena) {}
+    explicit ArenaScope(ArenaAllocator &arena) : m_scope(arena) {}
+
+    ArenaAllocator &arena() { return m_scope.allocator(); }
+
+private:
+    std::optional<ArenaAllocator> m_owned_arena;
+    AllocatorScope<ArenaAllocator> m_scope;
+};
 
 }  // namespace UU
 
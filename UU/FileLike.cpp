@@ -103,10 +103,9 @@ bool is_searchable(const std::vector<std::filesystem::path> searchables, const s
     return false;
 }
 
-std::string get_file_contents_as_string(const fs::path &path)
+template <typename StringT>
+static void read_file_contents(StringT &result, const fs::path &path)
 {
-    std::string result;
-
     std::ifstream f(path, std::ios::in | std::ios::binary);
     if (f) {
         f.seekg(0, std::ios::end);
@@ -116,7 +115,19 @@ std::string get_file_contents_as_string(const fs::path &path)
         f.read(&result[0], size);
         f.close();
     }
+}
 
+std::string get_file_contents_as_string(const fs::path &path)
+{
+    std::string result;
+    read_file_contents(result, path);
+    return result;
+}
+
+std::pmr::string get_file_contents_as_string(const fs::path &path, std::pmr::memory_resource *resource)
+{
+    std::pmr::string result(resource);
+    read_file_contents(result, path);
     return result;
 }
 
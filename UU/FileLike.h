@@ -26,6 +26,7 @@
 #define UU_FILE_LIKE_H
 
 #include <filesystem>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -48,6 +49,7 @@ std::vector<std::filesystem::path> searchable_paths();
 bool is_searchable(const std::vector<std::filesystem::path> searchables, const std::filesystem::path &path, int flags=0);
 
 std::string get_file_contents_as_string(const std::filesystem::path &path);
+std::pmr::string get_file_contents_as_string(const std::filesystem::path &path, std::pmr::memory_resource *resource);
 bool write_file(const std::filesystem::path &path, const std::string &string);
 
 bool filename_match(const UU::String &pattern, const std::filesystem::path &path, int flags=0);
@@ -22,7 +22,11 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#ifndef UU_MAPPED_FILE_H
+#define UU_MAPPED_FILE_H
+
 #include <filesystem>
+#include <string_view>
 
 namespace UU {
 
@@ -43,6 +47,11 @@ public:
     void *base() const { return m_base; }
     void close();
 
+    // The mapped bytes of the file, or an empty view if it isn't mapped.
+    std::string_view contents() const { 
+        return m_base ? std::string_view(static_cast<const char *>(m_base), m_file_length) : std::string_view(); 
+    }
+
     template <bool B = true> bool is_valid() const { return m_valid == B; };
 
 private:
@@ -59,3 +68,5 @@ private:
 };
 
 }  // namespace UU
+
+#endif  // UU_MAPPED_FILE_H
@@ -0,0 +1,423 @@
+//
+// MultiSearcher.cpp
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory_resource>
+
+#include "Assertions.h"
+#include "Context.h"
+#include "MultiSearcher.h"
+#include "Platform.h"
+#include "StringLike.h"
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#define UU_PACKED_SEARCH_SIMD 1
+#elif CPU(ARM64)
+#include <arm_neon.h>
+#define UU_PACKED_SEARCH_SIMD 1
+#endif
+
+namespace UU {
+
+#if UU_PACKED_SEARCH_SIMD
+
+// PackedLanes ===================================================================================
+
+// One SIMD register of bytes, with the byte shuffles the packed filter uses to look up 16-entry
+// tables. mask() works as it does for the Lanes in ByteSearch.cpp: the bits in LaneBits are set 
+// for each lane that isn't zero, Stride bits apart.
+struct PackedLanes
+{
+#if defined(__AVX2__)
+    using Reg = __m256i;
+    static constexpr Size Width = 32;
+    static constexpr int Stride = 1;
+
+    static UU_ALWAYS_INLINE Reg load(const char *ptr) { return _mm256_loadu_si256(reinterpret_cast<const Reg *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg table(const UInt8 *ptr) { 
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr))); 
+    }
+    static UU_ALWAYS_INLINE Reg low_nibbles(Reg r) { return _mm256_and_si256(r, _mm256_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg high_nibbles(Reg r) { return _mm256_and_si256(_mm256_srli_epi16(r, 4), _mm256_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg lookup(Reg table, Reg nibbles) { return _mm256_shuffle_epi8(table, nibbles); }
+    static UU_ALWAYS_INLINE Reg both(Reg a, Reg b) { return _mm256_and_si256(a, b); }
+    static UU_ALWAYS_INLINE void store(UInt8 *ptr, Reg r) { _mm256_storeu_si256(reinterpret_cast<Reg *>(ptr), r); }
+    static UU_ALWAYS_INLINE UInt64 mask(Reg r) { 
+        return ~UInt32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(r, _mm256_setzero_si256()))); 
+    }
+#elif defined(__SSSE3__)
+    using Reg = __m128i;
+    static constexpr Size Width = 16;
+    static constexpr int Stride = 1;
+
+    static UU_ALWAYS_INLINE Reg load(const char *ptr) { return _mm_loadu_si128(reinterpret_cast<const Reg *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg table(const UInt8 *ptr) { return _mm_loadu_si128(reinterpret_cast<const Reg *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg low_nibbles(Reg r) { return _mm_and_si128(r, _mm_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg high_nibbles(Reg r) { return _mm_and_si128(_mm_srli_epi16(r, 4), _mm_set1_epi8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg lookup(Reg table, Reg nibbles) { return _mm_shuffle_epi8(table, nibbles); }
+    static UU_ALWAYS_INLINE Reg both(Reg a, Reg b) { return _mm_and_si128(a, b); }
+    static UU_ALWAYS_INLINE void store(UInt8 *ptr, Reg r) { _mm_storeu_si128(reinterpret_cast<Reg *>(ptr), r); }
+    static UU_ALWAYS_INLINE UInt64 mask(Reg r) { 
+        return UInt16(~_mm_movemask_epi8(_mm_cmpeq_epi8(r, _mm_setzero_si128()))); 
+    }
+#else
+    using Reg = uint8x16_t;
+    static constexpr Size Width = 16;
+    static constexpr int Stride = 4;
+    static constexpr UInt64 LaneBits = 0x8888888888888888ULL;
+
+    static UU_ALWAYS_INLINE Reg load(const char *ptr) { return vld1q_u8(reinterpret_cast<const UInt8 *>(ptr)); }
+    static UU_ALWAYS_INLINE Reg table(const UInt8 *ptr) { return vld1q_u8(ptr); }
+    static UU_ALWAYS_INLINE Reg low_nibbles(Reg r) { return vandq_u8(r, vdupq_n_u8(0x0f)); }
+    static UU_ALWAYS_INLINE Reg high_nibbles(Reg r) { return vshrq_n_u8(r, 4); }
+    static UU_ALWAYS_INLINE Reg lookup(Reg table, Reg nibbles) { return vqtbl1q_u8(table, nibbles); }
+    static UU_ALWAYS_INLINE Reg both(Reg a, Reg b) { return vandq_u8(a, b); }
+    static UU_ALWAYS_INLINE void store(UInt8 *ptr, Reg r) { vst1q_u8(ptr, r); }
+    static UU_ALWAYS_INLINE UInt64 mask(Reg r) { 
+        Reg nonzero = vtstq_u8(r, r);
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(nonzero), 4)), 0) & LaneBits; 
+    }
+#endif
+
+    static UU_ALWAYS_INLINE Size first_lane(UInt64 mask) { return std::countr_zero(mask) / Stride; }
+    static UU_ALWAYS_INLINE UInt64 clear_first_lane(UInt64 mask) { return mask & (mask - 1); }
+};
+
+#endif  // UU_PACKED_SEARCH_SIMD
+
+// In the automaton's table, the state a transition goes to, with MatchFlag set when that state 
+// ends a pattern, so the scan only looks further when it has something to report.
+static constexpr UInt32 MatchFlag = UInt32(1) << 31;
+static constexpr UInt32 StateMask = MatchFlag - 1;
+
+// MultiSearcher =================================================================================
+
+MultiSearcher::MultiSearcher(const std::vector<std::string_view> &patterns)
+{
+    m_patterns.reserve(patterns.size());
+    Size nonempty = 0;
+    for (const auto &pattern : patterns) {
+        m_patterns.emplace_back(pattern);
+        if (pattern.length()) {
+            m_shortest = nonempty ? std::min(m_shortest, pattern.length()) : pattern.length();
+            nonempty++;
+        }
+    }
+    if (nonempty == 0) {
+        m_strategy = Strategy::Empty;
+        return;
+    }
+#if UU_PACKED_SEARCH_SIMD
+    if (nonempty <= PackedMaxPatterns) {
+        m_strategy = Strategy::Packed;
+        build_packed();
+        return;
+    }
+#endif
+    m_strategy = Strategy::Automaton;
+    build_automaton();
+}
+
+Size MultiSearcher::scan(std::string_view haystack, const Visitor &visitor) const
+{
+    switch (m_strategy) {
+        case Strategy::Empty:
+            return 0;
+        case Strategy::Packed:
+            return scan_packed(haystack, visitor);
+        case Strategy::Automaton:
+            return scan_automaton(haystack, visitor);
+    }
+    return 0;
+}
+
+Array<MultiMatch, 0> MultiSearcher::find_all(std::string_view haystack) const
+{
+    Array<MultiMatch, 0> result;
+    scan(haystack, [&result](const MultiMatch &match) {
+        result.push_back(match);
+        return true;
+    });
+    std::sort(result.begin(), result.end(), [](const MultiMatch &a, const MultiMatch &b) {
+        return a.offset < b.offset || (a.offset == b.offset && a.pattern < b.pattern);
+    });
+    return result;
+}
+
+std::vector<TextRef> MultiSearcher::text_refs(const String &filename, std::string_view contents, 
+    const Array<MultiMatch, 0> &matches) const
+{
+    std::vector<TextRef> result;
+    if (matches.is_empty()) {
+        return result;
+    }
+    result.reserve(matches.size());
+
+    // one line end lookup for all the matches, which come in order, so the lines do too
+    std::pmr::vector<Size> line_end_offsets = find_line_end_offsets(contents, matches.back().offset, SizeMax, 
+        base_memory_resource());
+    auto it = line_end_offsets.begin();
+    for (const MultiMatch &match : matches) {
+        it = std::lower_bound(it, line_end_offsets.end(), match.offset);
+        Size line = (it - line_end_offsets.begin()) + 1;
+        Size line_start = line_start_offset(contents, line_end_offsets, line);
+        Size line_end = it != line_end_offsets.end() ? *it : contents.length();
+        Size column = match.offset - line_start + 1;
+        std::string message(contents.substr(line_start, line_end - line_start));
+        result.emplace_back(match.pattern, filename, line, column, column + match.length, message);
+    }
+    return result;
+}
+
+// Packed ========================================================================================
+
+void MultiSearcher::build_packed()
+{
+    // patterns with the same first bytes share a bucket where they can, so that positions 
+    // that pass the filter for one bucket don't also pass for others
+    m_fingerprint = std::min(m_shortest, PackedMaxFingerprint);
+    Array<UInt32, 0> ids;
+    for (Size idx = 0; idx < m_patterns.size(); idx++) {
+        if (m_patterns[idx].length()) {
+            ids.push_back(UInt32(idx));
+        }
+    }
+    std::sort(ids.begin(), ids.end(), [this](UInt32 a, UInt32 b) {
+        std::string_view pa(m_patterns[a].data(), m_fingerprint);
+        std::string_view pb(m_patterns[b].data(), m_fingerprint);
+        return pa < pb || (pa == pb && a < b);
+    });
+
+    for (Size idx = 0; idx < ids.size(); idx++) {
+        Size bucket = idx * PackedBuckets / ids.size();
+        UInt32 id = ids[idx];
+        m_buckets[bucket].push_back(id);
+        for (Size k = 0; k < m_fingerprint; k++) {
+            UInt8 b = UInt8(m_patterns[id][k]);
+            m_low_nibbles[k][b & 0x0f] |= UInt8(1 << bucket);
+            m_high_nibbles[k][b >> 4] |= UInt8(1 << bucket);
+        }
+    }
+}
+
+Size MultiSearcher::scan_packed(std::string_view haystack, const Visitor &visitor) const
+{
+    const char *base = haystack.data();
+    const Size length = haystack.length();
+    if (length < m_fingerprint) {
+        return 0;
+    }
+    Size count = 0;
+
+    // compares the patterns in the buckets against the haystack at pos, and returns false 
+    // if the visitor says to stop
+    auto verify = [&](Size pos, UInt8 buckets) {
+        while (buckets) {
+            Size bucket = std::countr_zero(buckets);
+            buckets &= buckets - 1;
+            for (UInt32 id : m_buckets[bucket]) {
+                const String &pattern = m_patterns[id];
+                if (pattern.length() <= length - pos && memcmp(base + pos, pattern.data(), pattern.length()) == 0) {
+                    count++;
+                    if (!visitor(MultiMatch { id, pos, pattern.length() })) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    };
+
+    Size pos = 0;
+#if UU_PACKED_SEARCH_SIMD
+    using Lanes = PackedLanes;
+    if (length >= Lanes::Width + m_fingerprint - 1) {
+        Lanes::Reg low[PackedMaxFingerprint];
+        Lanes::Reg high[PackedMaxFingerprint];
+        for (Size k = 0; k < m_fingerprint; k++) {
+            low[k] = Lanes::table(m_low_nibbles[k].data());
+            high[k] = Lanes::table(m_high_nibbles[k].data());
+        }
+        const Size limit = length - (Lanes::Width + m_fingerprint - 1);
+        alignas(Lanes::Width) UInt8 lanes[Lanes::Width];
+        for (; pos <= limit; pos += Lanes::Width) {
+            // the buckets with a pattern that could start at each position in the block
+            Lanes::Reg bytes = Lanes::load(base + pos);
+            Lanes::Reg candidates = Lanes::both(Lanes::lookup(low[0], Lanes::low_nibbles(bytes)), 
+                Lanes::lookup(high[0], Lanes::high_nibbles(bytes)));
+            for (Size k = 1; k < m_fingerprint; k++) {
+                bytes = Lanes::load(base + pos + k);
+                candidates = Lanes::both(candidates, Lanes::both(Lanes::lookup(low[k], Lanes::low_nibbles(bytes)), 
+                    Lanes::lookup(high[k], Lanes::high_nibbles(bytes))));
+            }
+            UInt64 mask = Lanes::mask(candidates);
+            if (LIKELY(mask == 0)) {
+                continue;
+            }
+            Lanes::store(lanes, candidates);
+            for (; mask; mask = Lanes::clear_first_lane(mask)) {
+                Size lane = Lanes::first_lane(mask);
+                if (!verify(pos + lane, lanes[lane])) {
+                    return count;
+                }
+            }
+        }
+    }
+#endif
+
+    // the positions left over, looked up a byte at a time
+    for (; pos + m_fingerprint <= length; pos++) {
+        UInt8 buckets = 0xff;
+        for (Size k = 0; k < m_fingerprint; k++) {
+            UInt8 b = UInt8(base[pos + k]);
+            buckets &= m_low_nibbles[k][b & 0x0f] & m_high_nibbles[k][b >> 4];
+        }
+        if (buckets && !verify(pos, buckets)) {
+            return count;
+        }
+    }
+    return count;
+}
+
+// Automaton =====================================================================================
+
+void MultiSearcher::build_automaton()
+{
+    // a column for each byte that appears in a pattern, and column zero for all the others
+    m_class_count = 1;
+    for (const String &pattern : m_patterns) {
+        for (char c : pattern) {
+            if (m_classes[UInt8(c)] == 0) {
+                m_classes[UInt8(c)] = UInt16(m_class_count++);
+            }
+        }
+    }
+
+    // the trie, with zero standing for no transition, which is safe since no transition 
+    // leads back to the root
+    const Size columns = m_class_count;
+    m_states.emplace_back();
+    m_transitions.resize(columns, 0);
+    Array<std::pair<UInt32, UInt32>, 0> ends;
+    for (Size idx = 0; idx < m_patterns.size(); idx++) {
+        const String &pattern = m_patterns[idx];
+        if (pattern.is_empty()) {
+            continue;
+        }
+        UInt32 state = 0;
+        for (char c : pattern) {
+            Size cell = state * columns + m_classes[UInt8(c)];
+            if (m_transitions[cell] == 0) {
+                ASSERT_WITH_MESSAGE(m_states.size() < StateMask, "MultiSearcher has too many states");
+                m_transitions[cell] = UInt32(m_states.size());
+                m_states.emplace_back();
+                m_transitions.resize(m_transitions.size() + columns, 0);
+            }
+            state = m_transitions[cell];
+        }
+        ends.emplace_back(state, UInt32(idx));
+    }
+
+    std::sort(ends.begin(), ends.end());
+    for (Size idx = 0; idx < ends.size(); idx++) {
+        State &state = m_states[ends[idx].first];
+        if (state.outputs_begin == state.outputs_end) {
+            state.outputs_begin = UInt32(idx);
+        }
+        state.outputs_end = UInt32(idx + 1);
+        m_outputs.push_back(ends[idx].second);
+    }
+
+    // breadth first, so each state's fail state has its row filled in before the state does,
+    // and missing transitions can be copied from there
+    m_states[0].output_link = NoState;
+    Array<UInt32, 0> queue;
+    for (Size c = 0; c < columns; c++) {
+        UInt32 next = m_transitions[c];
+        if (next) {
+            m_states[next].fail = 0;
+            queue.push_back(next);
+        }
+    }
+    for (Size head = 0; head < queue.size(); head++) {
+        UInt32 state = queue[head];
+        State &s = m_states[state];
+        s.output_link = s.outputs_begin != s.outputs_end ? state : m_states[s.fail].output_link;
+        Size row = state * columns;
+        Size fail_row = s.fail * columns;
+        for (Size c = 0; c < columns; c++) {
+            UInt32 next = m_transitions[row + c];
+            if (next) {
+                m_states[next].fail = m_transitions[fail_row + c];
+                queue.push_back(next);
+            }
+            else {
+                m_transitions[row + c] = m_transitions[fail_row + c];
+            }
+        }
+    }
+
+    for (UInt32 &next : m_transitions) {
+        if (m_states[next].output_link != NoState) {
+            next |= MatchFlag;
+        }
+    }
+}
+
+Size MultiSearcher::scan_automaton(std::string_view haystack, const Visitor &visitor) const
+{
+    const UInt8 *bytes = reinterpret_cast<const UInt8 *>(haystack.data());
+    const Size length = haystack.length();
+    const UInt32 *transitions = m_transitions.data();
+    const Size columns = m_class_count;
+    Size count = 0;
+    UInt32 state = 0;
+    for (Size pos = 0; pos < length; pos++) {
+        UInt32 next = transitions[state * columns + m_classes[bytes[pos]]];
+        state = next & StateMask;
+        if (LIKELY((next & MatchFlag) == 0)) {
+            continue;
+        }
+        // every pattern that ends here: this state's, and those of the states along its 
+        // fail links, which are suffixes of it
+        Size end = pos + 1;
+        for (UInt32 out = m_states[state].output_link; out != NoState; out = m_states[m_states[out].fail].output_link) {
+            const State &s = m_states[out];
+            for (UInt32 idx = s.outputs_begin; idx < s.outputs_end; idx++) {
+                UInt32 id = m_outputs[idx];
+                Size pattern_length = m_patterns[id].length();
+                count++;
+                if (!visitor(MultiMatch { id, end - pattern_length, pattern_length })) {
+                    return count;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+}  // namespace UU
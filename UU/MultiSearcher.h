@@ -0,0 +1,157 @@
+//
+// MultiSearcher.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef UU_MULTI_SEARCHER_H
+#define UU_MULTI_SEARCHER_H
+
+#include <array>
+#include <functional>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+#include <UU/Array.h>
+#include <UU/MappedFile.h>
+#include <UU/TextRef.h>
+#include <UU/Types.h>
+#include <UU/UUString.h>
+
+namespace UU {
+
+// MultiMatch =====================================================================================
+
+// One occurrence of one of a MultiSearcher's patterns: the pattern's index in the list the
+// searcher was made from, and the offset and length of the match in the haystack.
+struct MultiMatch
+{
+    Size pattern = 0;
+    Size offset = 0;
+    Size length = 0;
+
+    bool operator==(const MultiMatch &) const = default;
+};
+
+// MultiSearcher ==================================================================================
+
+// A set of patterns compiled once for finding all of them in a single pass over any number of
+// haystacks. Like Searcher, it doesn't change after it's made, so one can be shared by any 
+// number of threads.
+//
+// Strategies:
+//   Packed: for small sets, a Teddy-style SIMD filter. Patterns are put in eight buckets, and
+//       the first few bytes of each block of positions are looked up, a nibble at a time, in 
+//       tables of the buckets that have a pattern with that byte there. Only positions with a
+//       bucket left over get compared against the patterns in it. Used when the compiler 
+//       targets SSSE3, AVX2, or NEON, which have the byte shuffles the lookups need.
+//   Automaton: an Aho-Corasick DFA, with its failure transitions folded into the table, so
+//       each byte of the haystack costs one table lookup however many patterns there are.
+//       Bytes that appear in no pattern share a column, which keeps the table small.
+//
+// Every occurrence of every pattern is reported, including those that overlap. Empty patterns 
+// never match. Patterns listed more than once are reported once for each index.
+//
+class MultiSearcher
+{
+public:
+    enum class Strategy { Empty, Packed, Automaton };
+
+    // Sets with more patterns than this use the automaton.
+    static constexpr Size PackedMaxPatterns = 32;
+    static constexpr Size PackedBuckets = 8;
+    static constexpr Size PackedMaxFingerprint = 3;
+
+    using Visitor = std::function<bool(const MultiMatch &)>;
+
+    explicit MultiSearcher(const std::vector<std::string_view> &patterns);
+    MultiSearcher(std::initializer_list<std::string_view> patterns) : 
+        MultiSearcher(std::vector<std::string_view>(patterns)) {}
+    template <typename Range> explicit MultiSearcher(const Range &patterns) : 
+        MultiSearcher(to_string_views(patterns)) {}
+
+    Size pattern_count() const { return m_patterns.size(); }
+    const String &pattern(Size idx) const { return m_patterns[idx]; }
+    Strategy strategy() const { return m_strategy; }
+
+    // Calls the visitor with each match, as it is found. The automaton finds matches in order
+    // of where they end, and the packed filter in order of where they start. The visitor 
+    // returns false to stop early. Returns the number of matches visited.
+    Size scan(std::string_view haystack, const Visitor &visitor) const;
+    Size scan(const MappedFile &file, const Visitor &visitor) const { return scan(file.contents(), visitor); }
+
+    // Every match, sorted by offset, then by pattern.
+    Array<MultiMatch, 0> find_all(std::string_view haystack) const;
+    Array<MultiMatch, 0> find_all(const MappedFile &file) const { return find_all(file.contents()); }
+
+    // One TextRef for each of the matches, which must be sorted as find_all() returns them. Each
+    // has the pattern as its index, the line and columns of the match, and the line as its message.
+    std::vector<TextRef> text_refs(const String &filename, std::string_view contents, 
+        const Array<MultiMatch, 0> &matches) const;
+
+private:
+    template <typename Range> static std::vector<std::string_view> to_string_views(const Range &patterns) {
+        std::vector<std::string_view> result;
+        for (const auto &pattern : patterns) {
+            result.emplace_back(std::string_view(pattern));
+        }
+        return result;
+    }
+
+    void build_packed();
+    void build_automaton();
+    Size scan_packed(std::string_view haystack, const Visitor &visitor) const;
+    Size scan_automaton(std::string_view haystack, const Visitor &visitor) const;
+
+    struct State
+    {
+        // the state for the longest proper suffix of this one's text that is also in the trie
+        UInt32 fail = 0;
+        // this state, or the nearest along its fail links, that ends a pattern, or NoState
+        UInt32 output_link = 0;
+        // this state's patterns, in m_outputs
+        UInt32 outputs_begin = 0;
+        UInt32 outputs_end = 0;
+    };
+    static constexpr UInt32 NoState = UInt32Max;
+
+    Array<String, 0> m_patterns;
+    Strategy m_strategy = Strategy::Empty;
+    Size m_shortest = 0;
+
+    // Packed
+    Size m_fingerprint = 0;
+    std::array<std::array<UInt8, 16>, PackedMaxFingerprint> m_low_nibbles = {};
+    std::array<std::array<UInt8, 16>, PackedMaxFingerprint> m_high_nibbles = {};
+    std::array<Array<UInt32, 0>, PackedBuckets> m_buckets;
+
+    // Automaton
+    std::array<UInt16, 256> m_classes = {};
+    Size m_class_count = 0;
+    Array<UInt32, 0> m_transitions;
+    Array<State, 0> m_states;
+    Array<UInt32, 0> m_outputs;
+};
+
+}  // namespace UU
+
+#endif  // UU_MULTI_SEARCHER_H
@@ -0,0 +1,136 @@
+//
+// ObjectPool.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_OBJECT_POOL_H
+#define UU_OBJECT_POOL_H
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <UU/Allocator.h>
+#include <UU/PageMap.h>
+#include <UU/Types.h>
+
+namespace UU {
+
+// ObjectPool =====================================================================================
+
+// A pool of same-sized T objects, packed into slots of a CascadingAllocator of BlockAllocators
+// with no per-object header. create() constructs an object in place in a free slot, and 
+// destroy() runs its destructor and frees the slot; both take constant time, and the slot for
+// an object is found through the PageMap. clear() destroys every live object at once and gives
+// back all the pool's memory. For a trivially destructible T, clear() skips the walk over
+// live objects.
+//
+// A pool holds up to ObjectsPerBlock * MaxBlocks objects, and create() returns nullptr once 
+// they are all in use. Like the allocators it is built from, a pool is not thread-safe, and
+// since it carries the bookkeeping for all its blocks, it is meant to live for a while, 
+// on the heap or in static storage, rather than on the stack.
+//
+template <typename T, Size ObjectsPerBlock = 1024, Size MaxBlocks = 1024> requires 
+    IsMutipleOf64<ObjectsPerBlock> && IsLessThanOrEqual<alignof(T), PageMap::PageSize>
+class ObjectPool
+{
+public:
+    static constexpr Size SlotAlignment = alignof(T) > alignof(void *) ? alignof(T) : alignof(void *);
+    static constexpr Size SlotSize = (sizeof(T) + SlotAlignment - 1) & ~(SlotAlignment - 1);
+
+    struct Deleter {
+        ObjectPool *pool = nullptr;
+        void operator()(T *ptr) const { pool->destroy(ptr); }
+    };
+
+    using UniquePtr = std::unique_ptr<T, Deleter>;
+
+    ObjectPool() {}
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    ~ObjectPool() {
+        clear();
+    }
+
+    template <typename... Args>
+    T *create(Args &&...args) {
+        Memory mem = m_allocator.alloc(SlotSize);
+        if (UNLIKELY(mem.is_empty())) {
+            return nullptr;
+        }
+        T *ptr = new (mem.ptr) T(std::forward<Args>(args)...);
+        m_count++;
+        return ptr;
+    }
+
+    template <typename... Args>
+    UniquePtr make_unique(Args &&...args) {
+        return UniquePtr(create(std::forward<Args>(args)...), Deleter { this });
+    }
+
+    void destroy(T *ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        ASSERT(owns(ptr));
+        ptr->~T();
+        Memory mem(ptr, SlotSize);
+        m_allocator.dealloc(mem);
+        m_count--;
+    }
+
+    // Destroys every object in the pool and frees all its blocks. Pointers to the pool's
+    // objects, including any held in a UniquePtr, must not be used afterwards.
+    void clear() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            m_allocator.for_each_allocated([](const Memory &mem) {
+                static_cast<T *>(mem.ptr)->~T();
+            });
+        }
+        m_allocator.free_all();
+        m_count = 0;
+    }
+
+    bool owns(const T *ptr) const {
+        return m_allocator.owns(Memory(const_cast<T *>(ptr), SlotSize));
+    }
+
+    Size count() const {
+        return m_count;
+    }
+
+    // Frees blocks left empty by destroy(), as CascadingAllocator::trim() does.
+    Size trim() {
+        return m_allocator.trim();
+    }
+
+private:
+    CascadingAllocator<BlockAllocator<ObjectsPerBlock, SlotSize>, MaxBlocks> m_allocator;
+    Size m_count = 0;
+};
+
+}  // namespace UU
+
+#endif  // UU_OBJECT_POOL_H
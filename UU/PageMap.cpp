@@ -0,0 +1,87 @@
+//
+// PageMap.cpp
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "PageMap.h"
+
+namespace UU {
+
+std::atomic<PageMap::Interior *> PageMap::s_root[PageMap::LevelCount];
+
+PageMap::Leaf *PageMap::ensure_leaf(UInt64 page)
+{
+    std::atomic<Interior *> &root_slot = s_root[root_index(page)];
+    Interior *interior = root_slot.load(std::memory_order_acquire);
+    if (interior == nullptr) {
+        Interior *fresh = new Interior;
+        if (root_slot.compare_exchange_strong(interior, fresh, std::memory_order_acq_rel)) {
+            interior = fresh;
+        }
+        else {
+            // another thread won the race and interior now holds its node
+            delete fresh;
+        }
+    }
+
+    std::atomic<Leaf *> &interior_slot = interior->leaves[interior_index(page)];
+    Leaf *leaf = interior_slot.load(std::memory_order_acquire);
+    if (leaf == nullptr) {
+        Leaf *fresh = new Leaf;
+        if (interior_slot.compare_exchange_strong(leaf, fresh, std::memory_order_acq_rel)) {
+            leaf = fresh;
+        }
+        else {
+            delete fresh;
+        }
+    }
+    return leaf;
+}
+
+void PageMap::set(const void *base, Size length, void *owner)
+{
+    UInt64 addr = reinterpret_cast<UInt64>(base);
+    ASSERT((addr & (PageSize - 1)) == 0);
+    ASSERT_WITH_MESSAGE(((addr + length) >> AddressBits) == 0, "address out of range for PageMap: %p", base);
+
+    UInt64 first = addr >> PageShift;
+    UInt64 last = (addr + length + PageSize - 1) >> PageShift;
+    for (UInt64 page = first; page < last; page++) {
+        Leaf *leaf = nullptr;
+        if (owner == nullptr) {
+            Interior *interior = s_root[root_index(page)].load(std::memory_order_acquire);
+            if (interior) {
+                leaf = interior->leaves[interior_index(page)].load(std::memory_order_acquire);
+            }
+            if (leaf == nullptr) {
+                continue;
+            }
+        }
+        else {
+            leaf = ensure_leaf(page);
+        }
+        leaf->owners[leaf_index(page)].store(owner, std::memory_order_release);
+    }
+}
+
+}  // namespace UU
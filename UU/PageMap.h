@@ -0,0 +1,103 @@
+//
+// PageMap.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_PAGE_MAP_H
+#define UU_PAGE_MAP_H
+
+#include <atomic>
+
+#include <UU/Assertions.h>
+#include <UU/Types.h>
+
+namespace UU {
+
+// PageMap maps any address to the owner registered for the 4KB page it falls in, in a
+// constant number of steps no matter how many pages are registered. It is a three-level
+// radix tree over the 36-bit page number of a 48-bit address, and there is only one, shared
+// by every allocator in the process.
+//
+// Lookups take no locks. Interior nodes are installed with compare-and-swap and never freed,
+// and registering or clearing a range touches only its own leaf entries, so callers only need
+// to serialize set() and clear() for the same range, which owners do as a matter of course.
+//
+class PageMap
+{
+public:
+    static constexpr Size PageShift = 12;
+    static constexpr Size PageSize = Size(1) << PageShift;
+    static constexpr Size AddressBits = 48;
+
+    // Registers owner for every page in [base, base + length). base must be page-aligned.
+    static void set(const void *base, Size length, void *owner);
+
+    // Clears the owner for every page in [base, base + length).
+    static void clear(const void *base, Size length) { set(base, length, nullptr); }
+
+    // Returns the owner registered for the page containing ptr, or nullptr if there is none.
+    UU_ALWAYS_INLINE static void *get(const void *ptr) {
+        UInt64 page = reinterpret_cast<UInt64>(ptr) >> PageShift;
+        if (UNLIKELY(page >> (LevelBits * 3))) {
+            return nullptr;
+        }
+        Interior *interior = s_root[root_index(page)].load(std::memory_order_acquire);
+        if (interior == nullptr) {
+            return nullptr;
+        }
+        Leaf *leaf = interior->leaves[interior_index(page)].load(std::memory_order_acquire);
+        if (leaf == nullptr) {
+            return nullptr;
+        }
+        return leaf->owners[leaf_index(page)].load(std::memory_order_acquire);
+    }
+
+    static constexpr Size round_up_to_page_size(Size length) {
+        return (length + PageSize - 1) & ~(PageSize - 1);
+    }
+
+private:
+    static constexpr Size LevelBits = (AddressBits - PageShift) / 3;
+    static constexpr Size LevelCount = Size(1) << LevelBits;
+    static constexpr Size LevelMask = LevelCount - 1;
+
+    struct Leaf {
+        std::atomic<void *> owners[LevelCount] = {};
+    };
+
+    struct Interior {
+        std::atomic<Leaf *> leaves[LevelCount] = {};
+    };
+
+    UU_ALWAYS_INLINE static constexpr Size root_index(UInt64 page) { return (page >> (LevelBits * 2)) & LevelMask; }
+    UU_ALWAYS_INLINE static constexpr Size interior_index(UInt64 page) { return (page >> LevelBits) & LevelMask; }
+    UU_ALWAYS_INLINE static constexpr Size leaf_index(UInt64 page) { return page & LevelMask; }
+
+    static Leaf *ensure_leaf(UInt64 page);
+
+    static std::atomic<Interior *> s_root[LevelCount];
+};
+
+}  // namespace UU
+
+#endif  // UU_PAGE_MAP_H
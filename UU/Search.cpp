@@ -0,0 +1,254 @@
+//
+// Search.cpp
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <mutex>
+
+#include "Assertions.h"
+#include "Context.h"
+#include "FileLike.h"
+#include "MappedFile.h"
+#include "Search.h"
+#include "Spread.h"
+#include "StringLike.h"
+#include "ThreadPool.h"
+#include "UnixLike.h"
+
+namespace fs = std::filesystem;
+
+namespace UU {
+
+// Shared state for one call to run(). All results funnel through emit(),
+// which serializes callbacks.
+struct Search::Run
+{
+    Run(const Callback &callback_, Size limit_) : callback(callback_), limit(limit_) {}
+
+    bool is_stopped() const { return stopped.load(std::memory_order_relaxed); }
+
+    bool emit(TextRef &ref) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (results >= limit) {
+            stopped = true;
+            return false;
+        }
+        results++;
+        ref.set_index(results);
+        callback(ref);
+        if (results >= limit) {
+            stopped = true;
+            return false;
+        }
+        return true;
+    }
+
+    const Callback &callback;
+    const Size limit;
+    std::mutex mutex;
+    Size results = 0;
+    std::atomic_bool stopped = false;
+};
+
+Search::Search(const String &needle, Mode mode, int flags) : 
+    m_needle(needle), m_mode(mode), m_flags(flags), 
+    m_searcher(needle, (flags & CaseInsensitive) ? Searcher::Case::Insensitive : Searcher::Case::Sensitive)
+{
+}
+
+std::vector<fs::path> Search::walk(const std::vector<fs::path> &roots) const
+{
+    std::vector<fs::path> skippables;
+    if (m_flags & SkipSkippables) {
+        skippables = skippable_paths();
+    }
+    std::vector<fs::path> searchables;
+    if (m_flags & OnlySearchables) {
+        searchables = searchable_paths();
+    }
+
+    std::vector<fs::path> result;
+    for (const auto &root : roots) {
+        std::error_code ec;
+        if (fs::is_regular_file(root, ec)) {
+            result.push_back(root);
+            continue;
+        }
+        auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            LOG(Error, "Search: cannot walk: %s: %s", root.c_str(), ec.message().c_str());
+            continue;
+        }
+        for (auto end = fs::recursive_directory_iterator(); it != end; it.increment(ec)) {
+            if (ec) {
+                LOG(Error, "Search: walk error: %s: %s", root.c_str(), ec.message().c_str());
+                break;
+            }
+            const fs::path &path = it->path();
+            if (skippables.size() && is_skippable(skippables, path)) {
+                if (it->is_directory(ec)) {
+                    it.disable_recursion_pending();
+                }
+                continue;
+            }
+            if (!it->is_regular_file(ec)) {
+                continue;
+            }
+            if (searchables.size() && !is_searchable(searchables, path)) {
+                continue;
+            }
+            result.push_back(path);
+        }
+    }
+    return result;
+}
+
+Size Search::run(const std::vector<fs::path> &roots, const Callback &callback) const
+{
+    std::vector<fs::path> paths = walk(roots);
+    Run run(callback, m_limit);
+
+    Size concurrency = m_concurrency > 0 ? m_concurrency : get_good_concurrency_count();
+    Size workers = std::min(concurrency, paths.size());
+    if (workers <= 1) {
+        for (const auto &path : paths) {
+            if (run.is_stopped()) {
+                break;
+            }
+            search_file(run, path);
+        }
+    }
+    else {
+        // the calling thread helps out in parallel_for, so it counts as one of the workers.
+        // the pool is sized by concurrency rather than by this run's file count, so the same
+        // pool serves every run.
+        std::shared_ptr<ThreadPool> pool = thread_pool(concurrency - 1);
+        // a handful of chunks per worker keeps queue traffic low while still leaving chunks
+        // to steal when some files take much longer than others
+        Size grain = std::max<Size>(paths.size() / (workers * 8), 1);
+        pool->parallel_for(0, paths.size(), [this, &run, &paths](Size idx) {
+            if (!run.is_stopped()) {
+                search_file(run, paths[idx]);
+            }
+        }, grain);
+    }
+
+    return run.results;
+}
+
+std::shared_ptr<ThreadPool> Search::thread_pool(Size thread_count) const
+{
+    // a run still using a pool of the old size keeps it alive through its own reference
+    std::lock_guard<std::mutex> lock(m_pool_mutex);
+    if (!m_pool || m_pool->thread_count() != thread_count) {
+        m_pool = std::make_shared<ThreadPool>(thread_count);
+    }
+    return m_pool;
+}
+
+Size Search::scan(const std::string_view &contents, const std::function<bool(Size)> &visitor) const
+{
+    if (m_needle.length() == 0) {
+        return 0;
+    }
+
+    Size count = 0;
+    for (Size offset : m_searcher.matches(contents)) {
+        count++;
+        if (!visitor(offset)) {
+            break;
+        }
+    }
+    return count;
+}
+
+void Search::search_file(Run &run, const fs::path &path) const
+{
+    // MappedFile refuses to map zero-length files, and there is nothing to find in them
+    std::error_code ec;
+    if (fs::file_size(path, ec) == 0 || ec) {
+        return;
+    }
+
+    MappedFile file(path);
+    if (file.is_valid<false>()) {
+        return;
+    }
+    std::string_view contents = file.contents();
+
+    switch (m_mode) {
+        case Mode::FilesWithMatches: {
+            Size count = scan(contents, [](Size) { return false; });
+            if (count) {
+                TextRef ref(path.string());
+                run.emit(ref);
+            }
+            break;
+        }
+        case Mode::Count: {
+            Size count = scan(contents, [&run](Size) { return !run.is_stopped(); });
+            if (count) {
+                TextRef ref(path.string(), TextRef::Invalid, TextRef::Invalid, integer_to_string(count));
+                run.emit(ref);
+            }
+            break;
+        }
+        case Mode::Refs: {
+            // these come and go with every file, so take them from the pooled base allocator
+            std::pmr::vector<Size> matches(base_memory_resource());
+            scan(contents, [&run, &matches](Size offset) { 
+                matches.push_back(offset); 
+                return !run.is_stopped(); 
+            });
+            if (matches.empty()) {
+                break;
+            }
+
+            // one line end lookup for the whole file, then group the matches by line
+            std::pmr::vector<Size> line_end_offsets = find_line_end_offsets(contents, matches.back(), SizeMax, base_memory_resource());
+            String filename = path.string();
+            Size idx = 0;
+            while (idx < matches.size()) {
+                auto it = std::lower_bound(line_end_offsets.begin(), line_end_offsets.end(), matches[idx]);
+                Size line = (it - line_end_offsets.begin()) + 1;
+                Size line_start = line_start_offset(contents, line_end_offsets, line);
+                Size line_end = it != line_end_offsets.end() ? *it : contents.length();
+                Spread<Size> spread;
+                while (idx < matches.size() && matches[idx] < line_end) {
+                    Size column = matches[idx] - line_start + 1;
+                    spread.add(column, column + m_needle.length());
+                    idx++;
+                }
+                std::string message(contents.substr(line_start, line_end - line_start));
+                TextRef ref(TextRef::Invalid, filename, line, spread, message);
+                if (!run.emit(ref)) {
+                    break;
+                }
+            }
+            break;
+        }
+    }
+}
+
+}  // namespace UU
@@ -0,0 +1,115 @@
+//
+// Search.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_SEARCH_H
+#define UU_SEARCH_H
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <UU/Searcher.h>
+#include <UU/TextRef.h>
+#include <UU/ThreadPool.h>
+#include <UU/Types.h>
+#include <UU/UUString.h>
+
+namespace UU {
+
+// Search walks one or more file trees, shards the files it finds across worker threads,
+// maps each file into memory, looks for a needle, and streams the results as TextRefs.
+//
+// Results are delivered to the callback one at a time, in no particular file order, but
+// always serialized, so callbacks need not do their own locking.
+//
+// In Refs mode, there is one TextRef per matching line, with a spread covering every match
+// on the line and the line text as the message. In Count mode, there is one TextRef per
+// matching file, with the match count as the message. In FilesWithMatches mode, there is
+// one TextRef per matching file, and the search of each file stops at its first match.
+//
+class Search
+{
+public:
+    enum class Mode { Refs, Count, FilesWithMatches };
+
+    static constexpr int SkipSkippables =  0x1;
+    static constexpr int OnlySearchables = 0x2;
+    // ASCII letters match in either case. Files are folded as they are searched, not copied.
+    static constexpr int CaseInsensitive = 0x4;
+
+    using Callback = std::function<void(const TextRef &)>;
+
+    Search(const String &needle, Mode mode = Mode::Refs, int flags = 0);
+    Search(const Search &) = delete;
+    Search &operator=(const Search &) = delete;
+
+    const String &needle() const { return m_needle; }
+    Mode mode() const { return m_mode; }
+    int flags() const { return m_flags; }
+
+    // The number of worker threads. Zero, the default, means get_good_concurrency_count().
+    int concurrency() const { return m_concurrency; }
+    void set_concurrency(int concurrency) { m_concurrency = concurrency; }
+
+    // Stop all workers once this many results have been delivered. SizeMax means no limit.
+    Size limit() const { return m_limit; }
+    void set_limit(Size limit) { m_limit = limit; }
+
+    // Walks the roots and returns the files to be searched, honoring the flags.
+    std::vector<std::filesystem::path> walk(const std::vector<std::filesystem::path> &roots) const;
+
+    // Searches all files under the roots. Returns the number of results delivered.
+    Size run(const std::vector<std::filesystem::path> &roots, const Callback &callback) const;
+
+    // Searches the contents of a single file or string, calling the visitor with the
+    // offset of each match. Returns the number of matches visited. The visitor returns
+    // false to stop early.
+    Size scan(const std::string_view &contents, const std::function<bool(Size)> &visitor) const;
+
+private:
+    struct Run;
+
+    void search_file(Run &run, const std::filesystem::path &path) const;
+    std::shared_ptr<ThreadPool> thread_pool(Size thread_count) const;
+
+    String m_needle;
+    Mode m_mode = Mode::Refs;
+    int m_flags = 0;
+    int m_concurrency = 0;
+    Size m_limit = SizeMax;
+    Searcher m_searcher;
+
+    // kept from one run to the next, so its threads start only once
+    mutable std::mutex m_pool_mutex;
+    mutable std::shared_ptr<ThreadPool> m_pool;
+};
+
+}  // namespace UU
+
+#endif  // UU_SEARCH_H
@@ -0,0 +1,149 @@
+//
+// Searcher.cpp
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <cstring>
+
+#include "ByteSearch.h"
+#include "CaseFold.h"
+#include "Searcher.h"
+
+namespace UU {
+
+Searcher::Searcher(std::string_view needle, Case letter_case) : m_needle(needle), m_case(letter_case)
+{
+    Size length = needle.length();
+    if (length == 0) {
+        m_strategy = Strategy::Empty;
+        return;
+    }
+    if (letter_case == Case::UnicodeInsensitive) {
+        // an ASCII needle can only match ASCII text, unless it has an s or a k, which U+017F ſ
+        // and U+212A K fold to
+        for (char c : needle) {
+            if (UInt8(c) >= 0x80 || c == 's' || c == 'S' || c == 'k' || c == 'K') {
+                m_strategy = Strategy::Unicode;
+                m_folded = fold_case(needle);
+                return;
+            }
+        }
+        m_strategy = Strategy::FoldedFilter;
+        return;
+    }
+    if (letter_case == Case::Insensitive) {
+        m_strategy = Strategy::FoldedFilter;
+        return;
+    }
+    if (length == 1) {
+        m_strategy = Strategy::Byte;
+        return;
+    }
+
+    // Horspool skips by up to the needle's length past any byte that isn't in the needle, 
+    // so it only pays for long needles with enough different bytes to make skips long
+    bool seen[256] = {};
+    Size distinct = 0;
+    for (char c : needle) {
+        UInt8 b = UInt8(c);
+        if (!seen[b]) {
+            seen[b] = true;
+            distinct++;
+        }
+    }
+    if (length < HorspoolMinLength || distinct < HorspoolMinDistinctBytes || length > UInt32Max) {
+        m_strategy = Strategy::Filter;
+        return;
+    }
+
+    m_strategy = Strategy::Horspool;
+    m_skips.fill(UInt32(length));
+    for (Size idx = 0; idx < length - 1; idx++) {
+        m_skips[UInt8(needle[idx])] = UInt32(length - 1 - idx);
+    }
+}
+
+Size Searcher::find(std::string_view haystack, Size pos, Size *match_length) const
+{
+    if (pos > haystack.length()) {
+        return npos;
+    }
+    const char *base = haystack.data();
+    const char *match = nullptr;
+    switch (m_strategy) {
+        case Strategy::Empty:
+            if (match_length) {
+                *match_length = 0;
+            }
+            return pos;
+        case Strategy::Byte:
+            match = find_byte(base + pos, base + haystack.length(), m_needle[0]);
+            break;
+        case Strategy::Filter:
+            match = find_substring(base + pos, base + haystack.length(), m_needle.data(), m_needle.length());
+            break;
+        case Strategy::Horspool:
+            match = find_horspool(haystack, pos);
+            break;
+        case Strategy::FoldedFilter:
+            match = find_substring_case_insensitive(base + pos, base + haystack.length(), m_needle.data(), m_needle.length());
+            break;
+        case Strategy::Unicode:
+            return find_folded_utf8(haystack, m_folded, pos, match_length);
+    }
+    if (match && match_length) {
+        *match_length = m_needle.length();
+    }
+    return match ? Size(match - base) : npos;
+}
+
+Array<Size, 0> Searcher::find_all(std::string_view haystack) const
+{
+    Array<Size, 0> result;
+    for (Size pos : matches(haystack)) {
+        result.push_back(pos);
+    }
+    return result;
+}
+
+const char *Searcher::find_horspool(std::string_view haystack, Size pos) const
+{
+    const Size length = m_needle.length();
+    if (length > haystack.length()) {
+        return nullptr;
+    }
+    const char *needle = m_needle.data();
+    const char last_byte = needle[length - 1];
+    const char *base = haystack.data();
+    const Size limit = haystack.length() - length;
+    for (Size idx = pos; idx <= limit; ) {
+        char c = base[idx + length - 1];
+        if (c == last_byte && memcmp(base + idx, needle, length - 1) == 0) {
+            return base + idx;
+        }
+        idx += m_skips[UInt8(c)];
+    }
+    return nullptr;
+}
+
+}  // namespace UU
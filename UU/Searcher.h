@@ -0,0 +1,159 @@
+//
+// Searcher.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_SEARCHER_H
+#define UU_SEARCHER_H
+
+#include <array>
+#include <iterator>
+#include <string_view>
+
+#include <UU/Array.h>
+#include <UU/MappedFile.h>
+#include <UU/Types.h>
+#include <UU/UUString.h>
+
+namespace UU {
+
+// Searcher =======================================================================================
+
+// A needle compiled once for searching any number of haystacks. The constructor picks a 
+// strategy from the needle's length and the variety of its bytes, and builds whatever tables
+// it needs, so each search only scans. A Searcher doesn't change after it's made, so one can
+// be shared by any number of threads.
+//
+// Strategies:
+//   Byte: a one-byte needle, found with find_byte().
+//   Filter: find_substring(), which compares the needle's first and last bytes against a block 
+//       of positions at once with SIMD instructions, and fully compares only the candidates.
+//   Horspool: Boyer-Moore-Horspool, with its skip table built once. Used for long needles of
+//       varied bytes, where the skips are long.
+//   FoldedFilter: find_substring_case_insensitive(), which works like Filter on blocks of the
+//       haystack with their ASCII letters folded to lower case, so the haystack is never copied.
+//   Unicode: find_folded_utf8(), with the needle folded once, for Unicode case insensitivity.
+//       Needles that are ASCII without an s or a k, the only ASCII letters that characters 
+//       outside ASCII fold to, use FoldedFilter instead.
+//
+// find_all() and matches() report matches that don't overlap, left to right, as Search does.
+//
+class Searcher
+{
+public:
+    enum class Strategy { Empty, Byte, Filter, Horspool, FoldedFilter, Unicode };
+
+    // Whether letters match only themselves, ASCII letters match in either case, or UTF-8 text 
+    // matches by Unicode simple case folding, as in CaseFold.h.
+    enum class Case { Sensitive, Insensitive, UnicodeInsensitive };
+
+    static constexpr Size npos = SizeMax;
+
+    // Horspool needs needles at least this long, with at least HorspoolMinDistinctBytes 
+    // different bytes in them.
+    static constexpr Size HorspoolMinLength = 32;
+    static constexpr Size HorspoolMinDistinctBytes = 8;
+
+    explicit Searcher(std::string_view needle, Case letter_case = Case::Sensitive);
+
+    const String &needle() const { return m_needle; }
+    Case letter_case() const { return m_case; }
+    Strategy strategy() const { return m_strategy; }
+
+    // The offset of the first match at or after pos, or npos. An empty needle matches at pos.
+    // The length of the match is stored in match_length, when given, since with Unicode case
+    // folding it can differ from the needle's.
+    Size find(std::string_view haystack, Size pos = 0, Size *match_length = nullptr) const;
+    Size find(const MappedFile &file, Size pos = 0, Size *match_length = nullptr) const { 
+        return find(file.contents(), pos, match_length); 
+    }
+
+    // The offsets of every match.
+    Array<Size, 0> find_all(std::string_view haystack) const;
+    Array<Size, 0> find_all(const MappedFile &file) const { return find_all(file.contents()); }
+
+    class MatchIterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Size;
+        using difference_type = ptrdiff_t;
+        using pointer = const Size *;
+        using reference = const Size &;
+
+        MatchIterator() {}
+        MatchIterator(const Searcher *searcher, std::string_view haystack, Size pos = 0) : 
+            m_searcher(searcher), m_haystack(haystack) {
+            m_pos = m_searcher->find(m_haystack, pos, &m_length);
+        }
+
+        const Size &operator*() const { return m_pos; }
+        const Size *operator->() const { return &m_pos; }
+
+        MatchIterator &operator++() {
+            Size step = m_length ? m_length : 1;
+            m_pos = m_pos + step <= m_haystack.length() ? m_searcher->find(m_haystack, m_pos + step, &m_length) : npos;
+            return *this;
+        }
+
+        MatchIterator operator++(int) { MatchIterator tmp = *this; ++*this; return tmp; }
+
+        bool operator==(const MatchIterator &other) const { return m_pos == other.m_pos; }
+
+    private:
+        const Searcher *m_searcher = nullptr;
+        std::string_view m_haystack;
+        Size m_pos = npos;
+        Size m_length = 0;
+    };
+
+    // A range over the offsets of the matches in a haystack, found as the range is iterated.
+    class Matches
+    {
+    public:
+        Matches(const Searcher *searcher, std::string_view haystack) : m_searcher(searcher), m_haystack(haystack) {}
+
+        MatchIterator begin() const { return MatchIterator(m_searcher, m_haystack); }
+        MatchIterator end() const { return MatchIterator(); }
+
+    private:
+        const Searcher *m_searcher;
+        std::string_view m_haystack;
+    };
+
+    Matches matches(std::string_view haystack) const { return Matches(this, haystack); }
+    Matches matches(const MappedFile &file) const { return Matches(this, file.contents()); }
+
+private:
+    const char *find_horspool(std::string_view haystack, Size pos) const;
+
+    String m_needle;
+    Case m_case = Case::Sensitive;
+    Strategy m_strategy = Strategy::Empty;
+    std::array<UInt32, 256> m_skips = {};
+    RuneString m_folded;
+};
+
+}  // namespace UU
+
+#endif  // UU_SEARCHER_H
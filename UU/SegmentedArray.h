@@ -0,0 +1,357 @@
+//
+// SegmentedArray.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_SEGMENTED_ARRAY_H
+#define UU_SEGMENTED_ARRAY_H
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <UU/Allocator.h>
+#include <UU/Array.h>
+#include <UU/Assertions.h>
+#include <UU/Compiler.h>
+#include <UU/Types.h>
+
+namespace UU {
+
+// SegmentedArray =================================================================================
+
+// Chunks of about 64 KiB, and a power of two elements, so indexing is a shift and a mask.
+template <typename T>
+constexpr Size SegmentedArrayDefaultChunkSize = std::bit_floor(std::max(Size(1), Size(64 * 1024) / sizeof(T)));
+
+// An array that grows a chunk of ChunkSize elements at a time and never moves its elements.
+// push_back() takes constant time with no copying, addresses of elements stay valid until 
+// they are removed, and the array takes no more memory than it needs, give or take a chunk.
+// That makes it a good fit for collecting very large result sets, where doubling an Array
+// means a long copy and twice the memory at the peak.
+//
+// Indexing costs a shift, a mask and a load from the table of chunks. Iterators step
+// through a chunk with a pointer increment, and for_each_segment() hands each chunk's
+// elements over as one contiguous run, for loops as tight as a loop over an Array.
+//
+// Chunks come from AllocatorT, as Array's storage does, and pop_back() gives them back as
+// they empty, keeping one in reserve so that pushes and pops at a chunk boundary don't thrash.
+// Not thread-safe and not exception safe.
+//
+template <typename T, Size ChunkSize = SegmentedArrayDefaultChunkSize<T>, typename AllocatorT = Mallocator>
+    requires IsPowerOfTwo<ChunkSize> && IsLessThanOrEqual<alignof(T), alignof(std::max_align_t)>
+class SegmentedArray
+{
+public:
+    static constexpr Size ChunkShift = std::countr_zero(ChunkSize);
+    static constexpr Size ChunkMask = ChunkSize - 1;
+    static constexpr Size ChunkBytes = ChunkSize * sizeof(T);
+
+    using value_type = T;
+    using size_type = Size;
+    using difference_type = ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using pointer = T *;
+    using const_pointer = const T *;
+
+    template <bool IsConst>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const T *, T *>;
+        using reference = std::conditional_t<IsConst, const T &, T &>;
+        using ArrayT = std::conditional_t<IsConst, const SegmentedArray, SegmentedArray>;
+
+        Iterator() {}
+        Iterator(ArrayT *array, Size index) : m_array(array), m_index(index) { load(); }
+
+        // iterator converts to const_iterator
+        operator Iterator<true>() const { return Iterator<true>(m_array, m_index); }
+
+        reference operator*() const { return *m_ptr; }
+        pointer operator->() const { return m_ptr; }
+        reference operator[](difference_type n) const { return (*m_array)[m_index + n]; }
+
+        Iterator &operator++() {
+            m_index++;
+            m_ptr++;
+            if (UNLIKELY((m_index & ChunkMask) == 0)) {
+                load();
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) { Iterator tmp = *this; ++*this; return tmp; }
+
+        Iterator &operator--() {
+            if (UNLIKELY((m_index & ChunkMask) == 0)) {
+                m_index--;
+                load();
+            }
+            else {
+                m_index--;
+                m_ptr--;
+            }
+            return *this;
+        }
+
+        Iterator operator--(int) { Iterator tmp = *this; --*this; return tmp; }
+
+        Iterator &operator+=(difference_type n) { m_index += n; load(); return *this; }
+        Iterator &operator-=(difference_type n) { m_index -= n; load(); return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(m_array, m_index + n); }
+        Iterator operator-(difference_type n) const { return Iterator(m_array, m_index - n); }
+        friend Iterator operator+(difference_type n, const Iterator &it) { return it + n; }
+        difference_type operator-(const Iterator &other) const { return difference_type(m_index - other.m_index); }
+
+        bool operator==(const Iterator &other) const { return m_index == other.m_index; }
+        std::strong_ordering operator<=>(const Iterator &other) const { return m_index <=> other.m_index; }
+
+        Size index() const { return m_index; }
+
+    private:
+        // Points m_ptr at the element for m_index, or at nothing when its chunk doesn't exist.
+        void load() {
+            Size chunk = m_index >> ChunkShift;
+            m_ptr = chunk < m_array->m_chunks.size() ? m_array->m_chunks[chunk] + (m_index & ChunkMask) : nullptr;
+        }
+
+        ArrayT *m_array = nullptr;
+        Size m_index = 0;
+        pointer m_ptr = nullptr;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    SegmentedArray() {}
+    explicit SegmentedArray(const AllocatorT &allocator) : m_chunks(allocator), m_allocator(allocator) {}
+
+    SegmentedArray(const SegmentedArray &other) : m_chunks(other.m_allocator), m_allocator(other.m_allocator) {
+        append(other);
+    }
+
+    SegmentedArray(SegmentedArray &&other) : m_chunks(other.m_allocator), m_allocator(other.m_allocator) {
+        take_chunks(other);
+    }
+
+    ~SegmentedArray() {
+        clear();
+    }
+
+    SegmentedArray &operator=(const SegmentedArray &other) {
+        if (this != &other) {
+            clear();
+            append(other);
+        }
+        return *this;
+    }
+
+    // Takes over other's chunks if they can go back to this array's allocator, 
+    // and otherwise moves the elements one by one.
+    SegmentedArray &operator=(SegmentedArray &&other) {
+        if (this == &other) {
+            return *this;
+        }
+        clear();
+        if (m_allocator == other.m_allocator) {
+            take_chunks(other);
+        }
+        else {
+            for (T &t : other) {
+                push_back(std::move(t));
+            }
+            other.clear();
+        }
+        return *this;
+    }
+
+    // accessors ==================================================================================
+
+    UU_ALWAYS_INLINE Size size() const { return m_size; }
+    UU_NO_DISCARD bool is_empty() const { return m_size == 0; }
+    UU_NO_DISCARD bool not_empty() const { return !is_empty(); }
+    Size capacity() const { return m_chunks.size() * ChunkSize; }
+    Size chunk_count() const { return m_chunks.size(); }
+    const AllocatorT &allocator() const { return m_allocator; }
+
+    UU_ALWAYS_INLINE T &operator[](Size index) {
+        ASSERT(index < m_size);
+        return m_chunks[index >> ChunkShift][index & ChunkMask];
+    }
+
+    UU_ALWAYS_INLINE const T &operator[](Size index) const {
+        ASSERT(index < m_size);
+        return m_chunks[index >> ChunkShift][index & ChunkMask];
+    }
+
+    T &front() { return (*this)[0]; }
+    const T &front() const { return (*this)[0]; }
+    T &back() { return (*this)[m_size - 1]; }
+    const T &back() const { return (*this)[m_size - 1]; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, m_size); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    // Calls f(T *first, Size count) for each chunk's run of elements, in order.
+    template <typename F>
+    void for_each_segment(F f) {
+        Size remaining = m_size;
+        for (Size idx = 0; remaining > 0; idx++) {
+            Size count = remaining < ChunkSize ? remaining : ChunkSize;
+            f(m_chunks[idx], count);
+            remaining -= count;
+        }
+    }
+
+    template <typename F>
+    void for_each_segment(F f) const {
+        Size remaining = m_size;
+        for (Size idx = 0; remaining > 0; idx++) {
+            Size count = remaining < ChunkSize ? remaining : ChunkSize;
+            f(static_cast<const T *>(m_chunks[idx]), count);
+            remaining -= count;
+        }
+    }
+
+    // modifiers ==================================================================================
+
+    UU_ALWAYS_INLINE void push_back(const T &t) {
+        emplace_back(t);
+    }
+
+    UU_ALWAYS_INLINE void push_back(T &&t) {
+        emplace_back(std::move(t));
+    }
+
+    template <typename... Args>
+    UU_ALWAYS_INLINE T &emplace_back(Args &&...args) {
+        Size offset = m_size & ChunkMask;
+        if (UNLIKELY(offset == 0 && (m_size >> ChunkShift) == m_chunks.size())) {
+            add_chunk();
+        }
+        T *ptr = m_chunks[m_size >> ChunkShift] + offset;
+        ::new ((void *)ptr) T(std::forward<Args>(args)...);
+        m_size++;
+        return *ptr;
+    }
+
+    template <typename Range>
+    void append(const Range &range) {
+        for (const auto &t : range) {
+            push_back(t);
+        }
+    }
+
+    void pop_back() {
+        ASSERT(not_empty());
+        back().~T();
+        m_size--;
+        // keep the emptied chunk as a reserve, and free the one past it
+        if ((m_size & ChunkMask) == 0 && m_chunks.size() > (m_size >> ChunkShift) + 1) {
+            free_chunk();
+        }
+    }
+
+    // Destroys every element and frees every chunk.
+    void clear() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for_each_segment([](T *first, Size count) {
+                for (Size idx = 0; idx < count; idx++) {
+                    first[idx].~T();
+                }
+            });
+        }
+        m_size = 0;
+        while (m_chunks.not_empty()) {
+            free_chunk();
+        }
+    }
+
+    // Frees the chunks past the one that holds the end of the array.
+    void shrink_to_fit() {
+        Size needed = (m_size + ChunkMask) >> ChunkShift;
+        while (m_chunks.size() > needed) {
+            free_chunk();
+        }
+    }
+
+    void swap(SegmentedArray &other) {
+        m_chunks.swap(other.m_chunks);
+        std::swap(m_size, other.m_size);
+        std::swap(m_allocator, other.m_allocator);
+    }
+
+private:
+    UU_NEVER_INLINE void add_chunk() {
+        Memory mem = m_allocator.alloc(ChunkBytes);
+        if (UNLIKELY(mem.is_empty())) {
+            ASSERT_WITH_MESSAGE(false, "Allocation of SegmentedArray chunk failed: %lu", ChunkBytes);
+            CRASH();
+        }
+        m_chunks.push_back(static_cast<T *>(mem.ptr));
+    }
+
+    void free_chunk() {
+        Memory mem(m_chunks.back(), ChunkBytes);
+        m_allocator.dealloc(mem);
+        m_chunks.pop_back();
+    }
+
+    void take_chunks(SegmentedArray &other) {
+        m_chunks = std::move(other.m_chunks);
+        m_size = other.m_size;
+        other.m_chunks.clear();
+        other.m_size = 0;
+    }
+
+    Array<T *, 4, AllocatorT> m_chunks;
+    Size m_size = 0;
+    [[no_unique_address]] AllocatorT m_allocator;
+};
+
+}  // namespace UU
+
+namespace std {
+
+template <typename T, UU::Size ChunkSize, typename AllocatorT>
+inline void swap(UU::SegmentedArray<T, ChunkSize, AllocatorT> &a, UU::SegmentedArray<T, ChunkSize, AllocatorT> &b) {
+    a.swap(b);
+}
+
+}  // namespace std
+
+#endif  // UU_SEGMENTED_ARRAY_H
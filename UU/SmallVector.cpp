@@ -66,37 +66,22 @@ SOFTWARE.
 
 namespace UU {
 
-// grow_pod - This is an implementation of the grow() method which only works
-// on POD-like datatypes and is out of line to reduce code duplication.
-void SmallVectorBase::grow_pod(void *m_first_element, size_t MinSizeInBytes, size_t TSize) 
+// capacity_in_bytes_for_grow - The capacity for the grow() method which only works
+// on POD-like datatypes, out of line to reduce code duplication.
+size_t SmallVectorBase::capacity_in_bytes_for_grow(size_t MinSizeInBytes, size_t TSize) const
 {
-    size_t CurSizeBytes = size_in_bytes();
     size_t NewCapacityInBytes = 2 * capacity_in_bytes() + TSize; // Always grow.
     if (NewCapacityInBytes < MinSizeInBytes) {
         NewCapacityInBytes = MinSizeInBytes;
     }
+    return NewCapacityInBytes;
+}
 
-    void *NewElts;
-    if (BeginX == m_first_element) {
-        NewElts = malloc(NewCapacityInBytes);
-        if (NewElts == nullptr) {
-            ASSERT_WITH_MESSAGE(false, "Allocation of SmallVector element failed.");
-        }
-
-        // Copy the elements over.  No need to run dtors on PODs.
-        memcpy(NewElts, this->BeginX, CurSizeBytes);
-    } 
-    else {
-        // If this wasn't grown from the inline copy, grow the allocated space.
-        NewElts = realloc(this->BeginX, NewCapacityInBytes);
-        if (NewElts == nullptr) {
-            ASSERT_WITH_MESSAGE(false, "Allocation of SmallVector element failed.");
-        }
-    }
-
-    this->EndX = (char*)NewElts + CurSizeBytes;
-    this->BeginX = NewElts;
-    this->CapacityX = (char*)this->BeginX + NewCapacityInBytes;
+void SmallVectorBase::report_allocation_failure(size_t Bytes)
+{
+    UNUSED_PARAM(Bytes);
+    ASSERT_WITH_MESSAGE(false, "Allocation of SmallVector element failed.");
+    CRASH();
 }
 
 } // namespace UU
@@ -78,6 +78,7 @@ SOFTWARE.
 #include <type_traits>
 #include <utility>
 
+#include <UU/Allocator.h>
 #include <UU/Assertions.h>
 #include <UU/Compiler.h>
 #include <UU/MathLike.h>
@@ -122,26 +123,64 @@ protected:
         CapacityX((char *)m_first_element + Size)
     {}
 
-    // An implementation of the grow() method which only works
-    // on POD-like data types and is out of line to reduce code duplication.
-    void grow_pod(void *m_first_element, size_t MinSizeInBytes, size_t TSize);
+    // The capacity in bytes for the grow() method which only works on POD-like data types,
+    // out of line to reduce code duplication.
+    size_t capacity_in_bytes_for_grow(size_t MinSizeInBytes, size_t TSize) const;
+
+    [[noreturn]] static void report_allocation_failure(size_t Bytes);
 };
 
 // The part of SmallVectorTemplateBase which does not depend on whether
-// the type T is trivially copyable. The extra dummy template argument is used
-// to avoid unnecessarily requiring T to be complete.
-template <typename T, typename = void>
+// the type T is trivially copyable. The allocator template argument also 
+// avoids unnecessarily requiring T to be complete.
+template <typename T, typename AllocatorT>
 class SmallVectorTemplateCommon : public SmallVectorBase 
 {
-    template <typename, unsigned> friend struct SmallVectorStorage;
+    template <typename, unsigned, typename> friend struct SmallVectorStorage;
 
 protected:
-    SmallVectorTemplateCommon(size_t Size) : 
-        SmallVectorBase(&m_first_element, Size) 
+    SmallVectorTemplateCommon(size_t Size, const AllocatorT &A) : 
+        SmallVectorBase(&m_first_element, Size),
+        m_allocator(A)
     {}
 
-    void grow_pod(size_t MinSizeInBytes, size_t TSize) {
-        SmallVectorBase::grow_pod(&m_first_element, MinSizeInBytes, TSize);
+    // Allocate Bytes, and crash if the allocator can't provide them.
+    void *allocate(size_t Bytes) {
+        Memory mem = m_allocator.alloc(Bytes);
+        if (UNLIKELY(mem.is_empty())) {
+            SmallVectorBase::report_allocation_failure(Bytes);
+        }
+        return mem.ptr;
+    }
+
+    // Give back the allocated buffer, with the size it was asked for.
+    void deallocate_buffer() {
+        Memory mem(this->BeginX, this->capacity_in_bytes());
+        m_allocator.dealloc(mem);
+    }
+
+    // Grow the allocated buffer to NewCapacityInBytes without moving it, if the allocator can.
+    bool expand_in_place(size_t NewCapacityInBytes) {
+        if (is_small()) {
+            return false;
+        }
+        Memory mem(this->BeginX, this->capacity_in_bytes());
+        if (!m_allocator.expand(mem, NewCapacityInBytes - mem.capacity)) {
+            return false;
+        }
+        this->CapacityX = (char *)this->BeginX + NewCapacityInBytes;
+        return true;
+    }
+
+    // An implementation of the grow() method which only works on POD-like data types.
+    void grow_pod(size_t MinSizeInBytes, size_t TSize);
+
+    bool has_same_allocator(const SmallVectorTemplateCommon &RHS) const {
+        return m_allocator == RHS.m_allocator;
+    }
+
+    void swap_allocator(SmallVectorTemplateCommon &RHS) {
+        std::swap(m_allocator, RHS.m_allocator);
     }
 
     // Return true if this is a smallvector which has not had dynamic memory allocated for it.
@@ -160,6 +199,10 @@ public:
     using size_type = size_t;
     using difference_type = ptrdiff_t;
     using value_type = T;
+    using allocator_type = AllocatorT;
+
+    const AllocatorT &allocator() const { return m_allocator; }
+
     using iterator = T *;
     using const_iterator = const T *;
 
@@ -241,14 +284,46 @@ private:
     // don't want it to be automatically run, so we need to represent the space as
     // something else.  Use an array of char of sufficient alignment.
     using U = AlignedCharArrayUnion<T>;
+    [[no_unique_address]] AllocatorT m_allocator;
     U m_first_element;
     // Space after 'm_first_element' is clobbered, do not add any instance vars after it.
 };
 
+// Define this out-of-line to dissuade the C++ compiler from inlining it.
+template <typename T, typename AllocatorT>
+UU_NEVER_INLINE void SmallVectorTemplateCommon<T, AllocatorT>::grow_pod(size_t MinSizeInBytes, size_t TSize) 
+{
+    size_t CurSizeBytes = this->size_in_bytes();
+    size_t NewCapacityInBytes = this->capacity_in_bytes_for_grow(MinSizeInBytes, TSize);
+
+    if (!is_small()) {
+        // Grow in place if the allocator can, and otherwise let it move the buffer. 
+        // For Mallocator, that's realloc.
+        Memory mem(this->BeginX, this->capacity_in_bytes());
+        if (m_allocator.expand(mem, NewCapacityInBytes - mem.capacity) || m_allocator.reallocate(mem, NewCapacityInBytes)) {
+            this->BeginX = mem.ptr;
+            this->EndX = (char *)mem.ptr + CurSizeBytes;
+            this->CapacityX = (char *)mem.ptr + NewCapacityInBytes;
+            return;
+        }
+    }
+
+    // Copy the elements over.  No need to run dtors on PODs.
+    void *NewElts = allocate(NewCapacityInBytes);
+    memcpy(NewElts, this->BeginX, CurSizeBytes);
+    if (!is_small()) {
+        deallocate_buffer();
+    }
+
+    this->EndX = (char *)NewElts + CurSizeBytes;
+    this->BeginX = NewElts;
+    this->CapacityX = (char *)this->BeginX + NewCapacityInBytes;
+}
+
 // SmallVectorTemplateBase<isTriviallyCopyable = false>
 // Works with non-trivially-copyable T's.
-template <typename T, bool isTriviallyCopyable>
-class SmallVectorTemplateBase : public SmallVectorTemplateCommon<T> 
+template <typename T, typename AllocatorT, bool isTriviallyCopyable>
+class SmallVectorTemplateBase : public SmallVectorTemplateCommon<T, AllocatorT> 
 {
 public:
     void push_back(const T &Elt) {
@@ -273,7 +348,7 @@ public:
     }
 
 protected:
-    SmallVectorTemplateBase(size_t Size) : SmallVectorTemplateCommon<T>(Size) {}
+    SmallVectorTemplateBase(size_t Size, const AllocatorT &A) : SmallVectorTemplateCommon<T, AllocatorT>(Size, A) {}
 
     static void destroy_range(T *S, T *E) {
         while (S != E) {
@@ -304,8 +379,8 @@ protected:
 };
 
 // Define this out-of-line to dissuade the C++ compiler from inlining it.
-template <typename T, bool isTriviallyCopyable>
-void SmallVectorTemplateBase<T, isTriviallyCopyable>::grow(size_t MinSize)
+template <typename T, typename AllocatorT, bool isTriviallyCopyable>
+void SmallVectorTemplateBase<T, AllocatorT, isTriviallyCopyable>::grow(size_t MinSize)
 {
     size_t CurCapacity = this->capacity();
     size_t CurSize = this->size();
@@ -315,11 +390,12 @@ void SmallVectorTemplateBase<T, isTriviallyCopyable>::grow(size_t MinSize)
     if (NewCapacity < MinSize) {
         NewCapacity = MinSize;
     }
-    T *NewElts = static_cast<T *>(malloc(NewCapacity * sizeof(T)));
-    if (NewElts == nullptr) {
-        ASSERT_WITH_MESSAGE(false, "Allocation of SmallVector element failed.");
-        CRASH();
+
+    // Growing in place needs no moves at all.
+    if (this->expand_in_place(NewCapacity * sizeof(T))) {
+        return;
     }
+    T *NewElts = static_cast<T *>(this->allocate(NewCapacity * sizeof(T)));
 
     // Move the elements over.
     this->uninitialized_move(this->begin(), this->end(), NewElts);
@@ -329,7 +405,7 @@ void SmallVectorTemplateBase<T, isTriviallyCopyable>::grow(size_t MinSize)
 
     // If this wasn't grown from the inline copy, deallocate the old space.
     if (!this->is_small()) {
-        free(this->begin());
+        this->deallocate_buffer();
     }
 
     this->setEnd(NewElts+CurSize);
@@ -340,10 +416,10 @@ void SmallVectorTemplateBase<T, isTriviallyCopyable>::grow(size_t MinSize)
 
 // SmallVectorTemplateBase<isTriviallyCopyable = true> - 
 // Works with trivially-copyable T's.
-template <typename T>
-class SmallVectorTemplateBase<T, true> : public SmallVectorTemplateCommon<T> {
+template <typename T, typename AllocatorT>
+class SmallVectorTemplateBase<T, AllocatorT, true> : public SmallVectorTemplateCommon<T, AllocatorT> {
 protected:
-    SmallVectorTemplateBase(size_t Size) : SmallVectorTemplateCommon<T>(Size) {}
+    SmallVectorTemplateBase(size_t Size, const AllocatorT &A) : SmallVectorTemplateCommon<T, AllocatorT>(Size, A) {}
 
     // No need to do a destroy loop for trivially-copyable T's.
     static void destroy_range(T *, T *) {}
@@ -400,10 +476,10 @@ public:
 
 // This class consists of common code factored out of the SmallVector class to
 // reduce code duplication based on the SmallVector 'N' template parameter.
-template <typename T>
-class SmallVectorImpl : public SmallVectorTemplateBase<T, std::is_trivially_copyable_v<T>> 
+template <typename T, typename AllocatorT = Mallocator>
+class SmallVectorImpl : public SmallVectorTemplateBase<T, AllocatorT, std::is_trivially_copyable_v<T>> 
 {
-    using SuperClass = SmallVectorTemplateBase<T, std::is_trivially_copyable_v<T>>;
+    using SuperClass = SmallVectorTemplateBase<T, AllocatorT, std::is_trivially_copyable_v<T>>;
 
 public:
     using iterator = typename SuperClass::iterator;
@@ -412,8 +488,8 @@ public:
 
 protected:
     // Default ctor - Initialize to empty.
-    explicit SmallVectorImpl(unsigned N) : 
-        SmallVectorTemplateBase<T, std::is_trivially_copyable_v<T>>(N * sizeof(T)) {
+    explicit SmallVectorImpl(unsigned N, const AllocatorT &A = AllocatorT()) : 
+        SuperClass(N * sizeof(T), A) {
     }
 
 public:
@@ -425,7 +501,7 @@ public:
 
         // If this wasn't grown from the inline copy, deallocate the old space.
         if (!this->is_small()) {
-            free(this->begin());
+            this->deallocate_buffer();
         }
     }
 
@@ -841,8 +917,8 @@ public:
     }
 };
 
-template <typename T>
-void SmallVectorImpl<T>::swap(SmallVectorImpl<T> &RHS) 
+template <typename T, typename AllocatorT>
+void SmallVectorImpl<T, AllocatorT>::swap(SmallVectorImpl<T, AllocatorT> &RHS) 
 {
     if (this == &RHS) {
         return;
@@ -853,6 +929,9 @@ void SmallVectorImpl<T>::swap(SmallVectorImpl<T> &RHS)
         std::swap(this->BeginX, RHS.BeginX);
         std::swap(this->EndX, RHS.EndX);
         std::swap(this->CapacityX, RHS.CapacityX);
+
+        // buffers move with the allocators that own them
+        this->swap_allocator(RHS);
         return;
     }
     
@@ -887,8 +966,8 @@ void SmallVectorImpl<T>::swap(SmallVectorImpl<T> &RHS)
     }
 }
 
-template <typename T>
-SmallVectorImpl<T> &SmallVectorImpl<T>::operator=(const SmallVectorImpl<T> &RHS) 
+template <typename T, typename AllocatorT>
+SmallVectorImpl<T, AllocatorT> &SmallVectorImpl<T, AllocatorT>::operator=(const SmallVectorImpl<T, AllocatorT> &RHS) 
 {
     // Avoid self-assignment.
     if (this == &RHS) {
@@ -939,18 +1018,19 @@ SmallVectorImpl<T> &SmallVectorImpl<T>::operator=(const SmallVectorImpl<T> &RHS)
     return *this;
 }
 
-template <typename T>
-SmallVectorImpl<T> &SmallVectorImpl<T>::operator=(SmallVectorImpl<T> &&RHS) 
+template <typename T, typename AllocatorT>
+SmallVectorImpl<T, AllocatorT> &SmallVectorImpl<T, AllocatorT>::operator=(SmallVectorImpl<T, AllocatorT> &&RHS) 
 {
     // Avoid self-assignment.
     if (this == &RHS) {
         return *this;
     }
 
-    // If the RHS isn't small, clear this vector and then steal its buffer.
-    if (!RHS.is_small()) {
+    // If the RHS isn't small, clear this vector and then steal its buffer, 
+    // as long as it can go back to this vector's allocator.
+    if (!RHS.is_small() && this->has_same_allocator(RHS)) {
         this->destroy_range(this->begin(), this->end());
-        if (!this->is_small()) free(this->begin());
+        if (!this->is_small()) this->deallocate_buffer();
         this->BeginX = RHS.BeginX;
         this->EndX = RHS.EndX;
         this->CapacityX = RHS.CapacityX;
@@ -1008,12 +1088,12 @@ SmallVectorImpl<T> &SmallVectorImpl<T>::operator=(SmallVectorImpl<T> &&RHS)
 // SmallVectorTemplateCommon. There are 'N-1' elements here. The remaining '1'
 // element is in the base class. This is specialized for the N=1 and N=0 cases
 // to avoid allocating unnecessary storage.
-template <typename T, unsigned N>
+template <typename T, unsigned N, typename AllocatorT>
 struct SmallVectorStorage {
-    typename SmallVectorTemplateCommon<T>::U InlineElts[N - 1];
+    typename SmallVectorTemplateCommon<T, AllocatorT>::U InlineElts[N - 1];
 };
-template <typename T> struct SmallVectorStorage<T, 1> {};
-template <typename T> struct SmallVectorStorage<T, 0> {};
+template <typename T, typename AllocatorT> struct SmallVectorStorage<T, 1, AllocatorT> {};
+template <typename T, typename AllocatorT> struct SmallVectorStorage<T, 0, AllocatorT> {};
 
 // This is a 'vector' (a variable-sized array), optimized
 // for the case when the array is small.  It contains some number of elements
@@ -1021,23 +1101,31 @@ template <typename T> struct SmallVectorStorage<T, 0> {};
 // elements is below that threshold.  This allows normal "small" cases to be
 // fast without losing generality for large inputs.
 //
+// Storage beyond the inline elements comes from AllocatorT, a handle with alloc, dealloc,
+// expand and reallocate. The default, Mallocator, takes no space and uses malloc and realloc.
+// Copies and moves carry the handle along, as they do for Array.
+//
 // Note that this does not attempt to be exception safe.
 //
-template <typename T, unsigned N>
-class SmallVector : public SmallVectorImpl<T> 
+template <typename T, unsigned N, typename AllocatorT = Mallocator>
+class SmallVector : public SmallVectorImpl<T, AllocatorT> 
 {
+    using Impl = SmallVectorImpl<T, AllocatorT>;
+
 public:
-    SmallVector() : SmallVectorImpl<T>(N) {}
+    SmallVector() : Impl(N) {}
+
+    explicit SmallVector(const AllocatorT &A) : Impl(N, A) {}
 
-    explicit SmallVector(size_t Size, const T &Value = T()) : 
-        SmallVectorImpl<T>(N) 
+    explicit SmallVector(size_t Size, const T &Value = T(), const AllocatorT &A = AllocatorT()) : 
+        Impl(N, A) 
     {
         this->assign(Size, Value);
     }
 
     template <typename ItTy, typename = 
         typename std::enable_if_t<std::is_convertible_v<typename std::iterator_traits<ItTy>::iterator_category, std::input_iterator_tag>>>
-    SmallVector(ItTy S, ItTy E) : SmallVectorImpl<T>(N) {
+    SmallVector(ItTy S, ItTy E) : Impl(N) {
         this->append(S, E);
     }
 
@@ -1047,40 +1135,40 @@ public:
     //     this->append(R.begin(), R.end());
     //   }
 
-    SmallVector(std::initializer_list<T> IL) : SmallVectorImpl<T>(N) {
+    SmallVector(std::initializer_list<T> IL, const AllocatorT &A = AllocatorT()) : Impl(N, A) {
         this->assign(IL);
     }
 
-    SmallVector(const SmallVector &RHS) : SmallVectorImpl<T>(N) {
+    SmallVector(const SmallVector &RHS) : Impl(N, RHS.allocator()) {
         if (!RHS.empty()) {
-            SmallVectorImpl<T>::operator=(RHS);
+            Impl::operator=(RHS);
         }
     }
 
     const SmallVector &operator=(const SmallVector &RHS) {
-        SmallVectorImpl<T>::operator=(RHS);
+        Impl::operator=(RHS);
         return *this;
     }
 
-    SmallVector(SmallVector &&RHS) : SmallVectorImpl<T>(N) {
+    SmallVector(SmallVector &&RHS) : Impl(N, RHS.allocator()) {
         if (!RHS.empty()) {
-            SmallVectorImpl<T>::operator=(::std::move(RHS));
+            Impl::operator=(::std::move(RHS));
         }
     }
 
-    SmallVector(SmallVectorImpl<T> &&RHS) : SmallVectorImpl<T>(N) {
+    SmallVector(Impl &&RHS) : Impl(N, RHS.allocator()) {
         if (!RHS.empty()) {
-            SmallVectorImpl<T>::operator=(::std::move(RHS));
+            Impl::operator=(::std::move(RHS));
         }
     }
 
     const SmallVector &operator=(SmallVector &&RHS) {
-        SmallVectorImpl<T>::operator=(::std::move(RHS));
+        Impl::operator=(::std::move(RHS));
         return *this;
     }
 
-    const SmallVector &operator=(SmallVectorImpl<T> &&RHS) {
-        SmallVectorImpl<T>::operator=(::std::move(RHS));
+    const SmallVector &operator=(Impl &&RHS) {
+        Impl::operator=(::std::move(RHS));
         return *this;
     }
 
@@ -1091,16 +1179,16 @@ public:
 
 private:
     // Inline space for elements which aren't stored in the base class.
-    SmallVectorStorage<T, N> Storage;
+    SmallVectorStorage<T, N, AllocatorT> Storage;
 };
 
-template <typename T, unsigned N>
-inline size_t capacity_in_bytes(const SmallVector<T, N> &X) {
+template <typename T, unsigned N, typename AllocatorT>
+inline size_t capacity_in_bytes(const SmallVector<T, N, AllocatorT> &X) {
     return X.capacity_in_bytes();
 }
 
-template <typename T, unsigned N>
-std::ostream &operator<<(std::ostream &os, const SmallVector<T, N> &v)
+template <typename T, unsigned N, typename AllocatorT>
+std::ostream &operator<<(std::ostream &os, const SmallVector<T, N, AllocatorT> &v)
 {
     for (int i = 0; i < v.size(); i++) {
         os << v[i];
@@ -1117,14 +1205,14 @@ std::ostream &operator<<(std::ostream &os, const SmallVector<T, N> &v)
 namespace std {
 
 // Implement std::swap in terms of SmallVector swap.
-template<typename T>
-inline void swap(UU::SmallVectorImpl<T> &LHS, UU::SmallVectorImpl<T> &RHS) {
+template<typename T, typename AllocatorT>
+inline void swap(UU::SmallVectorImpl<T, AllocatorT> &LHS, UU::SmallVectorImpl<T, AllocatorT> &RHS) {
     LHS.swap(RHS);
 }
 
 // Implement std::swap in terms of SmallVector swap.
-template<typename T, unsigned N>
-inline void swap(UU::SmallVector<T, N> &LHS, UU::SmallVector<T, N> &RHS) {
+template<typename T, unsigned N, typename AllocatorT>
+inline void swap(UU::SmallVector<T, N, AllocatorT> &LHS, UU::SmallVector<T, N, AllocatorT> &RHS) {
     LHS.swap(RHS);
 }
 
@@ -46,22 +46,63 @@ bool is_valid_utf8(const std::string &s)
     return true;
 }
 
-std::vector<Size> find_line_end_offsets(const std::string_view &str, Size max_string_index, Size max_line)
+static Size byte_set_result(const std::string_view &str, const char *match)
+{
+    return match ? Size(match - str.data()) : std::string_view::npos;
+}
+
+Size find_first_of(const std::string_view &str, const ByteSet &set, Size pos)
+{
+    if (pos >= str.length()) {
+        return std::string_view::npos;
+    }
+    return byte_set_result(str, find_first_in(str.data() + pos, str.data() + str.length(), set));
+}
+
+Size find_first_not_of(const std::string_view &str, const ByteSet &set, Size pos)
+{
+    if (pos >= str.length()) {
+        return std::string_view::npos;
+    }
+    return byte_set_result(str, find_first_not_in(str.data() + pos, str.data() + str.length(), set));
+}
+
+Size find_last_of(const std::string_view &str, const ByteSet &set, Size pos)
+{
+    if (str.length() == 0) {
+        return std::string_view::npos;
+    }
+    Size end = std::min(pos, str.length() - 1) + 1;
+    return byte_set_result(str, find_last_in(str.data(), str.data() + end, set));
+}
+
+Size find_last_not_of(const std::string_view &str, const ByteSet &set, Size pos)
+{
+    if (str.length() == 0) {
+        return std::string_view::npos;
+    }
+    Size end = std::min(pos, str.length() - 1) + 1;
+    return byte_set_result(str, find_last_not_in(str.data(), str.data() + end, set));
+}
+
+static constexpr ByteSet LineEndBytes("\r\n");
+
+template <typename Offsets>
+static void find_line_end_offsets_into(Offsets &result, const std::string_view &str, Size max_string_index, Size max_line)
 {
     max_string_index = std::min(max_string_index, str.length()); 
-    std::vector<Size> result;
-    result.reserve(str.length() / 16); // estimate
+    result.reserve(max_string_index / 16); // estimate
     bool added_last_line_ending = false;
 
     // find all line endings in str up to and including the line with the last match
     Size pos = 0;
     for (;;) {
-        pos = str.find_first_of("\r\n", pos);
+        pos = find_first_of(str, LineEndBytes, pos);
         if (pos == std::string_view::npos) {
             break;
         }
         result.push_back(pos);
-        if (result.size() > max_line) {
+        if (result.size() > max_line || pos >= max_string_index) {
             added_last_line_ending = true;
             break;
         }
@@ -78,7 +119,7 @@ std::vector<Size> find_line_end_offsets(const std::string_view &str, Size max_st
     }
     // add the line end after the last match, or if there is none, the last index in the file
     if (!added_last_line_ending) {
-        pos = str.find_first_of("\r\n", pos);
+        pos = find_first_of(str, LineEndBytes, pos);
         if (pos != std::string_view::npos) {
             result.push_back(pos);
             added_last_line_ending = true;
@@ -87,11 +128,49 @@ std::vector<Size> find_line_end_offsets(const std::string_view &str, Size max_st
     if (!added_last_line_ending) {
         result.push_back(str.length()); // one after the end
     }
+}
 
+std::vector<Size> find_line_end_offsets(const std::string_view &str, Size max_string_index, Size max_line)
+{
+    std::vector<Size> result;
+    find_line_end_offsets_into(result, str, max_string_index, max_line);
     return result;
 }
 
-std::pair<Size, Size> offsets_for_line(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line)
+std::pmr::vector<Size> find_line_end_offsets(const std::string_view &str, Size max_string_index, Size max_line, 
+    std::pmr::memory_resource *resource)
+{
+    std::pmr::vector<Size> result(resource);
+    find_line_end_offsets_into(result, str, max_string_index, max_line);
+    return result;
+}
+
+template <typename Offsets>
+static Size line_start_offset_in(const std::string_view &str, const Offsets &line_end_offsets, Size line)
+{
+    if (line <= 1) {
+        return 0;
+    }
+    Size prev = line_end_offsets[line - 2];
+    Size pos = prev + 1;
+    if (str[prev] == '\r' && pos < str.length() && str[pos] == '\n') {
+        pos++;
+    }
+    return pos;
+}
+
+Size line_start_offset(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line)
+{
+    return line_start_offset_in(str, line_end_offsets, line);
+}
+
+Size line_start_offset(const std::string_view &str, const std::pmr::vector<Size> &line_end_offsets, Size line)
+{
+    return line_start_offset_in(str, line_end_offsets, line);
+}
+
+template <typename Offsets>
+static std::pair<Size, Size> offsets_for_line_in(const std::string_view &str, const Offsets &line_end_offsets, Size line)
 {
     std::pair<Size, Size> result = std::make_pair(std::string_view::npos, std::string_view::npos);
     if (line == 0 || line > line_end_offsets.size()) {
@@ -100,7 +179,7 @@ std::pair<Size, Size> offsets_for_line(const std::string_view &str, const std::v
     Size line_start_offset = 0;
     if (line > 1) {
         line_start_offset = line_end_offsets[line - 2];
-        line_start_offset = str.find_first_not_of("\r\n", line_start_offset);
+        line_start_offset = find_first_not_of(str, LineEndBytes, line_start_offset);
         if (line_start_offset == std::string_view::npos) {
             line_start_offset = str.length();
         }
@@ -110,10 +189,21 @@ std::pair<Size, Size> offsets_for_line(const std::string_view &str, const std::v
     return std::make_pair(line_start_offset, line_end_offset);
 }
 
-std::string_view string_view_for_line(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line)
+std::pair<Size, Size> offsets_for_line(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line)
+{
+    return offsets_for_line_in(str, line_end_offsets, line);
+}
+
+std::pair<Size, Size> offsets_for_line(const std::string_view &str, const std::pmr::vector<Size> &line_end_offsets, Size line)
+{
+    return offsets_for_line_in(str, line_end_offsets, line);
+}
+
+template <typename Offsets>
+static std::string_view string_view_for_line_in(const std::string_view &str, const Offsets &line_end_offsets, Size line)
 {
     std::string_view result;
-    auto offsets = offsets_for_line(str, line_end_offsets, line);
+    auto offsets = offsets_for_line_in(str, line_end_offsets, line);
     if (offsets.first != std::string_view::npos) {
         Size length = std::min(offsets.second, str.length()) - offsets.first;
         result = str.substr(offsets.first, length);
@@ -121,6 +211,16 @@ std::string_view string_view_for_line(const std::string_view &str, const std::ve
     return result;
 }
 
+std::string_view string_view_for_line(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line)
+{
+    return string_view_for_line_in(str, line_end_offsets, line);
+}
+
+std::string_view string_view_for_line(const std::string_view &str, const std::pmr::vector<Size> &line_end_offsets, Size line)
+{
+    return string_view_for_line_in(str, line_end_offsets, line);
+}
+
 std::string_view string_view_for_line(const std::string_view &str, Size line)
 {
     std::vector<Size> line_end_offsets = find_line_end_offsets(str);
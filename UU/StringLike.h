@@ -28,10 +28,13 @@
 #include <codecvt>
 #include <limits>
 #include <locale>
+#include <memory_resource>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <UU/Assertions.h>
+#include <UU/ByteSearch.h>
 #include <UU/Compiler.h>
 #include <UU/MathLike.h>
 #include <UU/Types.h>
@@ -65,6 +68,12 @@ UU_ALWAYS_INLINE RuneString to_rune_string(const std::string_view &str) {
 
 bool is_valid_utf8(const std::string &s);
 
+// std::string_view's find_first_of() and the others, with the set compiled once into a ByteSet.
+Size find_first_of(const std::string_view &str, const ByteSet &set, Size pos = 0);
+Size find_first_not_of(const std::string_view &str, const ByteSet &set, Size pos = 0);
+Size find_last_of(const std::string_view &str, const ByteSet &set, Size pos = std::string_view::npos);
+Size find_last_not_of(const std::string_view &str, const ByteSet &set, Size pos = std::string_view::npos);
+
 template <typename U> std::pair<U, bool> parse_uint(const std::string &s, std::size_t *pos = nullptr, int base = 10) {
     try {
         U val = U(std::stoll(s, pos, base));
@@ -91,11 +100,24 @@ template <typename I> std::pair<int, bool> parse_int(const std::string &s, std::
     }
 }
 
+// The offsets of the line endings in str, and str.length() if the last line has none. The
+// scan stops at the end of the line holding max_string_index, or after max_line + 1 endings.
 std::vector<Size> find_line_end_offsets(const std::string_view &str, Size max_string_index = SizeMax, Size max_line = SizeMax);
 std::pair<Size, Size> offsets_for_line(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line);
 std::string_view string_view_for_line(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line);
+
+// The offset where line, counting from 1, starts: just past the ending of the line before,
+// with CRLF taken as one ending. Unlike offsets_for_line(), it doesn't skip empty lines.
+Size line_start_offset(const std::string_view &str, const std::vector<Size> &line_end_offsets, Size line);
 std::string_view string_view_for_line(const std::string_view &str, Size line);
 
+// The same, with the offsets allocated from resource.
+std::pmr::vector<Size> find_line_end_offsets(const std::string_view &str, Size max_string_index, Size max_line, 
+    std::pmr::memory_resource *resource);
+std::pair<Size, Size> offsets_for_line(const std::string_view &str, const std::pmr::vector<Size> &line_end_offsets, Size line);
+Size line_start_offset(const std::string_view &str, const std::pmr::vector<Size> &line_end_offsets, Size line);
+std::string_view string_view_for_line(const std::string_view &str, const std::pmr::vector<Size> &line_end_offsets, Size line);
+
 template <bool B = true> bool is_gremlin(char c) { return (c < 32) == B; }
 template <bool B = true> bool contains_gremlins(const std::string_view &str) { 
     bool b = false;
@@ -0,0 +1,213 @@
+//
+// ThreadPool.cpp
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <deque>
+#include <exception>
+
+#include "Assertions.h"
+#include "ThreadPool.h"
+#include "UnixLike.h"
+
+namespace UU {
+
+struct alignas(64) ThreadPool::Worker
+{
+    std::mutex mutex;
+    std::deque<Task> tasks;
+};
+
+// The pool and worker index of the calling thread, if it is a pool worker.
+static thread_local ThreadPool *t_pool = nullptr;
+static thread_local Size t_index = 0;
+
+ThreadPool::ThreadPool(Size thread_count)
+{
+    if (thread_count == 0) {
+        thread_count = get_good_concurrency_count();
+    }
+    m_workers.reserve(thread_count);
+    for (Size idx = 0; idx < thread_count; idx++) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    m_threads.reserve(thread_count);
+    for (Size idx = 0; idx < thread_count; idx++) {
+        m_threads.emplace_back(&ThreadPool::work, this, idx);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::push(Task &&task)
+{
+    Size index = t_pool == this ? t_index : m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(std::move(task));
+    }
+    m_pending.fetch_add(1, std::memory_order_release);
+    {
+        // taking the lock orders this wakeup after any waiter has checked m_pending
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_cv.notify_one();
+}
+
+bool ThreadPool::pop(Size index, Task &task)
+{
+    if (m_pending.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    // own deque first, newest task first
+    Size count = m_workers.size();
+    if (index < count) {
+        Worker &worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // steal the oldest task from another worker
+    for (Size offset = 1; offset <= count; offset++) {
+        Worker &victim = *m_workers[(index + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::run_pending_task()
+{
+    Task task;
+    Size index = t_pool == this ? t_index : m_workers.size();
+    if (!pop(index, task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::work(Size index)
+{
+    t_pool = this;
+    t_index = index;
+    Task task;
+    for (;;) {
+        if (pop(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_stop || m_pending.load(std::memory_order_acquire) > 0; });
+        if (m_stop && m_pending.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+    }
+    t_pool = nullptr;
+}
+
+void ThreadPool::parallel_for(Size first, Size last, const std::function<void(Size)> &fn, Size grain)
+{
+    if (first >= last) {
+        return;
+    }
+    grain = std::max(grain, Size(1));
+    Size chunks = (last - first + grain - 1) / grain;
+
+    std::atomic<Size> remaining = chunks;
+    std::mutex mutex;
+    std::exception_ptr exception;
+
+    for (Size chunk = 0; chunk < chunks; chunk++) {
+        Size lo = first + (chunk * grain);
+        Size hi = std::min(lo + grain, last);
+        push([&, lo, hi] {
+            try {
+                for (Size idx = lo; idx < hi; idx++) {
+                    fn(idx);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+            // decrement under the lock so the caller cannot return while this task still
+            // touches the stack-allocated state
+            std::lock_guard<std::mutex> lock(mutex);
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                // the caller waits on the pool's condition variable, under the pool's lock
+                std::lock_guard<std::mutex> pool_lock(m_mutex);
+                m_cv.notify_all();
+            }
+        });
+    }
+
+    // help out until every chunk has finished. when there is nothing to steal, sleep until
+    // either the last chunk finishes or another task is pushed, since a nested parallel_for
+    // on a busy pool may leave queued chunks that only this thread is free to run.
+    for (;;) {
+        if (remaining.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+        if (run_pending_task()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this, &remaining] { 
+            return remaining.load(std::memory_order_acquire) == 0 || m_pending.load(std::memory_order_acquire) > 0; 
+        });
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+}  // namespace UU
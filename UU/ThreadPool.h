@@ -0,0 +1,101 @@
+//
+// ThreadPool.h
+//
+// MIT License
+// Copyright (c) 2023 Ken Kocienda. All rights reserved.
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef UU_THREAD_POOL_H
+#define UU_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <UU/Types.h>
+
+namespace UU {
+
+// ThreadPool runs tasks on a fixed set of worker threads, each with its own task deque.
+//
+// A worker pushes and pops tasks at the back of its own deque, so nested work stays hot
+// in cache, and when its deque runs dry, it steals from the front of the other workers'
+// deques. Tasks submitted from outside the pool are spread round-robin across workers.
+//
+// parallel_for blocks until its range is done, and the calling thread helps run tasks
+// while it waits, so it is safe to call parallel_for from inside a task.
+//
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // Zero, the default, means get_good_concurrency_count().
+    explicit ThreadPool(Size thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    Size thread_count() const { return m_threads.size(); }
+
+    template <typename F, typename... Args>
+    auto submit(F &&f, Args &&...args) -> std::future<std::invoke_result_t<F, Args...>> {
+        using R = std::invoke_result_t<F, Args...>;
+        auto task = std::make_shared<std::packaged_task<R()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        std::future<R> future = task->get_future();
+        push([task] { (*task)(); });
+        return future;
+    }
+
+    // Calls fn(idx) for every idx in [first, last), in chunks of grain indexes per task.
+    // The first exception thrown by fn, if any, is rethrown once the whole range is done.
+    void parallel_for(Size first, Size last, const std::function<void(Size)> &fn, Size grain = 1);
+
+    // Runs one pending task on the calling thread, if there is one.
+    bool run_pending_task();
+
+private:
+    struct Worker;
+
+    void push(Task &&task);
+    bool pop(Size index, Task &task);
+    void work(Size index);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<Size> m_pending = 0;
+    std::atomic<Size> m_next = 0;
+    bool m_stop = false;
+};
+
+}  // namespace UU
+
+#endif  // UU_THREAD_POOL_H
@@ -122,6 +122,7 @@ template <Size A, Size B, Size C = 0> concept IsLessThan = (A + C < B);
 template <Size A, Size B, Size C = 0> concept IsLessThanOrEqual = (A + C <= B);
 template <Size S> concept IsMultipleOfChar32Size = (S % sizeof(Char32) == 0);
 template <Size S> concept IsMutipleOf64 = (S % 64 == 0);
+template <Size S> concept IsPowerOfTwo = (S > 0) && ((S & (S - 1)) == 0);
 
 template <typename T>
 struct HasIteratorCategory
@@ -144,6 +145,15 @@ struct IsInputIteratorCategory_ :
 
 template <typename T> constexpr bool IsInputIteratorCategory = IsInputIteratorCategory_<T>::value;
 
+// Types whose objects can be moved to a new address by copying their bytes, with nothing left
+// to destroy at the old address. Containers grow and erase these with memcpy and realloc.
+// Trivially copyable types qualify. Others opt in by specializing IsTriviallyRelocatable_,
+// which is only correct if the type holds no pointers into itself.
+template <typename T>
+struct IsTriviallyRelocatable_ : std::is_trivially_copyable<T> {};
+
+template <typename T> constexpr bool IsTriviallyRelocatable = IsTriviallyRelocatable_<T>::value;
+
 }  // namespace UU
 
 #endif  // UU_TYPES_H
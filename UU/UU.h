@@ -38,14 +38,23 @@ static constexpr int UU_FIXES_VERSION = 0;
 #include <UU/Array.h>
 #include <UU/Bits.h>
 #include <UU/BitBlock.h>
+#include <UU/ByteSearch.h>
+#include <UU/CaseFold.h>
 #include <UU/CloseGuard.h>
 #include <UU/Compiler.h>
+#include <UU/ConcurrentAppendVector.h>
 #include <UU/Context.h>
 #include <UU/FileLike.h>
 #include <UU/IteratorWrapper.h>
 #include <UU/MappedFile.h>
 #include <UU/MathLike.h>
+#include <UU/MultiSearcher.h>
+#include <UU/ObjectPool.h>
+#include <UU/PageMap.h>
 #include <UU/Platform.h>
+#include <UU/Search.h>
+#include <UU/Searcher.h>
+#include <UU/SegmentedArray.h>
 #include <UU/SmallVector.h>
 #include <UU/Spread.h>
 #include <UU/Spread.h>
@@ -55,6 +64,7 @@ static constexpr int UU_FIXES_VERSION = 0;
 #include <UU/Stretch.h>
 #include <UU/StringLike.h>
 #include <UU/TextRef.h>
+#include <UU/ThreadPool.h>
 #include <UU/TimeCheck.h>
 #include <UU/Types.h>
 #include <UU/UTF8.h>
@@ -44,6 +44,7 @@
 
 #include <UU/Assertions.h>
 #include <UU/Allocator.h>
+#include <UU/ByteSearch.h>
 #include <UU/Compiler.h>
 #include <UU/Context.h>
 #include <UU/IteratorWrapper.h>
@@ -87,8 +88,13 @@ constexpr bool IsStringViewLike = IsConvertibleToStringView<T, CharT, TraitsT> &
 // BasicString class
 //
 
+// The allocator is a handle with alloc and dealloc. Each string allocates and frees all its 
+// buffers through its own handle. The default, ContextAllocatorRef, takes no space and goes 
+// to the calling thread's Context. Use AllocatorRef<Alloc> to tie a string to a particular 
+// allocator, like an ArenaAllocator.
+//
 template <typename CharT, Size SizeT = BasicStringDefaultInlineCapacity, 
-    typename TraitsT = std::char_traits<CharT>>
+    typename TraitsT = std::char_traits<CharT>, typename AllocatorT = ContextAllocatorRef>
 class BasicString
 {
 public:
@@ -96,6 +102,7 @@ public:
 
     using CharType = CharT;
     using TraitsType = TraitsT;
+    using AllocatorType = AllocatorT;
     using iterator = IteratorWrapper<CharT *>;
     using const_iterator = IteratorWrapper<const CharT *>;
     using const_reverse_iterator = std::reverse_iterator<const_iterator>;
@@ -111,7 +118,7 @@ public:
     // public guts inspection =====================================================================
 
     template <bool B = true> constexpr bool is_using_inline_buffer() const { 
-        return (data() == const_cast<CharT *>(m_buf)) == B; 
+        return (m_ptr == nullptr) == B; 
     }
 
     template <bool B = true> constexpr bool is_using_allocated_buffer() const { 
@@ -183,8 +190,33 @@ private:
         return iterator(const_cast<CharT *>(it.base())); 
     }
 
+    // Byte strings compared with plain equality can use the SIMD kernels in ByteSearch.h,
+    // except in constant evaluation.
+    static constexpr bool UsesByteSearch = IsByteSized<CharT> && std::is_same_v<TraitsT, std::char_traits<CharT>>;
+
+    UU_ALWAYS_INLINE const char *byte_data() const { 
+        return reinterpret_cast<const char *>(data()); 
+    }
+
+    UU_ALWAYS_INLINE Size byte_search_result(const char *match) const { 
+        return match ? Size(match - byte_data()) : npos; 
+    }
+
+    template <typename StringViewLikeT>
+    static UU_ALWAYS_INLINE ByteSet byte_set(const StringViewLikeT &t) {
+        return ByteSet(std::string_view(reinterpret_cast<const char *>(t.data()), t.length()));
+    }
+
+    static constexpr CharT lower_ascii(CharT c) { 
+        return c >= CharT('A') && c <= CharT('Z') ? CharT(c + ('a' - 'A')) : c; 
+    }
+
+    static constexpr CharT upper_ascii(CharT c) { 
+        return c >= CharT('a') && c <= CharT('z') ? CharT(c - ('a' - 'A')) : c; 
+    }
+
     UU_ALWAYS_INLINE void reset() {
-        m_ptr = m_buf;
+        m_ptr = nullptr;
         clear();
         m_capacity = InlineCapacity;
     }
@@ -193,6 +225,24 @@ public:
     // constructing ===============================================================================
 
     constexpr BasicString() noexcept { null_terminate(); }
+
+    constexpr explicit BasicString(const AllocatorT &allocator) noexcept : m_allocator(allocator) { 
+        null_terminate(); 
+    }
+
+    constexpr BasicString(const CharT *ptr, Size length, const AllocatorT &allocator) : m_allocator(allocator) {
+        assign(ptr, length);
+    }
+
+    constexpr BasicString(const CharT *ptr, const AllocatorT &allocator) : m_allocator(allocator) {
+        assign(ptr, TraitsT::length(ptr));
+    }
+
+    template <typename StringViewLikeT, typename MaybeT = StringViewLikeT,
+        std::enable_if_t<IsStringViewLike<MaybeT, CharT, TraitsT>, int> = 0>
+    constexpr BasicString(const StringViewLikeT &str, const AllocatorT &allocator) : m_allocator(allocator) {
+        assign(str);
+    }
     
     constexpr explicit BasicString(Size capacity) {
         reserve(capacity);
@@ -240,7 +290,7 @@ public:
         assign(str.data(), str.length());
     }
 
-    constexpr BasicString(const BasicString &other) {
+    constexpr BasicString(const BasicString &other) : m_allocator(other.m_allocator) {
         assign(other.data(), other.length());
     }
 
@@ -248,7 +298,7 @@ public:
         assign(path.string());
     }
 
-    constexpr BasicString(BasicString &&other) {
+    constexpr BasicString(BasicString &&other) : m_allocator(other.m_allocator) {
         if (other.is_using_allocated_buffer()) {
             m_ptr = other.data();
             m_length = other.length();
@@ -280,20 +330,20 @@ public:
 
     constexpr ~BasicString() {
         if (is_using_allocated_buffer()) {
-            Memory mem = { data(), capacity() };
-            Allocator &allocator = Context::get().allocator();
-            allocator.dealloc(mem);
+            Memory mem = allocated_memory();
+            m_allocator.dealloc(mem);
         }
     }
 
     // accessors ==================================================================================
 
-    constexpr CharT *data() const { return m_ptr; }
-    constexpr CharT *data() { return m_ptr; }
+    constexpr CharT *data() const { return m_ptr ? m_ptr : const_cast<CharT *>(m_buf); }
+    constexpr CharT *data() { return m_ptr ? m_ptr : m_buf; }
     constexpr Size length() const { return m_length; }
     constexpr Size size() const { return m_length; }
     constexpr Size max_size() const noexcept { return std::distance(begin(), end()); }
     constexpr Size capacity() const { return m_capacity; }
+    constexpr const AllocatorT &allocator() const { return m_allocator; }
     constexpr CharT& front() { return data()[0]; }
     constexpr CharT& front() const { return data()[0]; }
     constexpr CharT& back() { return data()[m_length - 1]; }
@@ -360,12 +410,11 @@ public:
         }
 
         if (length() < InlineCapacity) {
-            Memory old_mem = { data(), capacity() };
-            Allocator &allocator = Context::get().allocator();
-            m_ptr = m_buf;
+            Memory old_mem = allocated_memory();
+            m_ptr = nullptr;
             m_capacity = InlineCapacity;
             TraitsT::copy(data(), (CharT *)old_mem.ptr, length());
-            allocator.dealloc(old_mem);
+            m_allocator.dealloc(old_mem);
             null_terminate();
             ASSERT(is_using_inline_buffer());
             return;
@@ -376,14 +425,11 @@ public:
             return;
         }
 
-        Memory old_mem = { data(), capacity() };
-        Allocator &allocator = Context::get().allocator();
-        Size amt = (shrink_length * sizeof(CharT)) + 1;
-        Memory mem = allocator.alloc(amt);
-        m_ptr = (CharT *)mem.ptr;
-        m_capacity = mem.capacity;
-        TraitsT::copy(m_ptr, (CharT *)old_mem.ptr, length());
-        allocator.dealloc(old_mem);
+        Memory mem = allocated_memory();
+        Size amt = (shrink_length + 1) * sizeof(CharT);
+        if (m_allocator.reallocate(mem, amt)) {
+            adopt_allocated_memory(mem);
+        }
         null_terminate();
         ASSERT(is_using_allocated_buffer());
     }
@@ -909,6 +955,14 @@ public:
     }
 
     constexpr Size find(CharT c, Size pos = 0) const noexcept {
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                if (pos >= length()) {
+                    return npos;
+                }
+                return byte_search_result(find_byte(byte_data() + pos, byte_data() + length(), char(c)));
+            }
+        }
         for (Size idx = pos; idx < length(); idx++) {
             if (TraitsT::eq(data()[idx], c)) {
                 return idx;
@@ -929,7 +983,13 @@ public:
         else if (t.length() == 1) {
             return find(t[0], pos);
         }
-        else if (t.length() == 2) {
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                const char *needle = reinterpret_cast<const char *>(t.data());
+                return byte_search_result(find_substring(byte_data() + pos, byte_data() + length(), needle, t.length()));
+            }
+        }
+        if (t.length() == 2) {
             const CharT a = t[0];
             const CharT b = t[1];
             for (Size idx = pos; idx < length() - 1; idx++) {
@@ -950,6 +1010,8 @@ public:
         }
     }
 
+    // These build the Boyer-Moore tables on every call. To look for the same needle again 
+    // and again, compile it once into a Searcher.
     constexpr Size find_boyer_moore(const BasicString &str, Size pos = 0) const {
         return find_boyer_moore(BasicStringView(str), pos);
     }
@@ -1011,6 +1073,11 @@ public:
             return npos;
         }
         Size idx = std::min(pos, length() - 1);
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                return byte_search_result(rfind_byte(byte_data(), byte_data() + idx + 1, char(c)));
+            }
+        }
         for (;;) {
             if (TraitsT::eq(data()[idx], c)) {
                 return idx;
@@ -1038,7 +1105,14 @@ public:
         else if (t.length() == 1) {
             return rfind(t[0], pos);
         }
-        else if (t.length() == 2) {
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                const char *needle = reinterpret_cast<const char *>(t.data());
+                Size last = std::min(pos, length() - t.length()) + t.length();
+                return byte_search_result(rfind_substring(byte_data(), byte_data() + last, needle, t.length()));
+            }
+        }
+        if (t.length() == 2) {
             const CharT a = t[0];
             const CharT b = t[1];
             Size idx = std::min(pos, length() - t.length());
@@ -1093,6 +1167,11 @@ public:
         if (pos > length()) {
             return npos;
         }
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated() && t.length() > 1) {
+                return find_first_of(byte_set(t), pos);
+            }
+        }
         for (Size idx = pos; idx < length(); idx++) {
             for (Size cidx = 0; cidx < t.length(); cidx++) {
                 if (TraitsT::eq(data()[idx], t[cidx])) {
@@ -1103,6 +1182,24 @@ public:
         return npos;
     }
 
+    // The ByteSet overloads compile the set once, for finding it again and again, and can test 
+    // a block of bytes at a time.
+    template <class CharX = CharT, std::enable_if_t<IsByteSized<CharX>, int> = 0>
+    constexpr Size find_first_of(const ByteSet &set, Size pos = 0) const noexcept {
+        if (pos >= length()) {
+            return npos;
+        }
+        if (!std::is_constant_evaluated()) {
+            return byte_search_result(find_first_in(byte_data() + pos, byte_data() + length(), set));
+        }
+        for (Size idx = pos; idx < length(); idx++) {
+            if (set.contains(char(data()[idx]))) {
+                return idx;
+            }
+        }
+        return npos;
+    }
+
     // find_first_not_of ==========================================================================
 
     constexpr Size find_first_not_of(const BasicString &str, Size pos = 0) const noexcept {
@@ -1135,6 +1232,11 @@ public:
         if (pos > length()) {
             return npos;
         }
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                return find_first_not_of(byte_set(t), pos);
+            }
+        }
         for (Size idx = pos; idx < length(); idx++) {
             bool match = false;
             for (Size cidx = 0; cidx < t.length(); cidx++) {
@@ -1150,6 +1252,22 @@ public:
         return npos;
     }
 
+    template <class CharX = CharT, std::enable_if_t<IsByteSized<CharX>, int> = 0>
+    constexpr Size find_first_not_of(const ByteSet &set, Size pos = 0) const noexcept {
+        if (pos >= length()) {
+            return npos;
+        }
+        if (!std::is_constant_evaluated()) {
+            return byte_search_result(find_first_not_in(byte_data() + pos, byte_data() + length(), set));
+        }
+        for (Size idx = pos; idx < length(); idx++) {
+            if (!set.contains(char(data()[idx]))) {
+                return idx;
+            }
+        }
+        return npos;
+    }
+
     // find_last_of ==============================================================================
 
     constexpr Size find_last_of(const BasicString &str, Size pos = npos) const noexcept {
@@ -1177,6 +1295,11 @@ public:
         if (t.length() == 0) {
             return npos;
         }
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated() && t.length() > 1) {
+                return find_last_of(byte_set(t), pos);
+            }
+        }
         Size idx = std::min(pos, length() - 1);
         for (;;) {
             for (Size cidx = 0; cidx < t.length(); cidx++) {
@@ -1192,6 +1315,23 @@ public:
         return npos;
     }
 
+    template <class CharX = CharT, std::enable_if_t<IsByteSized<CharX>, int> = 0>
+    constexpr Size find_last_of(const ByteSet &set, Size pos = npos) const noexcept {
+        if (length() == 0) {
+            return npos;
+        }
+        Size end = std::min(pos, length() - 1) + 1;
+        if (!std::is_constant_evaluated()) {
+            return byte_search_result(find_last_in(byte_data(), byte_data() + end, set));
+        }
+        for (Size idx = end; idx > 0; idx--) {
+            if (set.contains(char(data()[idx - 1]))) {
+                return idx - 1;
+            }
+        }
+        return npos;
+    }
+
     // find_last_not_of ==============================================================================
 
     constexpr Size find_last_not_of(const BasicString& str, Size pos = npos) const noexcept {
@@ -1230,6 +1370,11 @@ public:
         if (t.length() == 0) {
             return idx;
         }
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                return find_last_not_of(byte_set(t), pos);
+            }
+        }
         for (;;) {
             bool match = false;
             for (Size cidx = 0; cidx < t.length(); cidx++) {
@@ -1249,6 +1394,23 @@ public:
         return npos;
     }
 
+    template <class CharX = CharT, std::enable_if_t<IsByteSized<CharX>, int> = 0>
+    constexpr Size find_last_not_of(const ByteSet &set, Size pos = npos) const noexcept {
+        if (length() == 0) {
+            return npos;
+        }
+        Size end = std::min(pos, length() - 1) + 1;
+        if (!std::is_constant_evaluated()) {
+            return byte_search_result(find_last_not_in(byte_data(), byte_data() + end, set));
+        }
+        for (Size idx = end; idx > 0; idx--) {
+            if (!set.contains(char(data()[idx - 1]))) {
+                return idx - 1;
+            }
+        }
+        return npos;
+    }
+
     // replace ====================================================================================
 
     constexpr BasicString &replace(Size pos, Size count, const BasicString &str) {
@@ -1386,9 +1548,11 @@ public:
 
     constexpr BasicString &operator=(BasicString &&other) noexcept {
         clear();
-        if (other.is_using_allocated_buffer()) {
+        // only take over the buffer if it can go back to this string's allocator
+        if (other.is_using_allocated_buffer() && m_allocator == other.m_allocator) {
             if (is_using_allocated_buffer()) {
-                free(data());
+                Memory mem = allocated_memory();
+                m_allocator.dealloc(mem);
             }
             m_ptr = other.data();
             m_length = other.length();
@@ -1396,6 +1560,10 @@ public:
         }
         else {
             assign(other.data(), other.length());
+            if (other.is_using_allocated_buffer()) {
+                Memory mem = other.allocated_memory();
+                other.m_allocator.dealloc(mem);
+            }
         }
         other.reset();
         return *this;
@@ -1574,7 +1742,7 @@ public:
             // m_buf and data()
             CharT *tmp_ptr = other.data();
             TraitsT::copy(other.m_buf, m_buf, InlineCapacity);
-            other.m_ptr = other.m_buf;
+            other.m_ptr = nullptr;
             m_ptr = tmp_ptr;
 
             // m_length
@@ -1591,7 +1759,7 @@ public:
             // m_buf and data()
             CharT *tmp_ptr = data();
             TraitsT::copy(m_buf, other.m_buf, InlineCapacity);
-            m_ptr = m_buf;
+            m_ptr = nullptr;
             other.m_ptr = tmp_ptr;
 
             // m_length
@@ -1622,6 +1790,113 @@ public:
             m_capacity = other.capacity();
             other.m_capacity = tmp_capacity;
         }
+
+        // buffers move with the allocators that own them
+        std::swap(m_allocator, other.m_allocator);
+    }
+
+    // case =======================================================================================
+
+    // These change, compare, and find ASCII letters without regard to their case. Other 
+    // characters, including those in multibyte UTF-8 sequences, are left as they are and 
+    // compared exactly. For Unicode case folding of UTF-8, see CaseFold.h.
+
+    constexpr BasicString &to_lower() {
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                char *ptr = reinterpret_cast<char *>(data());
+                to_lower_ascii(ptr, ptr + length());
+                return *this;
+            }
+        }
+        for (Size idx = 0; idx < length(); idx++) {
+            data()[idx] = lower_ascii(data()[idx]);
+        }
+        return *this;
+    }
+
+    constexpr BasicString &to_upper() {
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                char *ptr = reinterpret_cast<char *>(data());
+                to_upper_ascii(ptr, ptr + length());
+                return *this;
+            }
+        }
+        for (Size idx = 0; idx < length(); idx++) {
+            data()[idx] = upper_ascii(data()[idx]);
+        }
+        return *this;
+    }
+
+    constexpr int compare_case_insensitive(const BasicString &str) const noexcept {
+        return compare_case_insensitive(BasicStringView(str));
+    }
+
+    constexpr int compare_case_insensitive(const CharT *s) const {
+        return compare_case_insensitive(BasicStringView(s, TraitsT::length(s)));
+    }
+
+    template <typename StringViewLikeT, typename MaybeT = StringViewLikeT,
+        std::enable_if_t<IsStringViewLike<MaybeT, CharT, TraitsT>, int> = 0>
+    constexpr int compare_case_insensitive(const StringViewLikeT &t) const noexcept {
+        Size len = std::min(length(), t.length());
+        int result = 0;
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                result = UU::compare_case_insensitive(byte_data(), reinterpret_cast<const char *>(t.data()), len);
+                len = 0;
+            }
+        }
+        for (Size idx = 0; idx < len; idx++) {
+            CharT a = lower_ascii(data()[idx]);
+            CharT b = lower_ascii(t[idx]);
+            if (!TraitsT::eq(a, b)) {
+                result = TraitsT::lt(a, b) ? -1 : 1;
+                break;
+            }
+        }
+        if (result == 0 && length() != t.length()) {
+            result = length() < t.length() ? -1 : 1;
+        }
+        return result;
+    }
+
+    constexpr Size find_case_insensitive(const BasicString &str, Size pos = 0) const noexcept {
+        return find_case_insensitive(BasicStringView(str), pos);
+    }
+
+    constexpr Size find_case_insensitive(const CharT *s, Size pos = 0) const {
+        return find_case_insensitive(BasicStringView(s, TraitsT::length(s)), pos);
+    }
+
+    // Folds the string a block at a time as it searches, without copying it.
+    template <typename StringViewLikeT, typename MaybeT = StringViewLikeT,
+        std::enable_if_t<IsStringViewLike<MaybeT, CharT, TraitsT>, int> = 0>
+    constexpr Size find_case_insensitive(const StringViewLikeT &t, Size pos = 0) const noexcept {
+        if (t.length() == 0) {
+            return pos;
+        }
+        if (t.length() > length() || pos > length()) {
+            return npos;
+        }
+        if constexpr (UsesByteSearch) {
+            if (!std::is_constant_evaluated()) {
+                const char *needle = reinterpret_cast<const char *>(t.data());
+                return byte_search_result(find_substring_case_insensitive(byte_data() + pos, byte_data() + length(), 
+                    needle, t.length()));
+            }
+        }
+        for (Size idx = pos; idx + t.length() <= length(); idx++) {
+            Size matched = 0;
+            while (matched < t.length() && TraitsT::eq(lower_ascii(data()[idx + matched]), lower_ascii(t[matched]))) {
+                matched++;
+            }
+            if (matched == t.length()) {
+                return idx;
+            }
+        }
+        return npos;
     }
 
     // extensions =================================================================================
@@ -1727,41 +2002,63 @@ public:
 
 
 private:
+    // The allocated buffer as the allocator sees it, with its capacity in bytes.
+    UU_ALWAYS_INLINE Memory allocated_memory() const {
+        return { m_ptr, m_capacity * sizeof(CharT) };
+    }
+
+    UU_ALWAYS_INLINE void adopt_allocated_memory(const Memory &mem) {
+        m_ptr = static_cast<CharT *>(mem.ptr);
+        m_capacity = mem.capacity / sizeof(CharT);
+    }
+
+    // callers go on to write into the new capacity, so there is no carrying on without it
+    [[noreturn]] static void report_allocation_failure(Size bytes) {
+        ASSERT_WITH_MESSAGE(false, "String unable to allocate %lu bytes", bytes);
+        CRASH();
+    }
+
     void grow(Size new_capacity) {
-        Size old_capacity = m_capacity;
-        while (m_capacity < new_capacity) {
-            m_capacity *= 2;
+        Size capacity = m_capacity;
+        while (capacity < new_capacity) {
+            capacity *= 2;
         }
-        Size amt = m_capacity * sizeof(CharT);
+        Size amt = capacity * sizeof(CharT);
         if (is_using_allocated_buffer()) {
-            Memory old_mem = { m_ptr, old_capacity };
-            Allocator &allocator = Context::get().allocator();
-            Memory mem = allocator.alloc(amt);
-            TraitsT::copy((CharT *)mem.ptr, m_ptr, length());
-            m_ptr = static_cast<CharT *>(mem.ptr);
-            m_capacity = mem.capacity;
-            allocator.dealloc(old_mem);
+            // lets the allocator extend the buffer where it is, rather than always copying
+            Memory mem = allocated_memory();
+            if (UNLIKELY(!m_allocator.reallocate(mem, amt))) {
+                report_allocation_failure(amt);
+            }
+            adopt_allocated_memory(mem);
         }
         else {
-            Allocator &allocator = Context::get().allocator();
-            Memory mem = allocator.alloc(amt);
-            m_ptr = static_cast<CharT *>(mem.ptr);
-            m_capacity = mem.capacity;
-            TraitsT::copy(m_ptr, m_buf, length());
+            Memory mem = m_allocator.alloc(amt);
+            if (UNLIKELY(mem.is_empty())) {
+                report_allocation_failure(amt);
+            }
+            TraitsT::copy(static_cast<CharT *>(mem.ptr), m_buf, length());
+            adopt_allocated_memory(mem);
         }
         null_terminate();
     }
 
+    // m_ptr is null while the string is in m_buf, so a BasicString holds no pointers into 
+    // itself and can be relocated with memcpy.
     CharT m_buf[InlineCapacity] = { '\0' };
-    CharT *m_ptr = m_buf;
+    CharT *m_ptr = nullptr;
     Size m_length = 0;
     Size m_capacity = InlineCapacity;
+    [[no_unique_address]] AllocatorT m_allocator;
 };
 
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+struct IsTriviallyRelocatable_<BasicString<CharT, S, TraitsT, AllocatorT>> : IsTriviallyRelocatable_<AllocatorT> {};
+
 // output ======================================================================================---
 
-template <typename CharT, Size S, typename TraitsT>
-std::basic_ostream<CharT> &operator<<(std::basic_ostream<CharT> &os, const BasicString<CharT, S, TraitsT> &str)
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+std::basic_ostream<CharT> &operator<<(std::basic_ostream<CharT> &os, const BasicString<CharT, S, TraitsT, AllocatorT> &str)
 {
     os.write(str.data(), str.length());
     return os;
@@ -1769,95 +2066,95 @@ std::basic_ostream<CharT> &operator<<(std::basic_ostream<CharT> &os, const Basic
 
 // operator+ ======================================================================================
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &lhs,
-    const BasicString<CharT, S, TraitsT> &rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &lhs,
+    const BasicString<CharT, S, TraitsT, AllocatorT> &rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &lhs, 
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &lhs, 
     const CharT* rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &lhs, CharT rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &lhs, CharT rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const CharT* lhs, 
-    const BasicString<CharT, S, TraitsT> &rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const CharT* lhs, 
+    const BasicString<CharT, S, TraitsT, AllocatorT> &rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(CharT lhs, const BasicString<CharT, S, TraitsT> &rhs) {
-        BasicString<CharT, S, TraitsT> str(1, lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(CharT lhs, const BasicString<CharT, S, TraitsT, AllocatorT> &rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(1, lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &&lhs,
-    const BasicString<CharT, S, TraitsT> &&rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &&lhs,
+    const BasicString<CharT, S, TraitsT, AllocatorT> &&rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &&lhs,
-    const BasicString<CharT, S, TraitsT> &rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &&lhs,
+    const BasicString<CharT, S, TraitsT, AllocatorT> &rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &&lhs,
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &&lhs,
     const CharT *rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &&lhs, CharT rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &&lhs, CharT rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const BasicString<CharT, S, TraitsT> &lhs,
-    const BasicString<CharT, S, TraitsT> &&rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const BasicString<CharT, S, TraitsT, AllocatorT> &lhs,
+    const BasicString<CharT, S, TraitsT, AllocatorT> &&rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(const CharT *lhs, 
-    const BasicString<CharT, S, TraitsT> &&rhs) {
-        BasicString<CharT, S, TraitsT> str(lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(const CharT *lhs, 
+    const BasicString<CharT, S, TraitsT, AllocatorT> &&rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(lhs);
         str += rhs;
         return str;
 }
 
-template <typename CharT, Size S, typename TraitsT>
-BasicString<CharT, S, TraitsT> operator+(CharT lhs,
-    const BasicString<CharT, S, TraitsT> &&rhs) {
-        BasicString<CharT, S, TraitsT> str(1, lhs);
+template <typename CharT, Size S, typename TraitsT, typename AllocatorT>
+BasicString<CharT, S, TraitsT, AllocatorT> operator+(CharT lhs,
+    const BasicString<CharT, S, TraitsT, AllocatorT> &&rhs) {
+        BasicString<CharT, S, TraitsT, AllocatorT> str(1, lhs);
         str += rhs;
         return str;
 }
@@ -1872,26 +2169,27 @@ using StringView = BasicString<char, BasicStringDefaultInlineCapacity>::BasicStr
 
 namespace std
 {
-    template <typename CharT, UU::Size S, typename TraitsT>
-    struct std::formatter<UU::BasicString<CharT, S, TraitsT>, CharT> : std::formatter<std::basic_string_view<CharT, TraitsT>, CharT> {
+    template <typename CharT, UU::Size S, typename TraitsT, typename AllocatorT>
+    struct std::formatter<UU::BasicString<CharT, S, TraitsT, AllocatorT>, CharT> : std::formatter<std::basic_string_view<CharT, TraitsT>, CharT> {
         using SV = std::basic_string_view<CharT, TraitsT>;
         template <class FormatContext>
-        auto format(UU::BasicString<CharT, S, TraitsT> str, FormatContext &fc) const {
+        auto format(UU::BasicString<CharT, S, TraitsT, AllocatorT> str, FormatContext &fc) const {
             SV sv(str.data(), str.length());
             return std::formatter<SV>::format(sv, fc);
         }
     };
 
     // Implement std::swap in terms of BasicString swap
-    template <typename CharT, UU::Size S>
-    UU_ALWAYS_INLINE void swap(UU::BasicString<CharT, S, std::char_traits<CharT>> &lhs, UU::BasicString<CharT, S, std::char_traits<CharT>> &rhs) {
+    template <typename CharT, UU::Size S, typename AllocatorT>
+    UU_ALWAYS_INLINE void swap(UU::BasicString<CharT, S, std::char_traits<CharT>, AllocatorT> &lhs, 
+        UU::BasicString<CharT, S, std::char_traits<CharT>, AllocatorT> &rhs) {
         lhs.swap(rhs);
     }
     
-    template <typename CharT, UU::Size S>
-    struct less<UU::BasicString<CharT, S, std::char_traits<CharT>>>
+    template <typename CharT, UU::Size S, typename AllocatorT>
+    struct less<UU::BasicString<CharT, S, std::char_traits<CharT>, AllocatorT>>
     {
-        using StringT = UU::BasicString<CharT, S, std::char_traits<CharT>>;
+        using StringT = UU::BasicString<CharT, S, std::char_traits<CharT>, AllocatorT>;
         bool operator()(const StringT &lhs, const StringT &rhs) const {
             return lhs < rhs;
         }
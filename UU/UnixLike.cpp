@@ -22,13 +22,25 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <fstream>
+#include <sstream>
+#include <thread>
+
 #include <sys/types.h>
-#include <sys/sysctl.h>
 #include <unistd.h>
 
 #include "Assertions.h"
+#include "Platform.h"
 #include "UnixLike.h"
 
+#if OS(DARWIN)
+#include <sys/sysctl.h>
+#endif
+
+#if OS(LINUX)
+#include <sched.h>
+#endif
+
 namespace fs = std::filesystem;
 
 namespace UU {
@@ -74,6 +86,7 @@ String shell_escaped_string(const String &str)
 
 int get_sysctl_logicalcpu()
 {
+#if OS(DARWIN)
     int num = 0;
     size_t len = sizeof(num);
     int rc = sysctlbyname("hw.logicalcpu", &num, &len, NULL, 0);
@@ -82,12 +95,177 @@ int get_sysctl_logicalcpu()
         return 0;
     }
     return num;
+#else
+    return 0;
+#endif
+}
+
+int get_affinity_cpu_count()
+{
+#if OS(LINUX)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == -1) {
+        LOG(Error, "get_affinity_cpu_count: failed: %s", strerror(errno));
+        return 0;
+    }
+    return CPU_COUNT(&set);
+#else
+    return 0;
+#endif
+}
+
+static bool read_first_line(const char *path, std::string &line)
+{
+    std::ifstream in(path);
+    return in && std::getline(in, line);
+}
+
+int cgroup_cpu_limit_from_quota(long long quota, long long period)
+{
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    // round up, so a quota of 1.5 CPUs gets 2 threads
+    return static_cast<int>((quota + period - 1) / period);
+}
+
+std::string cgroup_path_for_controller(const std::string &proc_self_cgroup, const std::string &controller)
+{
+    std::istringstream in(proc_self_cgroup);
+    std::string line;
+    while (std::getline(in, line)) {
+        // hierarchy-id:controller-list:path
+        Size first = line.find(':');
+        Size second = first == std::string::npos ? first : line.find(':', first + 1);
+        if (second == std::string::npos) {
+            continue;
+        }
+        std::string_view controllers(line.data() + first + 1, second - first - 1);
+        if (controller.empty()) {
+            if (controllers.empty()) {
+                return line.substr(second + 1);
+            }
+            continue;
+        }
+        while (!controllers.empty()) {
+            Size comma = std::min(controllers.find(','), controllers.length());
+            if (controllers.substr(0, comma) == controller) {
+                return line.substr(second + 1);
+            }
+            controllers.remove_prefix(std::min(comma + 1, controllers.length()));
+        }
+    }
+    return std::string();
+}
+
+#if OS(LINUX)
+
+// cgroup v2: "<quota> <period>", where quota may be "max"
+static int cgroup_v2_cpu_limit(const fs::path &dir)
+{
+    std::string line;
+    if (!read_first_line((dir / "cpu.max").c_str(), line) || line.starts_with("max")) {
+        return 0;
+    }
+    long long quota = 0;
+    long long period = 0;
+    if (sscanf(line.c_str(), "%lld %lld", &quota, &period) != 2) {
+        return 0;
+    }
+    return cgroup_cpu_limit_from_quota(quota, period);
+}
+
+// cgroup v1: separate quota and period files, with a quota of -1 meaning no limit
+static int cgroup_v1_cpu_limit(const fs::path &dir)
+{
+    std::string quota_line;
+    std::string period_line;
+    if (!read_first_line((dir / "cpu.cfs_quota_us").c_str(), quota_line) || 
+        !read_first_line((dir / "cpu.cfs_period_us").c_str(), period_line)) {
+        return 0;
+    }
+    return cgroup_cpu_limit_from_quota(atoll(quota_line.c_str()), atoll(period_line.c_str()));
+}
+
+// A quota on any cgroup between the process's own and the root of the hierarchy applies to
+// the process, so this takes the smallest one on the way up. In a container with its own
+// cgroup namespace, the path is "/" and only the mount point is read. Without one, the path
+// may name a cgroup that isn't visible under the mount, and those levels are just skipped.
+static int smallest_cgroup_cpu_limit(const fs::path &mount, const std::string &path, int (*limit)(const fs::path &))
+{
+    int result = 0;
+    fs::path relative = fs::path(path).relative_path();
+    for (;;) {
+        int level = limit(mount / relative);
+        if (level > 0 && (result == 0 || level < result)) {
+            result = level;
+        }
+        if (relative.empty()) {
+            break;
+        }
+        relative = relative.parent_path();
+    }
+    return result;
+}
+
+#endif
+
+int get_cgroup_cpu_limit()
+{
+#if OS(LINUX)
+    std::string proc_self_cgroup;
+    {
+        std::ifstream in("/proc/self/cgroup");
+        std::ostringstream out;
+        out << in.rdbuf();
+        proc_self_cgroup = out.str();
+    }
+
+    // a v1 cpu controller, on v1-only and hybrid systems, is the one that enforces quotas
+    std::string path = cgroup_path_for_controller(proc_self_cgroup, "cpu");
+    if (path.length()) {
+        static const char *mounts[] = { "/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct" };
+        for (const char *mount : mounts) {
+            std::error_code ec;
+            if (fs::is_directory(mount, ec)) {
+                return smallest_cgroup_cpu_limit(mount, path, cgroup_v1_cpu_limit);
+            }
+        }
+        return 0;
+    }
+
+    path = cgroup_path_for_controller(proc_self_cgroup, "");
+    if (path.empty()) {
+        path = "/";
+    }
+    return smallest_cgroup_cpu_limit("/sys/fs/cgroup", path, cgroup_v2_cpu_limit);
+#else
+    return 0;
+#endif
 }
 
 int get_good_concurrency_count()
 {
-    int c = get_sysctl_logicalcpu();
-    return c > 0 ? c : 8;
+    static const int count = [] {
+#if OS(LINUX)
+        int c = get_affinity_cpu_count();
+        int limit = get_cgroup_cpu_limit();
+        if (c > 0 && limit > 0) {
+            c = std::min(c, limit);
+        }
+        else if (limit > 0) {
+            c = limit;
+        }
+#else
+        int c = get_sysctl_logicalcpu();
+#endif
+        if (c <= 0) {
+            c = std::thread::hardware_concurrency();
+        }
+        return c > 0 ? c : 8;
+    }();
+    return count;
 }
 
 
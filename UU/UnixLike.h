@@ -37,6 +37,23 @@ int launch(const std::filesystem::path &program, const std::vector<String> &args
 String shell_escaped_string(const String &str);
 
 int get_sysctl_logicalcpu();
+
+// The number of CPUs in the calling thread's affinity mask, or zero where that is unknown.
+int get_affinity_cpu_count();
+
+// The CPU limit imposed by a cgroup quota, rounded up, or zero if there is no limit. The
+// process's own cgroup is found from /proc/self/cgroup, and the tightest quota between it
+// and the root of the hierarchy wins.
+int get_cgroup_cpu_limit();
+int cgroup_cpu_limit_from_quota(long long quota, long long period);
+
+// The path of the process's cgroup in the v1 hierarchy with the given controller, or in the 
+// v2 hierarchy when controller is empty, parsed from the contents of /proc/self/cgroup. 
+// Returns an empty string if there is no such hierarchy.
+std::string cgroup_path_for_controller(const std::string &proc_self_cgroup, const std::string &controller);
+
+// The number of threads worth running at once: the logical CPU count on Darwin; on Linux,
+// the affinity mask size, capped by any cgroup quota. Computed once and cached.
 int get_good_concurrency_count();
 
 
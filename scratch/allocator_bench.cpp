@@ -0,0 +1,76 @@
+//
+// allocator_bench.cpp
+//
+// Multi-threaded small-object throughput for GPAllocator, with and without StatsAllocator,
+// versus malloc.
+// Usage: allocator_bench [max-threads] [ops-per-thread]
+//
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <UU/UU.h>
+
+using namespace UU;
+
+static constexpr Size Live = 256;
+
+template <typename Alloc>
+static void churn(Alloc &allocator, Size ops) 
+{
+    Memory live[Live];
+    for (Size idx = 0; idx < Live; idx++) {
+        live[idx] = allocator.alloc(16 + (idx % 12) * 16);
+    }
+    UInt32 seed = 0x9e3779b9;
+    for (Size idx = 0; idx < ops; idx++) {
+        seed = seed * 1664525 + 1013904223;
+        Size slot = seed % Live;
+        allocator.dealloc(live[slot]);
+        live[slot] = allocator.alloc(8 + (seed >> 24) % 500);
+        *static_cast<Byte *>(live[slot].ptr) = Byte(idx);
+    }
+    for (Size idx = 0; idx < Live; idx++) {
+        allocator.dealloc(live[idx]);
+    }
+}
+
+template <typename Alloc>
+static double run(Alloc &allocator, Size threads, Size ops) 
+{
+    auto mark = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (Size t = 0; t < threads; t++) {
+        workers.emplace_back([&allocator, ops] { churn(allocator, ops); });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mark;
+    return (threads * ops) / elapsed.count() / 1e6;
+}
+
+int main(int argc, const char *argv[]) 
+{
+    Size max_threads = argc > 1 ? atoi(argv[1]) : get_good_concurrency_count();
+    Size ops = argc > 2 ? atoi(argv[2]) : 2000000;
+
+    std::cout << "threads    GPAllocator Mops/s    StatsAllocator Mops/s    Mallocator Mops/s" << std::endl;
+    std::vector<Size> counts;
+    for (Size threads = 1; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+    for (Size threads : counts) {
+        GPAllocator gp;
+        StatsAllocator<GPAllocator> stats;
+        Mallocator mallocator;
+        double gp_rate = run(gp, threads, ops);
+        double stats_rate = run(stats, threads, ops);
+        double malloc_rate = run(mallocator, threads, ops);
+        printf("%7lu    %18.2f    %21.2f    %17.2f\n", threads, gp_rate, stats_rate, malloc_rate);
+    }
+    return 0;
+}
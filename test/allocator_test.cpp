@@ -0,0 +1,867 @@
+//
+// allocator_test.cpp
+//
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+TEST_CASE("GPAllocator size classes", "[allocator]" ) {
+    GPAllocator allocator;
+    Memory m1 = allocator.alloc(1);
+    REQUIRE(m1.not_empty());
+    REQUIRE(m1.capacity == 32);
+    Memory m2 = allocator.alloc(33);
+    REQUIRE(m2.capacity == 48);
+    Memory m3 = allocator.alloc(1000);
+    REQUIRE(m3.capacity == 1024);
+    Memory m4 = allocator.alloc(5000);
+    REQUIRE(m4.capacity == 6144);
+    Memory m5 = allocator.alloc(GPAllocator::MaxClassSize);
+    REQUIRE(m5.capacity == GPAllocator::MaxClassSize);
+    Memory m6 = allocator.alloc(GPAllocator::MaxClassSize + 1);
+    REQUIRE(m6.capacity == MmapAllocator::round_up_to_page_size(GPAllocator::MaxClassSize + 1));
+    allocator.dealloc(m1);
+    allocator.dealloc(m2);
+    allocator.dealloc(m3);
+    allocator.dealloc(m4);
+    allocator.dealloc(m5);
+    allocator.dealloc(m6);
+}
+
+TEST_CASE("SizeClasses", "[allocator]" ) {
+    using Classes = SizeClasses<>;
+    static_assert(Classes::Count == 21);
+    static_assert(Classes::Sizes[0] == 32);
+    static_assert(Classes::Sizes[1] == 48);
+    static_assert(Classes::Sizes[Classes::Count - 1] == 32768);
+    static_assert(Classes::index(100) == 4);
+
+    using FineClasses = SizeClasses<64, 65536, 4>;
+    static_assert(FineClasses::Count == 41);
+    static_assert(FineClasses::Sizes[1] == 80);
+
+    // the lookup must pick the smallest class that fits, for every size
+    Size cls = 0;
+    for (Size size = 1; size <= Classes::MaxClassSize; size++) {
+        if (size > Classes::Sizes[cls]) {
+            cls++;
+        }
+        REQUIRE(Classes::index(size) == cls);
+    }
+    cls = 0;
+    for (Size size = 1; size <= FineClasses::MaxClassSize; size++) {
+        if (size > FineClasses::Sizes[cls]) {
+            cls++;
+        }
+        REQUIRE(FineClasses::index(size) == cls);
+    }
+}
+
+TEST_CASE("GPAllocator large classes", "[allocator]" ) {
+    GPAllocator allocator;
+    std::vector<Memory> mems;
+    for (Size size = 1025; size <= GPAllocator::MaxClassSize; size += 1000) {
+        Memory mem = allocator.alloc(size);
+        REQUIRE(mem.capacity == GPSizeClasses::size_for(align_up(size)));
+        memset(mem.ptr, 0xab, mem.capacity);
+        mems.push_back(mem);
+    }
+    for (auto &mem : mems) {
+        allocator.dealloc(mem);
+    }
+    allocator.flush_thread_cache();
+}
+
+TEST_CASE("GPAllocator thread cache reuse", "[allocator]" ) {
+    GPAllocator allocator;
+    Memory m1 = allocator.alloc(24);
+    void *ptr = m1.ptr;
+    allocator.dealloc(m1);
+    Memory m2 = allocator.alloc(16);
+    REQUIRE(m2.ptr == ptr);
+    allocator.dealloc(m2);
+    allocator.flush_thread_cache();
+}
+
+TEST_CASE("GPAllocator many blocks", "[allocator]" ) {
+    GPAllocator allocator;
+    std::vector<Memory> mems;
+    std::set<void *> ptrs;
+    for (int idx = 0; idx < 2000; idx++) {
+        Memory mem = allocator.alloc(48);
+        REQUIRE(mem.not_empty());
+        memset(mem.ptr, idx & 0xff, mem.capacity);
+        mems.push_back(mem);
+        ptrs.insert(mem.ptr);
+    }
+    REQUIRE(ptrs.size() == mems.size());
+    for (auto &mem : mems) {
+        allocator.dealloc(mem);
+    }
+}
+
+TEST_CASE("GPAllocator threads", "[allocator]" ) {
+    GPAllocator allocator;
+    constexpr int ThreadCount = 8;
+    constexpr int Rounds = 20000;
+
+    // each thread frees half its blocks and hands the rest to a neighbor to free
+    std::vector<std::vector<Memory>> handoffs(ThreadCount);
+    std::atomic<Size> corruptions = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++) {
+        threads.emplace_back([&allocator, &handoffs, &corruptions, t] {
+            std::vector<Memory> live;
+            for (int idx = 0; idx < Rounds; idx++) {
+                Memory mem = allocator.alloc(8 + ((idx * 37) % 1000));
+                *static_cast<int *>(mem.ptr) = t;
+                live.push_back(mem);
+                if (live.size() == 64) {
+                    for (Size j = 0; j < 32; j++) {
+                        if (*static_cast<int *>(live[j].ptr) != t) {
+                            corruptions++;
+                        }
+                        allocator.dealloc(live[j]);
+                    }
+                    live.erase(live.begin(), live.begin() + 32);
+                }
+            }
+            handoffs[t] = live;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(corruptions == 0);
+    threads.clear();
+    for (int t = 0; t < ThreadCount; t++) {
+        threads.emplace_back([&allocator, &handoffs, t] {
+            for (auto &mem : handoffs[(t + 1) % ThreadCount]) {
+                allocator.dealloc(mem);
+            }
+            allocator.flush_thread_cache();
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+TEST_CASE("ConcurrentBlockAllocator", "[allocator]" ) {
+    ConcurrentBlockAllocator<128, 64> allocator;
+    REQUIRE(allocator.is_empty());
+    std::vector<Memory> mems;
+    for (Size idx = 0; idx < 128; idx++) {
+        Memory mem = allocator.alloc(64);
+        REQUIRE(mem.not_empty());
+        REQUIRE(allocator.owns(mem));
+        REQUIRE(PageMap::get(mem.ptr) == &allocator);
+        mems.push_back(mem);
+    }
+    REQUIRE(allocator.is_full());
+    REQUIRE(allocator.alloc(64).is_empty());
+    REQUIRE(allocator.dealloc(mems[7]));
+    Memory mem = allocator.alloc(64);
+    REQUIRE(mem.ptr == mems[7].ptr);
+    for (auto &m : mems) {
+        allocator.dealloc(m);
+    }
+    REQUIRE(allocator.is_empty());
+    void *base = mems[0].ptr;
+    allocator.free_all();
+    REQUIRE(PageMap::get(base) == nullptr);
+}
+
+// Build with UU_TSAN set in the environment to run this under ThreadSanitizer.
+TEST_CASE("ConcurrentBlockAllocator threads", "[allocator]" ) {
+    constexpr int ThreadCount = 8;
+    constexpr int Rounds = 20000;
+    constexpr Size Slots = 1024;
+    auto allocator = std::make_unique<ConcurrentBlockAllocator<Slots, 64>>();
+
+    // each thread writes its id over every block it holds, and checks it is still there 
+    // before freeing, so a slot handed to two threads at once shows up as a corruption
+    std::atomic<Size> corruptions = 0;
+    std::atomic<Size> failures = 0;
+    std::vector<std::vector<Memory>> handoffs(ThreadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++) {
+        threads.emplace_back([&allocator, &handoffs, &corruptions, &failures, t] {
+            std::vector<Memory> live;
+            for (int idx = 0; idx < Rounds; idx++) {
+                Memory mem = allocator->alloc(64);
+                if (mem.is_empty()) {
+                    failures++;
+                    continue;
+                }
+                memset(mem.ptr, t, mem.capacity);
+                live.push_back(mem);
+                if (live.size() == 64) {
+                    for (Size j = 0; j < 48; j++) {
+                        Byte *bytes = static_cast<Byte *>(live[j].ptr);
+                        if (bytes[0] != t || bytes[63] != t) {
+                            corruptions++;
+                        }
+                        allocator->dealloc(live[j]);
+                    }
+                    live.erase(live.begin(), live.begin() + 48);
+                }
+            }
+            handoffs[t] = live;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(corruptions == 0);
+    REQUIRE(failures == 0);
+
+    // free every remaining block from a thread other than the one that took it
+    threads.clear();
+    for (int t = 0; t < ThreadCount; t++) {
+        threads.emplace_back([&allocator, &handoffs, t] {
+            for (auto &mem : handoffs[(t + 1) % ThreadCount]) {
+                allocator->dealloc(mem);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(allocator->is_empty());
+}
+
+TEST_CASE("PageMap", "[allocator]" ) {
+    void *base = aligned_alloc(PageMap::PageSize, PageMap::PageSize * 3);
+    int owner = 0;
+    REQUIRE(PageMap::get(base) == nullptr);
+    PageMap::set(base, PageMap::PageSize * 3, &owner);
+    REQUIRE(PageMap::get(base) == &owner);
+    REQUIRE(PageMap::get(byte_ptr(base) + PageMap::PageSize + 17) == &owner);
+    REQUIRE(PageMap::get(byte_ptr(base) + (PageMap::PageSize * 3) - 1) == &owner);
+    REQUIRE(PageMap::get(byte_ptr(base) + (PageMap::PageSize * 3)) == nullptr);
+    PageMap::clear(base, PageMap::PageSize * 3);
+    REQUIRE(PageMap::get(base) == nullptr);
+    free(base);
+}
+
+TEST_CASE("CascadingAllocator ownership", "[allocator]" ) {
+    using Block = BlockAllocator<64, 1, 64>;
+    auto a1 = std::make_unique<CascadingAllocator<Block, 8>>();
+    auto a2 = std::make_unique<CascadingAllocator<Block, 8>>();
+    std::vector<Memory> mems;
+    for (int idx = 0; idx < 300; idx++) {
+        Memory mem = a1->alloc(40);
+        REQUIRE(mem.not_empty());
+        mems.push_back(mem);
+    }
+    for (auto &mem : mems) {
+        REQUIRE(a1->owns(mem));
+        REQUIRE_FALSE(a2->owns(mem));
+    }
+    Memory foreign(mems[0].ptr, 64);
+    REQUIRE_FALSE(a2->dealloc(foreign));
+    for (auto &mem : mems) {
+        REQUIRE(a1->dealloc(mem));
+    }
+    // every block has emptied, and trim releases the ones kept for reuse
+    a1->trim();
+    REQUIRE(PageMap::get(mems[0].ptr) == nullptr);
+}
+
+TEST_CASE("CascadingAllocator retention", "[allocator]" ) {
+    using Block = BlockAllocator<64, 1, 64>;
+    auto cascade = std::make_unique<CascadingAllocator<Block, 8, 2>>();
+
+    // fill one block and part of the next, then empty the second over and over
+    std::vector<Memory> mems;
+    for (int idx = 0; idx < 64; idx++) {
+        mems.push_back(cascade->alloc(40));
+    }
+    Memory extra = cascade->alloc(40);
+    void *extra_ptr = extra.ptr;
+    for (int round = 0; round < 10; round++) {
+        REQUIRE(cascade->dealloc(extra));
+        REQUIRE(cascade->retained_count() == 1);
+        REQUIRE(PageMap::get(extra_ptr) != nullptr);
+        extra = cascade->alloc(40);
+        REQUIRE(extra.ptr == extra_ptr);
+        REQUIRE(cascade->retained_count() == 0);
+    }
+    REQUIRE(cascade->dealloc(extra));
+    for (auto &mem : mems) {
+        REQUIRE(cascade->dealloc(mem));
+    }
+    REQUIRE(cascade->retained_count() == 2);
+    REQUIRE(cascade->trim() == 2);
+    REQUIRE(cascade->retained_count() == 0);
+    REQUIRE(PageMap::get(extra_ptr) == nullptr);
+
+    // with no retention, empty blocks are freed at once
+    cascade->set_retention(0, CascadingAllocator<Block, 8, 2>::DefaultRetainTime);
+    Memory mem = cascade->alloc(40);
+    void *ptr = mem.ptr;
+    REQUIRE(cascade->dealloc(mem));
+    REQUIRE(cascade->retained_count() == 0);
+    REQUIRE(PageMap::get(ptr) == nullptr);
+
+    // blocks that sit empty past the retention time are freed when another block empties
+    cascade->set_retention(2, std::chrono::milliseconds(0));
+    mems.clear();
+    for (int idx = 0; idx < 65; idx++) {
+        mems.push_back(cascade->alloc(40));
+    }
+    void *last_ptr = mems.back().ptr;
+    REQUIRE(cascade->dealloc(mems.back()));
+    mems.pop_back();
+    REQUIRE(cascade->retained_count() == 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    for (auto &m : mems) {
+        REQUIRE(cascade->dealloc(m));
+    }
+    REQUIRE(cascade->retained_count() == 1);
+    REQUIRE(PageMap::get(last_ptr) == nullptr);
+    cascade->trim();
+}
+
+TEST_CASE("GPAllocator trim", "[allocator]" ) {
+    GPAllocator allocator;
+    Memory small = allocator.alloc(100);
+    void *small_ptr = small.ptr;
+    Memory large = allocator.alloc(100000);
+    allocator.dealloc(small);
+    allocator.dealloc(large);
+    REQUIRE(PageMap::get(small_ptr) != nullptr);
+    allocator.trim();
+    REQUIRE(PageMap::get(small_ptr) == nullptr);
+}
+
+TEST_CASE("GPAllocator drains an exiting thread's magazines", "[allocator]" ) {
+    GPAllocator allocator;
+    void *ptr = nullptr;
+    std::thread thread([&allocator, &ptr] {
+        Memory mem = allocator.alloc(100);
+        ptr = mem.ptr;
+        allocator.dealloc(mem);
+    });
+    thread.join();
+    // the block went back to its size class when the thread exited, so trim() can free it
+    REQUIRE(PageMap::get(ptr) != nullptr);
+    allocator.trim();
+    REQUIRE(PageMap::get(ptr) == nullptr);
+}
+
+TEST_CASE("ArenaAllocator", "[allocator]" ) {
+    ArenaAllocator arena(4096);
+    Memory m1 = arena.alloc(10);
+    REQUIRE(m1.capacity == 16);
+    REQUIRE(arena.owns(m1));
+    Memory m2 = arena.alloc(100);
+    REQUIRE(byte_ptr(m2.ptr) == byte_ptr(m1.ptr) + 16);
+
+    // freeing the most recent allocation gives its space back
+    arena.dealloc(m2);
+    Memory m3 = arena.alloc(8);
+    REQUIRE(m3.ptr == m2.ptr);
+
+    ArenaAllocator::Mark mark = arena.mark();
+    Size reserved = arena.bytes_reserved();
+    for (int idx = 0; idx < 100; idx++) {
+        Memory mem = arena.alloc(1000);
+        REQUIRE(arena.owns(mem));
+    }
+    Memory big = arena.alloc(100000);
+    REQUIRE(big.not_empty());
+    REQUIRE(arena.bytes_reserved() > reserved);
+    arena.rewind(mark);
+    REQUIRE(arena.bytes_reserved() == reserved);
+    REQUIRE_FALSE(arena.owns(big));
+    Memory m4 = arena.alloc(8);
+    REQUIRE(byte_ptr(m4.ptr) == byte_ptr(m3.ptr) + 8);
+
+    arena.free_all();
+    REQUIRE(arena.bytes_reserved() == 0);
+    REQUIRE_FALSE(arena.owns(m1));
+}
+
+TEST_CASE("ArenaScope", "[allocator]" ) {
+    String outside("this string is long enough to need an allocated buffer");
+    ArenaAllocator arena;
+    {
+        ArenaScope scope(arena);
+        REQUIRE(Context::get().allocator_depth() == 1);
+        String inside("this string is also long enough to need an allocated buffer");
+        REQUIRE(arena.owns(Memory(inside.data(), inside.capacity())));
+        REQUIRE_FALSE(arena.owns(Memory(outside.data(), outside.capacity())));
+        {
+            ArenaScope nested;
+            String s("and this one goes in the nested scope's own arena, which it frees");
+            REQUIRE(nested.arena().owns(Memory(s.data(), s.capacity())));
+            // allocated outside the nested scope, but freed in it
+            inside += " and then grown";
+        }
+        outside += " and grown inside the arena scope, well past the size of its old buffer";
+        REQUIRE(arena.owns(Memory(outside.data(), outside.capacity())));
+        outside = "short";
+        outside.shrink_to_fit();
+    }
+    REQUIRE(Context::get().allocator_depth() == 0);
+    REQUIRE(arena.bytes_reserved() > 0);
+    arena.free_all();
+    REQUIRE(outside == "short");
+}
+
+TEST_CASE("Context allocator stack", "[allocator]" ) {
+    StatsAllocator<Mallocator> stats;
+    String before("allocated from the base allocator before any scope was pushed");
+    {
+        AllocatorScope<StatsAllocator<Mallocator>> scope(stats);
+        REQUIRE(Context::get().allocator_depth() == 1);
+        String s("allocated from the stats allocator while its scope is pushed");
+        REQUIRE(stats.stats().find("allocs:                    1") != std::string::npos);
+
+        // another thread has its own context, with nothing pushed
+        Size other_depth = SizeMax;
+        std::thread thread([&other_depth] {
+            other_depth = Context::get().allocator_depth();
+            String t("allocated from the base allocator on another thread");
+        });
+        thread.join();
+        REQUIRE(other_depth == 0);
+        REQUIRE(Context::get().allocator_depth() == 1);
+    }
+    REQUIRE(stats.stats().find("deallocs:                  1") != std::string::npos);
+    REQUIRE(Context::get().allocator_depth() == 0);
+}
+
+TEST_CASE("Context frees and grows blocks from below the top of the stack", "[allocator]" ) {
+    String freed("allocated from the base allocator and freed while another allocator is pushed");
+    String grown("allocated from the base allocator and grown while another allocator is pushed");
+    SECTION("Mallocator") {
+        StatsAllocator<Mallocator> stats;
+        {
+            AllocatorScope<StatsAllocator<Mallocator>> scope(stats);
+            REQUIRE_FALSE(stats.owns(Memory(freed.data(), freed.capacity())));
+            freed = "short";
+            freed.shrink_to_fit();
+            grown += " by enough to need a bigger block, which comes from the pushed allocator";
+            REQUIRE(stats.owns(Memory(grown.data(), grown.capacity())));
+            REQUIRE(stats.stats().find("deallocs:                  0") != std::string::npos);
+            // blocks from the pushed allocator go back to it before the scope ends
+            grown = "short";
+            grown.shrink_to_fit();
+        }
+        REQUIRE(stats.stats().find("deallocs:                  1") != std::string::npos);
+    }
+    SECTION("GPAllocator") {
+        GPAllocator allocator;
+        {
+            AllocatorScope<GPAllocator> scope(allocator);
+            REQUIRE(base_allocator().owns(Memory(freed.data(), freed.capacity())));
+            REQUIRE_FALSE(allocator.owns(Memory(freed.data(), freed.capacity())));
+            freed = "short";
+            freed.shrink_to_fit();
+            grown += " by enough to need a bigger block, which comes from the pushed allocator";
+            REQUIRE(allocator.owns(Memory(grown.data(), grown.capacity())));
+            REQUIRE_FALSE(base_allocator().owns(Memory(grown.data(), grown.capacity())));
+            grown = "short";
+            grown.shrink_to_fit();
+        }
+        allocator.flush_thread_cache();
+    }
+    REQUIRE(freed == "short");
+    REQUIRE(grown == "short");
+}
+
+TEST_CASE("Context drops blocks freed after their allocator is popped", "[allocator]" ) {
+    // sized so they would land in the same base allocator size class as the ones made after
+    std::string text(100, 'x');
+    std::set<const void *> popped;
+    Mallocator mallocator;
+    ArenaAllocator arena;
+    std::optional<String> from_mallocator;
+    std::optional<String> from_arena;
+    {
+        AllocatorScope<Mallocator> scope(mallocator);
+        from_mallocator.emplace(text);
+    }
+    {
+        ArenaScope scope(arena);
+        from_arena.emplace(text);
+        REQUIRE(arena.owns(Memory(from_arena->data(), from_arena->capacity())));
+    }
+    popped.insert(from_mallocator->data());
+    popped.insert(from_arena->data());
+
+    // growing moves them to the base allocator, without handing their old blocks to it
+    *from_mallocator += text;
+    REQUIRE(base_allocator().owns(Memory(from_mallocator->data(), from_mallocator->capacity())));
+    from_arena.reset();
+
+    std::vector<String> strings;
+    for (int idx = 0; idx < 100; idx++) {
+        strings.emplace_back(text);
+        REQUIRE(popped.count(strings.back().data()) == 0);
+    }
+    REQUIRE(*from_mallocator == text + text);
+}
+
+TEST_CASE("Allocator ownership", "[allocator]" ) {
+    GPAllocator a;
+    GPAllocator b;
+    Mallocator mallocator;
+    MmapAllocator mmap;
+
+    Memory small = a.alloc(40);
+    Memory large = a.alloc(GPAllocator::MaxClassSize * 4);
+    Memory malloced = mallocator.alloc(40);
+    Memory mapped = mmap.alloc(100000);
+    REQUIRE(a.owns(small));
+    REQUIRE(a.owns(large));
+    REQUIRE_FALSE(b.owns(small));
+    REQUIRE_FALSE(b.owns(large));
+    REQUIRE_FALSE(a.owns(malloced));
+    REQUIRE_FALSE(a.owns(mapped));
+    REQUIRE(mallocator.owns(malloced));
+    REQUIRE_FALSE(mallocator.owns(small));
+    REQUIRE_FALSE(mallocator.owns(large));
+    REQUIRE_FALSE(mallocator.owns(mapped));
+    REQUIRE(mmap.owns(mapped));
+    REQUIRE_FALSE(mmap.owns(large));
+
+    // regions stay registered as they move, and stop being registered once unmapped
+    REQUIRE(a.reallocate(large, GPAllocator::MaxClassSize * 64));
+    REQUIRE(a.owns(large));
+    REQUIRE(a.owns(Memory(static_cast<Byte *>(large.ptr) + large.capacity - 1, 1)));
+    void *ptr = mapped.ptr;
+    REQUIRE(mmap.reallocate(mapped, 4096));
+    REQUIRE_FALSE(mmap.owns(Memory(static_cast<Byte *>(ptr) + 8192, 1)));
+    mmap.dealloc(mapped);
+    mmap.purge();
+    REQUIRE_FALSE(mmap.owns(Memory(ptr, 1)));
+
+    // blocks from beyond a full size class are registered too
+    std::vector<Memory> mems;
+    for (Size idx = 0; idx < 64 * gp_class_slots(4096) + 100; idx++) {
+        Memory mem = b.alloc(4096);
+        REQUIRE(mem.not_empty());
+        mems.push_back(mem);
+    }
+    for (auto &mem : mems) {
+        REQUIRE(b.owns(mem));
+        REQUIRE_FALSE(a.owns(mem));
+        REQUIRE_FALSE(mallocator.owns(mem));
+    }
+    for (auto &mem : mems) {
+        b.dealloc(mem);
+    }
+    // and once they are all freed, trim() gives their chunks back
+    b.trim();
+    REQUIRE_FALSE(b.owns(mems.back()));
+
+    a.dealloc(small);
+    a.dealloc(large);
+    a.flush_thread_cache();
+    mallocator.dealloc(malloced);
+}
+
+TEST_CASE("MmapAllocator", "[allocator]" ) {
+    MmapAllocator allocator;
+    Size page = MmapAllocator::page_size();
+
+    Memory m1 = allocator.alloc(100000);
+    REQUIRE(m1.capacity == MmapAllocator::round_up_to_page_size(100000));
+    REQUIRE(m1.capacity % page == 0);
+    memset(m1.ptr, 0xab, m1.capacity);
+    void *ptr = m1.ptr;
+    allocator.dealloc(m1);
+    REQUIRE(allocator.cached_bytes() == m1.capacity);
+
+    // a freed region is reused for the next request that fits in it
+    Memory m2 = allocator.alloc(99000);
+    REQUIRE(m2.ptr == ptr);
+    REQUIRE(m2.capacity == m1.capacity);
+    REQUIRE(allocator.cached_bytes() == 0);
+
+    // big regions start on a huge page boundary
+    Memory m3 = allocator.alloc(3 * MmapAllocator::HugePageSize);
+    REQUIRE(reinterpret_cast<uintptr_t>(m3.ptr) % MmapAllocator::HugePageSize == 0);
+    memset(m3.ptr, 0xcd, m3.capacity);
+
+    memcpy(m2.ptr, "large", 6);
+    REQUIRE(allocator.reallocate(m2, 10 * page * 64));
+    REQUIRE(strcmp(static_cast<char *>(m2.ptr), "large") == 0);
+    REQUIRE(allocator.reallocate(m2, page));
+    REQUIRE(m2.capacity == page);
+    REQUIRE(strcmp(static_cast<char *>(m2.ptr), "large") == 0);
+    m2.capacity = page / 2;
+    REQUIRE(allocator.expand(m2, 100));
+    REQUIRE(m2.capacity == page);
+
+    allocator.dealloc(m2);
+    allocator.dealloc(m3);
+    REQUIRE(allocator.cached_bytes() > 0);
+    allocator.purge();
+    REQUIRE(allocator.cached_bytes() == 0);
+
+    // regions too big for the cache are unmapped at once
+    MmapAllocator small_cache(page);
+    Memory m4 = small_cache.alloc(page * 2);
+    small_cache.dealloc(m4);
+    REQUIRE(small_cache.cached_bytes() == 0);
+}
+
+TEST_CASE("StatsAllocator snapshot", "[allocator]" ) {
+    StatsAllocator<Mallocator, 4> stats;
+    Memory m1 = stats.alloc(0);
+    Memory m2 = stats.alloc(100);
+    Memory m3 = stats.alloc(3000);
+    auto s = stats.snapshot();
+    REQUIRE(s.allocs == 3);
+    REQUIRE(s.outstanding_blocks() == 3);
+    REQUIRE(s.bytes_allocated_now == 3100);
+    REQUIRE(s.sizes[0] == 1);
+    REQUIRE(s.sizes[7] == 1);
+    REQUIRE(s.sizes[12] == 1);
+    REQUIRE(s.timed_allocs == 1);
+    stats.dealloc(m1);
+    stats.dealloc(m2);
+    stats.dealloc(m3);
+    s = stats.snapshot();
+    REQUIRE(s.deallocs == 3);
+    REQUIRE(s.bytes_allocated_now == 0);
+    REQUIRE(stats.stats().find("   64 - 127 : 1") != std::string::npos);
+}
+
+TEST_CASE("StatsAllocator threads", "[allocator]" ) {
+    StatsAllocator<GPAllocator> stats;
+    constexpr int ThreadCount = 8;
+    constexpr int Rounds = 10000;
+    std::atomic<bool> done = false;
+
+    // a reader takes snapshots while the other threads allocate
+    std::thread reader([&stats, &done] {
+        while (!done.load()) {
+            auto s = stats.snapshot();
+            (void)s;
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++) {
+        threads.emplace_back([&stats] {
+            std::vector<Memory> live;
+            for (int idx = 0; idx < Rounds; idx++) {
+                live.push_back(stats.alloc(16 + (idx % 64) * 1024));
+            }
+            for (auto &mem : live) {
+                stats.dealloc(mem);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    done = true;
+    reader.join();
+
+    auto s = stats.snapshot();
+    REQUIRE(s.allocs == ThreadCount * Rounds);
+    REQUIRE(s.deallocs == ThreadCount * Rounds);
+    REQUIRE(s.bytes_allocated_now == 0);
+    REQUIRE(s.bytes_allocated_highwater > 0);
+    REQUIRE(s.timed_allocs > 0);
+    REQUIRE(s.time_in_seconds.count() > 0);
+}
+
+TEST_CASE("expand and reallocate", "[allocator]" ) {
+    SECTION("StackAllocator") {
+        StackAllocator<1024> stack;
+        Memory m1 = stack.alloc(64);
+        Memory m2 = stack.alloc(64);
+        REQUIRE_FALSE(stack.expand(m1, 64));
+        REQUIRE(stack.expand(m2, 64));
+        REQUIRE(m2.capacity == 128);
+        void *ptr = m2.ptr;
+        REQUIRE(stack.reallocate(m2, 512));
+        REQUIRE(m2.ptr == ptr);
+        REQUIRE(m2.capacity == 512);
+        REQUIRE_FALSE(stack.expand(m2, 1024));
+    }
+    SECTION("ArenaAllocator") {
+        ArenaAllocator arena(4096);
+        Memory m1 = arena.alloc(100);
+        memset(m1.ptr, 'x', m1.capacity);
+        void *ptr = m1.ptr;
+        REQUIRE(arena.expand(m1, 100));
+        REQUIRE(arena.reallocate(m1, 1000));
+        REQUIRE(m1.ptr == ptr);
+        Memory m2 = arena.alloc(8);
+        REQUIRE(arena.reallocate(m1, 2000));
+        REQUIRE(m1.ptr != ptr);
+        REQUIRE(static_cast<char *>(m1.ptr)[99] == 'x');
+        arena.dealloc(m2);
+    }
+    SECTION("Mallocator") {
+        Mallocator mallocator;
+        Memory mem = mallocator.alloc(16);
+        memcpy(mem.ptr, "0123456789abcde", 16);
+        REQUIRE_FALSE(mallocator.expand(mem, 16));
+        REQUIRE(mallocator.reallocate(mem, 100000));
+        REQUIRE(mem.capacity == 100000);
+        REQUIRE(strcmp(static_cast<char *>(mem.ptr), "0123456789abcde") == 0);
+        mallocator.dealloc(mem);
+    }
+    SECTION("GPAllocator") {
+        GPAllocator allocator;
+        Memory mem = allocator.alloc(20);
+        REQUIRE(mem.capacity == 32);
+        void *ptr = mem.ptr;
+        REQUIRE_FALSE(allocator.expand(mem, 1));
+        mem.capacity = 20;
+        REQUIRE(allocator.expand(mem, 10));
+        REQUIRE(mem.capacity == 32);
+        REQUIRE(allocator.reallocate(mem, 24));
+        REQUIRE(mem.ptr == ptr);
+        memcpy(mem.ptr, "small", 6);
+        REQUIRE(allocator.reallocate(mem, 200));
+        REQUIRE(mem.capacity == 256);
+        REQUIRE(strcmp(static_cast<char *>(mem.ptr), "small") == 0);
+        REQUIRE(allocator.reallocate(mem, 5000));
+        REQUIRE(allocator.reallocate(mem, 50000));
+        REQUIRE(strcmp(static_cast<char *>(mem.ptr), "small") == 0);
+        allocator.dealloc(mem);
+    }
+    SECTION("StatsAllocator") {
+        StatsAllocator<Mallocator> stats;
+        Memory mem = stats.alloc(10);
+        REQUIRE(stats.reallocate(mem, 100));
+        REQUIRE(stats.stats().find("bytes allocated now:       100") != std::string::npos);
+        stats.dealloc(mem);
+    }
+}
+
+TEST_CASE("MemoryResourceAdapter", "[allocator]" ) {
+    StatsAllocator<GPAllocator> stats;
+    MemoryResourceAdapter<StatsAllocator<GPAllocator>> resource(stats);
+    {
+        std::pmr::vector<Size> offsets(&resource);
+        for (Size idx = 0; idx < 10000; idx++) {
+            offsets.push_back(idx);
+        }
+        std::pmr::string string("a string long enough to need a heap allocation", &resource);
+        std::pmr::map<int, std::pmr::string> map(&resource);
+        for (int idx = 0; idx < 100; idx++) {
+            map.emplace(idx, string);
+        }
+        REQUIRE(offsets[9999] == 9999);
+        REQUIRE(map[50] == string);
+        REQUIRE(stats.snapshot().allocs > 100);
+    }
+    auto s = stats.snapshot();
+    REQUIRE(s.allocs == s.deallocs);
+
+    // over-aligned requests go upstream
+    void *ptr = resource.allocate(64, 64);
+    REQUIRE(reinterpret_cast<uintptr_t>(ptr) % 64 == 0);
+    resource.deallocate(ptr, 64, 64);
+    REQUIRE(stats.snapshot().allocs == s.allocs);
+
+    MemoryResourceAdapter<StatsAllocator<GPAllocator>> same(stats);
+    REQUIRE(resource.is_equal(same));
+    REQUIRE_FALSE(resource.is_equal(*std::pmr::new_delete_resource()));
+    REQUIRE(base_memory_resource()->is_equal(*base_memory_resource()));
+}
+
+using ArenaString = BasicString<char, BasicStringDefaultInlineCapacity, std::char_traits<char>, AllocatorRef<ArenaAllocator>>;
+
+TEST_CASE("String allocator handles", "[allocator]" ) {
+    REQUIRE(sizeof(String) == sizeof(ArenaString) - sizeof(void *));
+
+    ArenaAllocator arena;
+    ArenaString astr("a string long enough to go to the arena, not the inline buffer", arena);
+    REQUIRE(astr.allocator().allocator() == &arena);
+    REQUIRE(arena.owns(Memory(astr.data(), astr.capacity())));
+    astr += " and one long enough to need to grow, which stays in the arena too";
+    REQUIRE(arena.owns(Memory(astr.data(), astr.capacity())));
+
+    // copies keep the allocator, and so do moves
+    ArenaString copy(astr);
+    REQUIRE(copy == astr);
+    REQUIRE(arena.owns(Memory(copy.data(), copy.capacity())));
+    ArenaString moved(std::move(copy));
+    REQUIRE(moved == astr);
+    REQUIRE(arena.owns(Memory(moved.data(), moved.capacity())));
+}
+
+TEST_CASE("String move assign across allocators", "[allocator]" ) {
+    ArenaAllocator arena1;
+    ArenaAllocator arena2;
+    ArenaString s1("a string long enough to go to the first arena's memory", arena1);
+    ArenaString s2("a string long enough to go to the second arena's memory", arena2);
+    ArenaString s3("another string long enough to go to the first arena's memory", arena1);
+
+    // different allocators: copy the characters and keep the allocator
+    s2 = std::move(s1);
+    REQUIRE(s2 == "a string long enough to go to the first arena's memory");
+    REQUIRE(arena2.owns(Memory(s2.data(), s2.capacity())));
+    REQUIRE(s1.is_using_inline_buffer());
+
+    // same allocator: take over the buffer
+    const char *ptr = s3.data();
+    ArenaString s4("yet another string long enough to go to the first arena", arena1);
+    s4 = std::move(s3);
+    REQUIRE(s4.data() == ptr);
+
+    // swap trades allocators along with buffers
+    s2.swap(s4);
+    REQUIRE(s2.data() == ptr);
+    REQUIRE(s2.allocator().allocator() == &arena1);
+    REQUIRE(s4.allocator().allocator() == &arena2);
+}
+
+TEST_CASE("String move assign frees with its own allocator", "[allocator]" ) {
+    String s1("a string long enough to need an allocated buffer of its own");
+    String s2("another string long enough to need an allocated buffer too");
+    const char *ptr = s2.data();
+    s1 = std::move(s2);
+    REQUIRE(s1.data() == ptr);
+    REQUIRE(s2.is_using_inline_buffer());
+}
+
+TEST_CASE("String grows in place when the allocator can", "[allocator]" ) {
+    ArenaAllocator arena;
+    ArenaString astr(arena);
+    astr.reserve(100);
+    const char *ptr = astr.data();
+    for (int idx = 0; idx < 1000; idx++) {
+        astr += "0123456789";
+    }
+    REQUIRE(astr.length() == 10000);
+    REQUIRE(astr.data() == ptr);
+    REQUIRE(astr.substr(9990) == "0123456789");
+}
+
+TEST_CASE("String32 buffer capacity", "[allocator]" ) {
+    BasicString<char32_t> ustr;
+    for (int idx = 0; idx < 200; idx++) {
+        ustr += U'x';
+    }
+    REQUIRE(ustr.length() == 200);
+    REQUIRE(ustr.capacity() > 200);
+    REQUIRE(ustr.capacity() * sizeof(char32_t) <= 2048);
+    ustr.shrink_to_fit();
+    REQUIRE(ustr.length() == 200);
+}
@@ -586,3 +586,128 @@ TEST_CASE("array erase range of nontrivial", "[array]" ) {
     }
 }
 
+
+TEST_CASE("array with allocator", "[array]" ) {
+    using Stats = StatsAllocator<Mallocator>;
+    Stats stats;
+    {
+        Array<int, 4, AllocatorRef<Stats>> a1(stats);
+        for (int i = 0; i < 100; i++) {
+            a1.push_back(i);
+        }
+        REQUIRE(a1.size() == 100);
+        for (int i = 0; i < 100; i++) {
+            REQUIRE(a1[i] == i);
+        }
+        REQUIRE(stats.snapshot().allocs == 1);
+        REQUIRE(stats.snapshot().reallocs > 0);
+
+        Array<int, 4, AllocatorRef<Stats>> a2(a1);
+        REQUIRE(a2.allocator() == a1.allocator());
+        REQUIRE(stats.snapshot().allocs == 2);
+    }
+    REQUIRE(stats.snapshot().outstanding_blocks() == 0);
+}
+
+TEST_CASE("array grows in place in an arena", "[array]" ) {
+    ArenaAllocator arena;
+    Array<NonTrivial, 0, AllocatorRef<ArenaAllocator>> a1(arena);
+    a1.push_back(NonTrivial(reinterpret_cast<void *>(0)));
+    const NonTrivial *first = a1.data();
+    for (int i = 1; i < 100; i++) {
+        a1.push_back(NonTrivial(reinterpret_cast<void *>(i)));
+    }
+    REQUIRE(a1.data() == first);
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(a1[i] == NonTrivial(reinterpret_cast<void *>(i)));
+    }
+}
+
+TEST_CASE("array move between allocators", "[array]" ) {
+    ArenaAllocator arena1;
+    ArenaAllocator arena2;
+    using Ref = AllocatorRef<ArenaAllocator>;
+
+    Array<int, 0, Ref> a1(arena1);
+    Array<int, 0, Ref> a2(arena2);
+    for (int i = 0; i < 10; i++) {
+        a1.push_back(i);
+    }
+
+    // different allocators, so the elements move but the buffer stays put
+    a2 = std::move(a1);
+    REQUIRE(a2.size() == 10);
+    REQUIRE(a2.allocator() == Ref(arena2));
+    REQUIRE(arena2.owns(Memory(a2.data(), a2.capacity_in_bytes())));
+
+    // same allocator, so the buffer is stolen
+    Array<int, 0, Ref> a3(arena2);
+    const int *data = a2.data();
+    a3 = std::move(a2);
+    REQUIRE(a3.data() == data);
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(a3[i] == i);
+    }
+
+    // swapping heap buffers swaps the allocators with them
+    Array<int, 0, Ref> a4(arena1);
+    a4.push_back(42);
+    a3.swap(a4);
+    REQUIRE(a3.allocator() == Ref(arena1));
+    REQUIRE(a4.allocator() == Ref(arena2));
+    REQUIRE(a3.size() == 1);
+    REQUIRE(a4.size() == 10);
+}
+
+TEST_CASE("small vector with allocator", "[array]" ) {
+    using Stats = StatsAllocator<Mallocator>;
+    Stats stats;
+    {
+        SmallVector<int, 4, AllocatorRef<Stats>> v1(stats);
+        for (int i = 0; i < 100; i++) {
+            v1.push_back(i);
+        }
+        SmallVector<NonTrivial, 4, AllocatorRef<Stats>> v2(stats);
+        for (int i = 0; i < 100; i++) {
+            v2.push_back(NonTrivial(reinterpret_cast<void *>(i)));
+        }
+        REQUIRE(stats.snapshot().allocs >= 2);
+        REQUIRE(stats.snapshot().reallocs > 0);
+
+        SmallVector<int, 4, AllocatorRef<Stats>> v3(std::move(v1));
+        REQUIRE(v3.size() == 100);
+        for (int i = 0; i < 100; i++) {
+            REQUIRE(v3[i] == i);
+            REQUIRE(v2[i] == NonTrivial(reinterpret_cast<void *>(i)));
+        }
+    }
+    REQUIRE(stats.snapshot().outstanding_blocks() == 0);
+    static_assert(sizeof(SmallVector<int, 4>) == sizeof(SmallVector<int, 4, ContextAllocatorRef>));
+}
+
+TEST_CASE("array of relocatable strings", "[array]" ) {
+    static_assert(IsTriviallyRelocatable<String>);
+    static_assert(!IsTriviallyRelocatable<NonTrivial>);
+
+    // a mix of inline and allocated strings, moved with memcpy as the array grows
+    Array<String, 2> a1;
+    for (int i = 0; i < 100; i++) {
+        a1.emplace_back(std::string(i % 3 == 0 ? 100 : 1, 'a' + i % 26));
+    }
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(a1[i] == String(std::string(i % 3 == 0 ? 100 : 1, 'a' + i % 26)));
+    }
+
+    a1.erase(a1.begin());
+    a1.erase(a1.begin() + 10, a1.begin() + 40);
+    REQUIRE(a1.size() == 69);
+    REQUIRE(a1[0] == String("b"));
+    REQUIRE(a1[8] == String(std::string(100, 'a' + 9)));
+    REQUIRE(a1[9] == String("k"));
+    REQUIRE(a1[10] == String("p"));
+    REQUIRE(a1[68] == String(std::string(100, 'a' + 99 % 26)));
+
+    // growing with an element of the array itself
+    a1.push_back(a1[0]);
+    REQUIRE(a1.back() == String("b"));
+}
@@ -0,0 +1,134 @@
+//
+// bit_block_test.cpp
+//
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+TEST_CASE("BitBlock take and clear", "[bit_block]" ) {
+    BitBlock<4> bits;
+    REQUIRE(bits.is_empty());
+    for (UInt32 idx = 0; idx < 256; idx++) {
+        REQUIRE(bits.take() == idx);
+    }
+    REQUIRE(bits.is_full());
+    bits.clear(130);
+    REQUIRE(bits.peek() == 130);
+    REQUIRE(bits.count() == 255);
+}
+
+TEST_CASE("HierarchicalBitBlock take and clear", "[bit_block]" ) {
+    HierarchicalBitBlock<64> bits;
+    REQUIRE(bits.size() == 4096);
+    REQUIRE(bits.is_empty());
+    for (UInt32 idx = 0; idx < 4096; idx++) {
+        REQUIRE(bits.take() == idx);
+    }
+    REQUIRE(bits.is_full());
+    REQUIRE(bits.count() == 4096);
+
+    bits.clear(3000);
+    bits.clear(70);
+    REQUIRE(bits.not_full());
+    REQUIRE(bits.peek() == 70);
+    REQUIRE(bits.take() == 70);
+    REQUIRE(bits.take() == 3000);
+    REQUIRE(bits.is_full());
+
+    // setting a set bit or clearing a clear one changes nothing
+    bits.set(5);
+    REQUIRE(bits.count() == 4096);
+    for (Size idx = 0; idx < 4096; idx++) {
+        bits.clear(idx);
+        bits.clear(idx);
+    }
+    REQUIRE(bits.is_empty());
+    REQUIRE(bits.peek() == 0);
+}
+
+TEST_CASE("HierarchicalBitBlock partial summary", "[bit_block]" ) {
+    // 100 sub-blocks need two summary words, the second only partly used
+    HierarchicalBitBlock<100> bits;
+    REQUIRE(bits.size() == 6400);
+    for (Size idx = 0; idx < 6400; idx++) {
+        bits.take();
+    }
+    REQUIRE(bits.is_full());
+    REQUIRE(bits.peek() == UInt32(-1));
+    bits.clear(6399);
+    REQUIRE(bits.peek() == 6399);
+    bits.reset();
+    REQUIRE(bits.is_empty());
+    bits.fill();
+    REQUIRE(bits.is_full());
+    REQUIRE(bits.test(6399));
+}
+
+TEST_CASE("AtomicBitBlock", "[bit_block]" ) {
+    AtomicBitBlock<2> bits;
+    REQUIRE(bits.size() == 128);
+    REQUIRE(bits.is_empty());
+    REQUIRE(bits.take(1) == 64);
+    REQUIRE(bits.take() == 0);
+    REQUIRE(bits.set(5));
+    REQUIRE_FALSE(bits.set(5));
+    REQUIRE(bits.count() == 3);
+    REQUIRE(bits.clear(64));
+    REQUIRE_FALSE(bits.clear(64));
+    bits.fill();
+    REQUIRE(bits.is_full());
+    REQUIRE(bits.take() == UInt32(-1));
+    bits.clear(100);
+    REQUIRE(bits.take() == 100);
+}
+
+TEST_CASE("AtomicBitBlock threads", "[bit_block]" ) {
+    // threads take every bit between them, and no bit goes to two threads
+    constexpr int ThreadCount = 8;
+    AtomicBitBlock<64> bits;
+    std::atomic<Size> taken[64 * 64] = {};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++) {
+        threads.emplace_back([&bits, &taken, t] {
+            while (true) {
+                UInt32 idx = bits.take(t * 8);
+                if (idx == UInt32(-1)) {
+                    break;
+                }
+                taken[idx]++;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(bits.is_full());
+    for (auto &count : taken) {
+        REQUIRE(count == 1);
+    }
+}
+
+TEST_CASE("MemoryBlock with many slots", "[bit_block]" ) {
+    auto block = std::make_unique<MemoryBlock<32, 4096>>();
+    std::vector<Memory> mems;
+    for (Size idx = 0; idx < 4096; idx++) {
+        mems.push_back(block->take());
+    }
+    REQUIRE(block->is_full());
+    block->put(mems[1234]);
+    Memory mem = block->take();
+    REQUIRE(mem.ptr == mems[1234].ptr);
+    for (auto &m : mems) {
+        block->put(m);
+    }
+    REQUIRE(block->is_empty());
+    block->release();
+}
@@ -0,0 +1,297 @@
+//
+// byte_search_test.cpp
+//
+
+#include <random>
+#include <string>
+#include <string_view>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+namespace {
+
+// the kernels' results as offsets, with npos for no match
+Size offset_of(const std::string &haystack, const char *match) 
+{
+    return match ? Size(match - haystack.data()) : std::string::npos;
+}
+
+// a haystack of a small alphabet, so needles match often, and sometimes only partially
+std::string random_haystack(std::mt19937 &rng, Size length) 
+{
+    std::uniform_int_distribution<int> dist('a', 'd');
+    std::string result;
+    for (Size idx = 0; idx < length; idx++) {
+        result += char(dist(rng));
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("find_byte and rfind_byte", "[byte_search]" ) {
+    std::mt19937 rng(42);
+    for (Size length = 0; length < 200; length++) {
+        std::string haystack(length, 'x');
+        for (Size pos = 0; pos < length; pos += 7) {
+            haystack[pos] = 'y';
+        }
+        const char *first = haystack.data();
+        const char *last = first + haystack.length();
+        for (char c : { 'x', 'y', 'z' }) {
+            REQUIRE(offset_of(haystack, find_byte(first, last, c)) == haystack.find(c));
+            REQUIRE(offset_of(haystack, rfind_byte(first, last, c)) == haystack.rfind(c));
+        }
+        for (Size pos = 0; pos < length; pos++) {
+            REQUIRE(offset_of(haystack, find_byte(first + pos, last, 'y')) == haystack.find('y', pos));
+            REQUIRE(offset_of(haystack, rfind_byte(first, first + pos + 1, 'y')) == haystack.rfind('y', pos));
+        }
+    }
+}
+
+TEST_CASE("find_substring and rfind_substring", "[byte_search]" ) {
+    std::mt19937 rng(42);
+    for (int round = 0; round < 500; round++) {
+        std::string haystack = random_haystack(rng, rng() % 300);
+        std::string needle = random_haystack(rng, 1 + rng() % 6);
+        const char *first = haystack.data();
+        const char *last = first + haystack.length();
+        REQUIRE(offset_of(haystack, find_substring(first, last, needle.data(), needle.length())) == haystack.find(needle));
+        REQUIRE(offset_of(haystack, rfind_substring(first, last, needle.data(), needle.length())) == haystack.rfind(needle));
+        for (Size pos = 0; pos < haystack.length(); pos += 13) {
+            REQUIRE(offset_of(haystack, find_substring(first + pos, last, needle.data(), needle.length())) == 
+                haystack.find(needle, pos));
+        }
+    }
+
+    std::string haystack(1000, 'a');
+    haystack.replace(900, 5, "needl");
+    haystack.replace(950, 6, "needle");
+    REQUIRE(offset_of(haystack, find_substring(haystack.data(), haystack.data() + 1000, "needle", 6)) == 950);
+    REQUIRE(find_substring(haystack.data(), haystack.data() + 955, "needle", 6) == nullptr);
+    REQUIRE(offset_of(haystack, rfind_substring(haystack.data(), haystack.data() + 1000, "needl", 5)) == 950);
+    REQUIRE(find_substring(haystack.data(), haystack.data() + 1000, "", 0) == haystack.data());
+}
+
+TEST_CASE("String find and rfind", "[byte_search]" ) {
+    std::mt19937 rng(7);
+    for (int round = 0; round < 200; round++) {
+        std::string sstr = random_haystack(rng, rng() % 200);
+        String ustr(sstr);
+        std::string needle = random_haystack(rng, 1 + rng() % 4);
+        Size pos = rng() % (sstr.length() + 2);
+        REQUIRE(ustr.find(needle, pos) == sstr.find(needle, pos));
+        REQUIRE(ustr.rfind(needle, pos) == sstr.rfind(needle, pos));
+        REQUIRE(ustr.find(needle[0], pos) == sstr.find(needle[0], pos));
+        REQUIRE(ustr.rfind(needle[0], pos) == sstr.rfind(needle[0], pos));
+        REQUIRE(ustr.rfind(needle) == sstr.rfind(needle));
+    }
+
+    // the scalar loops still serve constant evaluation
+    static_assert(String("abcabc").find("ca") == 2);
+    static_assert(String("abcabc").rfind('b') == 4);
+    static_assert(String("abcabc").rfind("bc") == 4);
+}
+
+TEST_CASE("ASCII case kernels", "[byte_search]" ) {
+    std::mt19937 rng(24);
+    auto scalar_lower = [](char c) { return c >= 'A' && c <= 'Z' ? char(c + 32) : c; };
+    auto scalar_upper = [](char c) { return c >= 'a' && c <= 'z' ? char(c - 32) : c; };
+    for (Size length = 0; length < 150; length++) {
+        // every byte value, so the edges of the letter ranges and bytes over 0x7f are covered
+        std::string str;
+        for (Size idx = 0; idx < length; idx++) {
+            str += char(rng() % 256);
+        }
+        std::string lower = str;
+        std::string upper = str;
+        to_lower_ascii(lower.data(), lower.data() + lower.length());
+        to_upper_ascii(upper.data(), upper.data() + upper.length());
+        for (Size idx = 0; idx < length; idx++) {
+            REQUIRE(lower[idx] == scalar_lower(str[idx]));
+            REQUIRE(upper[idx] == scalar_upper(str[idx]));
+        }
+        REQUIRE(compare_case_insensitive(lower.data(), upper.data(), length) == 0);
+        REQUIRE(compare_case_insensitive(str.data(), upper.data(), length) == 0);
+        if (length) {
+            Size idx = rng() % length;
+            std::string other = lower;
+            other[idx] = char(UInt8(other[idx]) ^ 0x80);
+            int expected = int(UInt8(scalar_lower(lower[idx]))) - int(UInt8(scalar_lower(other[idx])));
+            REQUIRE(compare_case_insensitive(upper.data(), other.data(), length) == expected);
+        }
+    }
+}
+
+TEST_CASE("find_substring_case_insensitive", "[byte_search]" ) {
+    std::mt19937 rng(4);
+    auto mixed_case = [&rng](std::string str) {
+        for (char &c : str) {
+            if (rng() % 2) {
+                c = char(c - 32);
+            }
+        }
+        return str;
+    };
+    for (int round = 0; round < 500; round++) {
+        std::string lower = random_haystack(rng, rng() % 300);
+        std::string haystack = mixed_case(lower);
+        std::string needle = random_haystack(rng, 1 + rng() % 6);
+        std::string mixed_needle = mixed_case(needle);
+        const char *first = haystack.data();
+        const char *last = first + haystack.length();
+        for (Size pos = 0; pos < haystack.length(); pos += 17) {
+            REQUIRE(offset_of(haystack, find_substring_case_insensitive(first + pos, last, mixed_needle.data(), 
+                mixed_needle.length())) == lower.find(needle, pos));
+        }
+    }
+    REQUIRE(find_substring_case_insensitive("a[b", "a[b" + 3, "A{B", 3) == nullptr);
+}
+
+TEST_CASE("String case", "[byte_search]" ) {
+    String str("Hello, Wörld! 123");
+    REQUIRE(String(str).to_lower() == "hello, wörld! 123");
+    REQUIRE(String(str).to_upper() == "HELLO, WöRLD! 123");
+    REQUIRE(str.compare_case_insensitive("hello, WÖRLD! 123") != 0);
+    REQUIRE(str.compare_case_insensitive("HELLO, wörld! 123") == 0);
+    REQUIRE(str.compare_case_insensitive("HELLO") > 0);
+    REQUIRE(str.compare_case_insensitive("hello, x") < 0);
+    REQUIRE(str.find_case_insensitive("WÖR") == String::npos);
+    REQUIRE(str.find_case_insensitive("wör") == 7);
+    REQUIRE(str.find_case_insensitive("L", 4) == 11);
+    REQUIRE(str.find_case_insensitive("") == 0);
+
+    BasicString<char32_t> runes(U"Straße");
+    REQUIRE(runes.to_upper() == U"STRAßE");
+    REQUIRE(runes.compare_case_insensitive(U"strasse") > 0);
+    REQUIRE(runes.find_case_insensitive(U"ssE") == BasicString<char32_t>::npos);
+    REQUIRE(runes.find_case_insensitive(U"aß") == 3);
+
+    static_assert(String("MiXeD").to_lower() == "mixed");
+    static_assert(String("abcABC").find_case_insensitive("Ca") == 2);
+    static_assert(String("abc").compare_case_insensitive("ABD") < 0);
+}
+
+TEST_CASE("ByteSet kernels", "[byte_search]" ) {
+    std::mt19937 rng(25);
+    for (Size set_size : { 0, 1, 2, 3, 4, 5, 8, 9, 30, 128, 255, 256 }) {
+        // sets from anywhere in the byte range, so both halves of the shuffle tables are used
+        std::vector<bool> in(256, false);
+        ByteSet set;
+        while (set.size() < set_size) {
+            UInt8 b = UInt8(rng() % 256);
+            set.add(char(b));
+            in[b] = true;
+        }
+        REQUIRE(set.listed().length() == (set_size <= ByteSet::ListCapacity ? set_size : 0));
+        for (int round = 0; round < 40; round++) {
+            std::string haystack;
+            Size length = rng() % 100;
+            for (Size idx = 0; idx < length; idx++) {
+                // mostly bytes of one kind, so both the in and not-in searches have to look a while
+                bool want = rng() % 8 == 0 ? round % 2 : !(round % 2);
+                UInt8 b = UInt8(rng() % 256);
+                for (int tries = 0; tries < 512 && in[b] != want; tries++) {
+                    b = UInt8(rng() % 256);
+                }
+                haystack += char(b);
+            }
+            auto expected = [&](bool member, bool forward) {
+                for (Size idx = 0; idx < length; idx++) {
+                    Size at = forward ? idx : length - 1 - idx;
+                    if (in[UInt8(haystack[at])] == member) {
+                        return at;
+                    }
+                }
+                return std::string::npos;
+            };
+            const char *first = haystack.data();
+            const char *last = first + length;
+            REQUIRE(offset_of(haystack, find_first_in(first, last, set)) == expected(true, true));
+            REQUIRE(offset_of(haystack, find_first_not_in(first, last, set)) == expected(false, true));
+            REQUIRE(offset_of(haystack, find_last_in(first, last, set)) == expected(true, false));
+            REQUIRE(offset_of(haystack, find_last_not_in(first, last, set)) == expected(false, false));
+        }
+    }
+}
+
+TEST_CASE("String find_first_of and friends", "[byte_search]" ) {
+    std::mt19937 rng(8);
+    for (int round = 0; round < 300; round++) {
+        std::string sstr = random_haystack(rng, rng() % 100);
+        String ustr(sstr);
+        std::string chars = random_haystack(rng, rng() % 4);
+        Size pos = rng() % (sstr.length() + 2);
+        std::string_view cv(chars);
+        REQUIRE(ustr.find_first_of(cv, pos) == sstr.find_first_of(chars, pos));
+        REQUIRE(ustr.find_first_not_of(cv, pos) == sstr.find_first_not_of(chars, pos));
+        REQUIRE(ustr.find_last_of(cv, pos) == sstr.find_last_of(chars, pos));
+        if (sstr.length()) {
+            REQUIRE(ustr.find_last_not_of(cv, pos) == sstr.find_last_not_of(chars, pos));
+        }
+        ByteSet set(chars);
+        REQUIRE(ustr.find_first_of(set, pos) == sstr.find_first_of(chars, pos));
+        REQUIRE(ustr.find_first_not_of(set, pos) == sstr.find_first_not_of(chars, pos));
+        REQUIRE(ustr.find_last_of(set, pos) == sstr.find_last_of(chars, pos));
+        REQUIRE(ustr.find_last_not_of(set, pos) == sstr.find_last_not_of(chars, pos));
+    }
+
+    static constexpr ByteSet Digits("0123456789");
+    static_assert(Digits.contains('7'));
+    static_assert(!Digits.contains('a'));
+    static_assert(String("abc123def").find_first_of(Digits) == 3);
+    static_assert(String("abc123def").find_last_of(Digits) == 5);
+    static_assert(String("abc123def").find_first_not_of(Digits, 3) == 6);
+    static_assert(String("abc123def").find_last_not_of(Digits, 5) == 2);
+}
+
+TEST_CASE("StringLike find_first_of and friends", "[byte_search]" ) {
+    std::mt19937 rng(16);
+    for (int round = 0; round < 300; round++) {
+        std::string sstr = random_haystack(rng, rng() % 200);
+        std::string_view view(sstr);
+        std::string chars = random_haystack(rng, rng() % 4);
+        Size pos = rng() % (sstr.length() + 2);
+        ByteSet set(chars);
+        REQUIRE(find_first_of(view, set, pos) == view.find_first_of(chars, pos));
+        REQUIRE(find_first_not_of(view, set, pos) == view.find_first_not_of(chars, pos));
+        REQUIRE(find_last_of(view, set, pos) == view.find_last_of(chars, pos));
+        REQUIRE(find_last_not_of(view, set, pos) == view.find_last_not_of(chars, pos));
+        REQUIRE(find_last_of(view, set) == view.find_last_of(chars));
+    }
+}
+
+TEST_CASE("find_line_end_offsets", "[byte_search]" ) {
+    // lines of many lengths, so line ends, and CRLF pairs, fall across vector boundaries
+    std::mt19937 rng(17);
+    for (int round = 0; round < 300; round++) {
+        std::string text;
+        Size length = rng() % 400;
+        while (text.length() < length) {
+            switch (rng() % 40) {
+                case 0: text += '\n'; break;
+                case 1: text += '\r'; break;
+                case 2: text += "\r\n"; break;
+                default: text += char('a' + rng() % 26); break;
+            }
+        }
+        std::vector<Size> expected;
+        for (Size idx = 0; idx < text.length(); idx++) {
+            if (text[idx] == '\r') {
+                expected.push_back(idx);
+                if (idx + 1 < text.length() && text[idx + 1] == '\n') {
+                    idx++;
+                }
+            }
+            else if (text[idx] == '\n') {
+                expected.push_back(idx);
+            }
+        }
+        expected.push_back(text.length());
+        REQUIRE(find_line_end_offsets(text) == expected);
+    }
+}
@@ -0,0 +1,58 @@
+//
+// case_fold_test.cpp
+//
+
+#include <string>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+TEST_CASE("fold_case runes", "[case_fold]" ) {
+    REQUIRE(fold_case(U'A') == U'a');
+    REQUIRE(fold_case(U'z') == U'z');
+    REQUIRE(fold_case(U'@') == U'@');
+    REQUIRE(fold_case(U'Ö') == U'ö');
+    REQUIRE(fold_case(U'Ā') == U'ā');
+    REQUIRE(fold_case(U'ā') == U'ā');
+    REQUIRE(fold_case(U'Σ') == U'σ');
+    REQUIRE(fold_case(U'ς') == U'σ');
+    REQUIRE(fold_case(U'Ж') == U'ж');
+    REQUIRE(fold_case(U'ſ') == U's');
+    REQUIRE(fold_case(U'K') == U'k');
+    REQUIRE(fold_case(U'ẞ') == U'ß');
+    REQUIRE(fold_case(U'ß') == U'ß');
+    REQUIRE(fold_case(U'\U00010400') == U'\U00010428');
+    REQUIRE(fold_case(U'中') == U'中');
+    REQUIRE(fold_case(std::string_view("ΣΊΣΥΦΟΣ")) == U"σίσυφοσ");
+}
+
+TEST_CASE("compare_case_insensitive_utf8", "[case_fold]" ) {
+    REQUIRE(compare_case_insensitive_utf8("Straße", "STRAẞE") == 0);
+    REQUIRE(compare_case_insensitive_utf8("ΟΔΥΣΣΕΥΣ", "οδυσσευς") == 0);
+    REQUIRE(compare_case_insensitive_utf8("abc", "ABD") < 0);
+    REQUIRE(compare_case_insensitive_utf8("abcd", "ABC") > 0);
+    REQUIRE(compare_case_insensitive_utf8("", "") == 0);
+    REQUIRE(compare_case_insensitive_utf8("Ω", "ω") == 0);
+}
+
+TEST_CASE("find_case_insensitive_utf8", "[case_fold]" ) {
+    std::string haystack = "Das Straße und die STRAẞE, Kelvin Kelvin and the ſun";
+    Size length = 0;
+    REQUIRE(find_case_insensitive_utf8(haystack, "straße", 0, &length) == 4);
+    REQUIRE(length == 7);
+    Size second = find_case_insensitive_utf8(haystack, "straße", 5, &length);
+    REQUIRE(second == haystack.find("STRAẞE"));
+    REQUIRE(length == std::string("STRAẞE").length());
+    REQUIRE(find_case_insensitive_utf8(haystack, "KELVIN", 0) == haystack.find("Kelvin"));
+    Size kelvin = find_case_insensitive_utf8(haystack, "kelvin", haystack.find("Kelvin") + 1, &length);
+    REQUIRE(kelvin == haystack.find("Kelvin"));
+    REQUIRE(length == 8);
+    REQUIRE(find_case_insensitive_utf8(haystack, "SUN", 0, &length) == haystack.find("ſun"));
+    REQUIRE(length == 4);
+    REQUIRE(find_case_insensitive_utf8(haystack, "strasse") == SizeMax);
+    REQUIRE(find_case_insensitive_utf8(haystack, "", 3) == 3);
+    REQUIRE(find_case_insensitive_utf8("ab", "abc") == SizeMax);
+}
@@ -0,0 +1,86 @@
+//
+// concurrent_append_vector_test.cpp
+//
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+TEST_CASE("ConcurrentAppendVector push and index", "[concurrent_append_vector]" ) {
+    ConcurrentAppendVector<int, 4> v;
+    REQUIRE(v.is_empty());
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE(v.push_back(i) == Size(i));
+    }
+    REQUIRE(v.size() == 1000);
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE(v[i] == i);
+    }
+
+    // segments of 4, 8, 16, ... elements, in order
+    Size expected_count = 4;
+    Size total = 0;
+    v.for_each_segment([&](int *first, Size count) {
+        REQUIRE(first[0] == int(total));
+        REQUIRE((count == expected_count || total + count == 1000));
+        total += count;
+        expected_count *= 2;
+    });
+    REQUIRE(total == 1000);
+
+    Array<int, 0> a = v.take_array();
+    REQUIRE(v.is_empty());
+    REQUIRE(a.size() == 1000);
+    REQUIRE(a[999] == 999);
+}
+
+TEST_CASE("ConcurrentAppendVector threads", "[concurrent_append_vector]" ) {
+    constexpr int ThreadCount = 8;
+    constexpr int PerThread = 20000;
+    ConcurrentAppendVector<std::string> v;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++) {
+        threads.emplace_back([&v, t] {
+            for (int idx = 0; idx < PerThread; idx++) {
+                v.emplace_back(std::to_string(t * PerThread + idx));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(v.size() == ThreadCount * PerThread);
+
+    // every value shows up exactly once
+    Array<const std::string *, 0> sorted = v.sorted_view([](const std::string &a, const std::string &b) {
+        return std::stoi(a) < std::stoi(b);
+    });
+    REQUIRE(sorted.size() == ThreadCount * PerThread);
+    for (int idx = 0; idx < ThreadCount * PerThread; idx++) {
+        REQUIRE(*sorted[idx] == std::to_string(idx));
+    }
+}
+
+TEST_CASE("ConcurrentAppendVector text refs from a thread pool", "[concurrent_append_vector]" ) {
+    ConcurrentAppendVector<TextRef> refs;
+    refs.reserve(1000);
+    ThreadPool pool(4);
+    pool.parallel_for(0, 1000, [&refs](Size idx) {
+        refs.emplace_back(TextRef::Invalid, "file.txt", idx + 1, Spread<size_t>(1, 4), "line");
+    });
+    REQUIRE(refs.size() == 1000);
+
+    Array<TextRef, 0> array = refs.take_array();
+    std::sort(array.begin(), array.end(), [](const TextRef &a, const TextRef &b) { return a.line() < b.line(); });
+    for (Size idx = 0; idx < array.size(); idx++) {
+        REQUIRE(array[idx].line() == idx + 1);
+    }
+}
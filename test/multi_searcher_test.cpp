@@ -0,0 +1,179 @@
+//
+// multi_searcher_test.cpp
+//
+
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace fs = std::filesystem;
+
+using namespace UU;
+
+// ================================================================================================
+// helpers
+
+// every occurrence of every pattern, sorted by offset, then pattern, the slow way
+static std::vector<MultiMatch> expected_matches(const std::string &haystack, const std::vector<std::string> &patterns) {
+    std::vector<MultiMatch> result;
+    for (Size pos = 0; pos < haystack.length(); pos++) {
+        for (Size id = 0; id < patterns.size(); id++) {
+            const std::string &pattern = patterns[id];
+            if (pattern.length() && haystack.compare(pos, pattern.length(), pattern) == 0) {
+                result.push_back(MultiMatch { id, pos, pattern.length() });
+            }
+        }
+    }
+    return result;
+}
+
+static std::vector<MultiMatch> to_vector(const Array<MultiMatch, 0> &a) {
+    return std::vector<MultiMatch>(a.begin(), a.end());
+}
+
+// ================================================================================================
+
+TEST_CASE("MultiSearcher strategies", "[multi_searcher]" ) {
+    REQUIRE(MultiSearcher(std::vector<std::string_view>()).strategy() == MultiSearcher::Strategy::Empty);
+    REQUIRE(MultiSearcher({ "", "" }).strategy() == MultiSearcher::Strategy::Empty);
+    REQUIRE(MultiSearcher({ "", "" }).find_all("abc").is_empty());
+    REQUIRE(MultiSearcher({ "a", "bc" }).strategy() != MultiSearcher::Strategy::Empty);
+
+    std::vector<std::string> many;
+    for (Size idx = 0; idx <= MultiSearcher::PackedMaxPatterns; idx++) {
+        many.push_back("symbol_" + std::to_string(idx));
+    }
+    MultiSearcher searcher(many);
+    REQUIRE(searcher.strategy() == MultiSearcher::Strategy::Automaton);
+    REQUIRE(searcher.pattern_count() == many.size());
+    REQUIRE(searcher.pattern(3) == "symbol_3");
+}
+
+TEST_CASE("MultiSearcher overlapping and duplicate patterns", "[multi_searcher]" ) {
+    std::vector<std::string> patterns = { "he", "she", "his", "hers", "", "he" };
+    MultiSearcher searcher(patterns);
+    Array<MultiMatch, 0> matches = searcher.find_all("ushers");
+    REQUIRE(to_vector(matches) == std::vector<MultiMatch>({ 
+        { 1, 1, 3 }, { 0, 2, 2 }, { 3, 2, 4 }, { 5, 2, 2 } 
+    }));
+    REQUIRE(to_vector(matches) == expected_matches("ushers", patterns));
+}
+
+TEST_CASE("MultiSearcher find_all", "[multi_searcher]" ) {
+    std::mt19937 rng(23);
+    std::uniform_int_distribution<int> dist('a', 'h');
+    auto random_string = [&](Size length) {
+        std::string s;
+        for (Size idx = 0; idx < length; idx++) {
+            s += char(dist(rng));
+        }
+        return s;
+    };
+
+    for (int round = 0; round < 200; round++) {
+        std::string haystack = random_string(rng() % 1500);
+        // small sets use the packed filter where it's available, and large ones the automaton
+        Size count = round % 2 ? 1 + rng() % 8 : 40 + rng() % 200;
+        std::vector<std::string> patterns;
+        for (Size idx = 0; idx < count; idx++) {
+            Size length = 1 + rng() % 6;
+            if (haystack.length() > length && rng() % 2) {
+                patterns.push_back(haystack.substr(rng() % (haystack.length() - length), length));
+            }
+            else {
+                patterns.push_back(random_string(length));
+            }
+        }
+        MultiSearcher searcher(patterns);
+        REQUIRE(to_vector(searcher.find_all(haystack)) == expected_matches(haystack, patterns));
+    }
+}
+
+TEST_CASE("MultiSearcher scan stops early", "[multi_searcher]" ) {
+    for (Size count : { Size(2), MultiSearcher::PackedMaxPatterns + 1 }) {
+        std::vector<std::string> patterns = { "needle", "pin" };
+        while (patterns.size() < count) {
+            patterns.push_back("unused" + std::to_string(patterns.size()));
+        }
+        MultiSearcher searcher(patterns);
+        std::string haystack;
+        for (int idx = 0; idx < 100; idx++) {
+            haystack += "a needle and a pin in some hay ";
+        }
+        Size visited = searcher.scan(haystack, [](const MultiMatch &) { return true; });
+        REQUIRE(visited == 200);
+        Size seen = 0;
+        visited = searcher.scan(haystack, [&seen](const MultiMatch &) { return ++seen < 3; });
+        REQUIRE(visited == 3);
+    }
+}
+
+TEST_CASE("MultiSearcher text_refs", "[multi_searcher]" ) {
+    MultiSearcher searcher({ "foo", "bar" });
+    std::string contents = "foo one\nnothing\r\n  bar and foo\nbar";
+    Array<MultiMatch, 0> matches = searcher.find_all(contents);
+    REQUIRE(matches.size() == 4);
+    std::vector<TextRef> refs = searcher.text_refs("file.txt", contents, matches);
+    REQUIRE(refs.size() == 4);
+
+    REQUIRE(refs[0].index() == 0);
+    REQUIRE(refs[0].line() == 1);
+    REQUIRE(refs[0].column() == 1);
+    REQUIRE(refs[0].message() == "foo one");
+
+    REQUIRE(refs[1].index() == 1);
+    REQUIRE(refs[1].line() == 3);
+    REQUIRE(refs[1].column() == 3);
+    REQUIRE(refs[1].message() == "  bar and foo");
+
+    REQUIRE(refs[2].index() == 0);
+    REQUIRE(refs[2].line() == 3);
+    REQUIRE(refs[2].column() == 11);
+
+    REQUIRE(refs[3].index() == 1);
+    REQUIRE(refs[3].line() == 4);
+    REQUIRE(refs[3].column() == 1);
+    REQUIRE(refs[3].message() == "bar");
+    REQUIRE(refs[3].filename() == "file.txt");
+}
+
+TEST_CASE("MultiSearcher hundreds of symbols in a mapped file", "[multi_searcher]" ) {
+    std::vector<std::string> symbols;
+    for (int idx = 0; idx < 500; idx++) {
+        symbols.push_back("sym" + std::to_string(idx * 7919 % 100000) + "_");
+    }
+    std::string contents;
+    for (int idx = 0; idx < 2000; idx++) {
+        contents += "call(" + symbols[idx % symbols.size()] + ", other_thing);\n";
+    }
+    fs::path path = fs::temp_directory_path() / "uu_multi_searcher_test.txt";
+    write_file(path, contents);
+    MappedFile file(path);
+    REQUIRE(file.is_valid());
+
+    // one searcher shared by every thread
+    const MultiSearcher searcher(symbols);
+    REQUIRE(searcher.strategy() == MultiSearcher::Strategy::Automaton);
+    std::vector<std::vector<MultiMatch>> results(4);
+    std::vector<std::thread> threads;
+    for (Size t = 0; t < results.size(); t++) {
+        threads.emplace_back([&searcher, &file, &results, t] {
+            results[t] = to_vector(searcher.find_all(file));
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::vector<MultiMatch> expected = expected_matches(contents, symbols);
+    REQUIRE(expected.size() >= 2000);
+    for (const auto &result : results) {
+        REQUIRE(result == expected);
+    }
+}
@@ -0,0 +1,98 @@
+//
+// object_pool_test.cpp
+//
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+namespace {
+
+struct Counted {
+    Counted(int v) : value(v) { live++; }
+    ~Counted() { live--; }
+    int value;
+    std::string name = "counted";
+    static inline int live = 0;
+};
+
+struct alignas(32) Wide {
+    double values[5];
+};
+
+}  // namespace
+
+TEST_CASE("ObjectPool create and destroy", "[object_pool]" ) {
+    auto pool = std::make_unique<ObjectPool<Counted, 64, 8>>();
+    std::vector<Counted *> objects;
+    std::set<Counted *> ptrs;
+    for (int idx = 0; idx < 200; idx++) {
+        Counted *obj = pool->create(idx);
+        REQUIRE(obj != nullptr);
+        REQUIRE(pool->owns(obj));
+        objects.push_back(obj);
+        ptrs.insert(obj);
+    }
+    REQUIRE(ptrs.size() == 200);
+    REQUIRE(pool->count() == 200);
+    REQUIRE(Counted::live == 200);
+    for (int idx = 0; idx < 200; idx++) {
+        REQUIRE(objects[idx]->value == idx);
+    }
+
+    pool->destroy(objects[100]);
+    REQUIRE(Counted::live == 199);
+    REQUIRE(pool->count() == 199);
+    Counted *obj = pool->create(1000);
+    REQUIRE(obj->value == 1000);
+
+    Counted other(0);
+    REQUIRE_FALSE(pool->owns(&other));
+
+    pool->clear();
+    REQUIRE(Counted::live == 1);
+    REQUIRE(pool->count() == 0);
+}
+
+TEST_CASE("ObjectPool full", "[object_pool]" ) {
+    auto pool = std::make_unique<ObjectPool<int, 64, 2>>();
+    std::vector<int *> objects;
+    for (int idx = 0; idx < 128; idx++) {
+        objects.push_back(pool->create(idx));
+        REQUIRE(objects.back() != nullptr);
+    }
+    REQUIRE(pool->create(0) == nullptr);
+
+    // a freed slot is reused
+    pool->destroy(objects[5]);
+    REQUIRE(pool->create(0) == objects[5]);
+}
+
+TEST_CASE("ObjectPool unique_ptr", "[object_pool]" ) {
+    auto pool = std::make_unique<ObjectPool<Counted, 64, 8>>();
+    {
+        auto obj = pool->make_unique(7);
+        REQUIRE(obj->value == 7);
+        REQUIRE(Counted::live == 1);
+        ObjectPool<Counted, 64, 8>::UniquePtr moved = std::move(obj);
+        REQUIRE(pool->count() == 1);
+    }
+    REQUIRE(Counted::live == 0);
+    REQUIRE(pool->count() == 0);
+}
+
+TEST_CASE("ObjectPool alignment", "[object_pool]" ) {
+    auto pool = std::make_unique<ObjectPool<Wide, 64, 4>>();
+    REQUIRE(ObjectPool<Wide, 64, 4>::SlotSize == 64);
+    for (int idx = 0; idx < 100; idx++) {
+        Wide *obj = pool->create();
+        REQUIRE(reinterpret_cast<uintptr_t>(obj) % 32 == 0);
+    }
+}
@@ -0,0 +1,121 @@
+//
+// search_test.cpp
+//
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <stdlib.h>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace fs = std::filesystem;
+
+using namespace UU;
+
+// ================================================================================================
+// helpers
+
+// a private copy of the search tree in its own temp directory, removed when the test case ends
+struct SearchTree {
+    SearchTree() {
+        std::string pattern = (fs::temp_directory_path() / "uu_search_test.XXXXXX").string();
+        REQUIRE(mkdtemp(pattern.data()) != nullptr);
+        root = pattern;
+        fs::create_directories(root / "sub");
+        write_file(root / "a.txt", "foo bar\nbaz foo foo\nnothing here\n");
+        write_file(root / "b.txt", "no match\r\nstill none\r\n");
+        write_file(root / "sub" / "c.txt", "first line\nsecond foo line");
+        write_file(root / "empty.txt", "");
+    }
+
+    ~SearchTree() {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    SearchTree(const SearchTree &) = delete;
+    SearchTree &operator=(const SearchTree &) = delete;
+
+    fs::path root;
+};
+
+static std::vector<TextRef> sorted_results(const Search &search, const fs::path &root) {
+    std::vector<TextRef> results;
+    search.run({ root }, [&results](const TextRef &ref) { results.push_back(ref); });
+    std::sort(results.begin(), results.end(), std::less<TextRef>());
+    return results;
+}
+
+// ================================================================================================
+
+TEST_CASE("search refs", "[search]" ) {
+    SearchTree tree;
+    const fs::path &root = tree.root;
+    Search search("foo");
+    std::vector<TextRef> results = sorted_results(search, root);
+    REQUIRE(results.size() == 3);
+    REQUIRE(fs::path(results[0].filename()).filename() == "a.txt");
+    REQUIRE(results[0].line() == 1);
+    REQUIRE(results[0].column() == 1);
+    REQUIRE(results[0].message() == "foo bar");
+    REQUIRE(results[1].line() == 2);
+    REQUIRE(results[1].spread() == Spread<size_t>(Spread<size_t>::StretchVector({ {5, 8}, {9, 12} })));
+    REQUIRE(fs::path(results[2].filename()).filename() == "c.txt");
+    REQUIRE(results[2].line() == 2);
+    REQUIRE(results[2].column() == 8);
+    REQUIRE(results[2].message() == "second foo line");
+}
+
+TEST_CASE("search count", "[search]" ) {
+    SearchTree tree;
+    const fs::path &root = tree.root;
+    Search search("foo", Search::Mode::Count);
+    std::vector<TextRef> results = sorted_results(search, root);
+    REQUIRE(results.size() == 2);
+    REQUIRE(results[0].message() == "3");
+    REQUIRE(results[1].message() == "1");
+}
+
+TEST_CASE("search files with matches", "[search]" ) {
+    SearchTree tree;
+    const fs::path &root = tree.root;
+    Search search("none", Search::Mode::FilesWithMatches);
+    std::vector<TextRef> results = sorted_results(search, root);
+    REQUIRE(results.size() == 1);
+    REQUIRE(fs::path(results[0].filename()).filename() == "b.txt");
+    REQUIRE(results[0].has_line<false>());
+}
+
+TEST_CASE("search limit and concurrency", "[search]" ) {
+    SearchTree tree;
+    const fs::path &root = tree.root;
+    Search search("o");
+    search.set_concurrency(4);
+    search.set_limit(2);
+    Size count = search.run({ root }, [](const TextRef &) {});
+    REQUIRE(count == 2);
+}
+
+TEST_CASE("search scan", "[search]" ) {
+    Search search("ab");
+    std::vector<Size> offsets;
+    Size count = search.scan("abcabab", [&offsets](Size offset) { offsets.push_back(offset); return true; });
+    REQUIRE(count == 3);
+    REQUIRE(offsets == std::vector<Size>({ 0, 3, 5 }));
+}
+
+TEST_CASE("search case insensitive", "[search]" ) {
+    SearchTree tree;
+    const fs::path &root = tree.root;
+    Search search("FOO", Search::Mode::Count, Search::CaseInsensitive);
+    std::vector<TextRef> results = sorted_results(search, root);
+    REQUIRE(results.size() == 2);
+    REQUIRE(results[0].message() == "3");
+    REQUIRE(results[1].message() == "1");
+    REQUIRE(Search("FOO").run({ root }, [](const TextRef &) {}) == 0);
+}
@@ -0,0 +1,143 @@
+//
+// searcher_test.cpp
+//
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace fs = std::filesystem;
+
+using namespace UU;
+
+// ================================================================================================
+// helpers
+
+// non-overlapping matches, left to right, the slow way
+static std::vector<Size> expected_matches(const std::string &haystack, const std::string &needle) {
+    std::vector<Size> result;
+    Size pos = haystack.find(needle);
+    while (pos != std::string::npos) {
+        result.push_back(pos);
+        pos = haystack.find(needle, pos + std::max(needle.length(), Size(1)));
+    }
+    return result;
+}
+
+static std::vector<Size> to_vector(const Array<Size, 0> &a) {
+    return std::vector<Size>(a.begin(), a.end());
+}
+
+// ================================================================================================
+
+TEST_CASE("Searcher strategies", "[searcher]" ) {
+    REQUIRE(Searcher("").strategy() == Searcher::Strategy::Empty);
+    REQUIRE(Searcher("x").strategy() == Searcher::Strategy::Byte);
+    REQUIRE(Searcher("xy").strategy() == Searcher::Strategy::Filter);
+    REQUIRE(Searcher("a needle that is long enough for Horspool").strategy() == Searcher::Strategy::Horspool);
+    REQUIRE(Searcher(std::string(100, 'a')).strategy() == Searcher::Strategy::Filter);
+}
+
+TEST_CASE("Searcher find and find_all", "[searcher]" ) {
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> dist('a', 'p');
+    auto random_string = [&](Size length) {
+        std::string s;
+        for (Size idx = 0; idx < length; idx++) {
+            s += char(dist(rng));
+        }
+        return s;
+    };
+
+    for (int round = 0; round < 300; round++) {
+        std::string haystack = random_string(rng() % 2000);
+        std::string needle;
+        if (haystack.length() > 40 && round % 2 == 0) {
+            // a needle taken from the haystack, so there is at least one match
+            Size length = 1 + rng() % 40;
+            needle = haystack.substr(rng() % (haystack.length() - length), length);
+        }
+        else {
+            needle = random_string(1 + rng() % 3);
+        }
+        Searcher searcher(needle);
+        REQUIRE(searcher.find(haystack) == haystack.find(needle));
+        REQUIRE(searcher.find(haystack, haystack.length() / 2) == haystack.find(needle, haystack.length() / 2));
+        REQUIRE(to_vector(searcher.find_all(haystack)) == expected_matches(haystack, needle));
+    }
+}
+
+TEST_CASE("Searcher matches", "[searcher]" ) {
+    Searcher searcher("ab");
+    String haystack("abcabab");
+    std::vector<Size> offsets;
+    for (Size offset : searcher.matches(haystack)) {
+        offsets.push_back(offset);
+    }
+    REQUIRE(offsets == std::vector<Size>({ 0, 3, 5 }));
+    REQUIRE(searcher.find(haystack, 6) == Searcher::npos);
+    REQUIRE(searcher.find(haystack, 8) == Searcher::npos);
+
+    Searcher empty("");
+    REQUIRE(empty.find(haystack, 3) == 3);
+    REQUIRE(empty.find_all("abc").size() == 4);
+}
+
+TEST_CASE("Searcher mapped file and threads", "[searcher]" ) {
+    fs::path path = fs::temp_directory_path() / "uu_searcher_test.txt";
+    std::string contents;
+    for (int idx = 0; idx < 1000; idx++) {
+        contents += "line " + std::to_string(idx) + " with a long needle to look for in it\n";
+    }
+    write_file(path, contents);
+    MappedFile file(path);
+    REQUIRE(file.is_valid());
+
+    // one searcher shared by every thread
+    const Searcher searcher("with a long needle to look for in it");
+    REQUIRE(searcher.strategy() == Searcher::Strategy::Horspool);
+    std::vector<Size> counts(4);
+    std::vector<std::thread> threads;
+    for (Size t = 0; t < counts.size(); t++) {
+        threads.emplace_back([&searcher, &file, &counts, t] {
+            counts[t] = searcher.find_all(file).size();
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (Size count : counts) {
+        REQUIRE(count == 1000);
+    }
+    REQUIRE(searcher.find(file) == contents.find("with a long needle"));
+}
+
+TEST_CASE("Searcher ignoring case", "[searcher]" ) {
+    REQUIRE(Searcher("Needle", Searcher::Case::Insensitive).strategy() == Searcher::Strategy::FoldedFilter);
+    REQUIRE(Searcher("needle", Searcher::Case::UnicodeInsensitive).strategy() == Searcher::Strategy::FoldedFilter);
+    REQUIRE(Searcher("sun", Searcher::Case::UnicodeInsensitive).strategy() == Searcher::Strategy::Unicode);
+    REQUIRE(Searcher("Öl", Searcher::Case::UnicodeInsensitive).strategy() == Searcher::Strategy::Unicode);
+
+    std::string haystack = "NEEDLE needle NeEdLe ÖL öl the ſun SUN";
+    Searcher ascii("needle", Searcher::Case::Insensitive);
+    REQUIRE(to_vector(ascii.find_all(haystack)) == std::vector<Size>({ 0, 7, 14 }));
+
+    Searcher unicode("öl", Searcher::Case::UnicodeInsensitive);
+    Size length = 0;
+    REQUIRE(unicode.find(haystack, 0, &length) == haystack.find("ÖL"));
+    REQUIRE(length == 3);
+    REQUIRE(unicode.find_all(haystack).size() == 2);
+
+    // matches step by their own length, which here differs from the needle's
+    Searcher sun("sun", Searcher::Case::UnicodeInsensitive);
+    REQUIRE(to_vector(sun.find_all(haystack)) == std::vector<Size>({ haystack.find("ſun"), haystack.find("SUN") }));
+
+    // ASCII case insensitivity leaves everything else exact
+    REQUIRE(Searcher("öl", Searcher::Case::Insensitive).find_all(haystack).size() == 1);
+}
@@ -0,0 +1,130 @@
+//
+// segmented_array_test.cpp
+//
+
+#include <algorithm>
+#include <string>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+namespace {
+
+struct Counted {
+    Counted(int v) : value(v) { live++; }
+    Counted(const Counted &other) : value(other.value) { live++; }
+    ~Counted() { live--; }
+    int value;
+    static inline int live = 0;
+};
+
+}  // namespace
+
+TEST_CASE("SegmentedArray push and index", "[segmented_array]" ) {
+    SegmentedArray<int, 64> a;
+    REQUIRE(a.is_empty());
+
+    const int *first = &a.emplace_back(0);
+    for (int i = 1; i < 1000; i++) {
+        a.push_back(i);
+    }
+    REQUIRE(a.size() == 1000);
+    REQUIRE(a.chunk_count() == 16);
+    REQUIRE(&a[0] == first);
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE(a[i] == i);
+    }
+    REQUIRE(a.front() == 0);
+    REQUIRE(a.back() == 999);
+}
+
+TEST_CASE("SegmentedArray iterate", "[segmented_array]" ) {
+    SegmentedArray<int, 64> a;
+    for (int i = 0; i < 640; i++) {
+        a.push_back(i);
+    }
+
+    int expected = 0;
+    for (int v : a) {
+        REQUIRE(v == expected);
+        expected++;
+    }
+    REQUIRE(expected == 640);
+
+    Size count = 0;
+    Size segments = 0;
+    a.for_each_segment([&](const int *first, Size n) {
+        for (Size idx = 0; idx < n; idx++) {
+            REQUIRE(first[idx] == int(count + idx));
+        }
+        count += n;
+        segments++;
+    });
+    REQUIRE(count == 640);
+    REQUIRE(segments == 10);
+
+    // random access, backwards and with std algorithms
+    auto it = a.end();
+    --it;
+    REQUIRE(*it == 639);
+    it -= 100;
+    REQUIRE(*it == 539);
+    REQUIRE(a.end() - a.begin() == 640);
+    REQUIRE(std::find(a.begin(), a.end(), 300) - a.begin() == 300);
+    std::reverse(a.begin(), a.end());
+    REQUIRE(a[0] == 639);
+    std::sort(a.begin(), a.end());
+    REQUIRE(std::is_sorted(a.begin(), a.end()));
+}
+
+TEST_CASE("SegmentedArray pop and clear", "[segmented_array]" ) {
+    Counted::live = 0;
+    {
+        SegmentedArray<Counted, 16> a;
+        for (int i = 0; i < 100; i++) {
+            a.emplace_back(i);
+        }
+        REQUIRE(Counted::live == 100);
+        REQUIRE(a.chunk_count() == 7);
+
+        while (a.size() > 32) {
+            a.pop_back();
+        }
+        REQUIRE(Counted::live == 32);
+        // one chunk kept in reserve
+        REQUIRE(a.chunk_count() == 3);
+        a.shrink_to_fit();
+        REQUIRE(a.chunk_count() == 2);
+
+        SegmentedArray<Counted, 16> b(a);
+        REQUIRE(Counted::live == 64);
+        REQUIRE(b.back().value == 31);
+
+        SegmentedArray<Counted, 16> c(std::move(b));
+        REQUIRE(b.is_empty());
+        REQUIRE(c.size() == 32);
+        REQUIRE(Counted::live == 64);
+
+        a.clear();
+        REQUIRE(a.chunk_count() == 0);
+        REQUIRE(Counted::live == 32);
+    }
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("SegmentedArray with allocator", "[segmented_array]" ) {
+    using Stats = StatsAllocator<Mallocator>;
+    Stats stats;
+    {
+        SegmentedArray<std::string, 32, AllocatorRef<Stats>> a(stats);
+        for (int i = 0; i < 320; i++) {
+            a.push_back(std::to_string(i));
+        }
+        REQUIRE(a[319] == "319");
+        REQUIRE(stats.snapshot().allocs >= 10);
+    }
+    REQUIRE(stats.snapshot().outstanding_blocks() == 0);
+}
@@ -3,6 +3,7 @@
 //
 
 #include <cstddef>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -124,3 +125,51 @@ TEST_CASE( "line end offsets 4MIX", "[string_like]" ) {
     std::string line = std::string(string_view_for_line(string, line_end_offsets, 6));
     REQUIRE(line == "a longer line");
 }
+
+TEST_CASE( "line end offsets pmr", "[string_like]" ) {
+    std::string string("foo\nbar\rbaz\r\n\r\n\r\na longer line\nthe end");
+    std::pmr::monotonic_buffer_resource resource;
+    std::pmr::vector<Size> line_end_offsets = find_line_end_offsets(string, SizeMax, SizeMax, &resource);
+    REQUIRE(line_end_offsets.get_allocator().resource() == &resource);
+    REQUIRE(line_end_offsets.size() == find_line_end_offsets(string).size());
+    std::string line = std::string(string_view_for_line(string, line_end_offsets, 6));
+    REQUIRE(line == "a longer line");
+}
+
+TEST_CASE( "line end offsets stop at the line holding max_string_index", "[string_like]" ) {
+    std::string string("foo\nbar\rbaz\r\n\r\n\r\na longer line\nthe end");
+    REQUIRE(find_line_end_offsets(string, 0) == std::vector<Size>({ 3 }));
+    REQUIRE(find_line_end_offsets(string, 3) == std::vector<Size>({ 3 }));
+    REQUIRE(find_line_end_offsets(string, 5) == std::vector<Size>({ 3, 7 }));
+    REQUIRE(find_line_end_offsets(string, 12) == std::vector<Size>({ 3, 7, 11, 13 }));
+    REQUIRE(find_line_end_offsets(string, 40) == find_line_end_offsets(string));
+    REQUIRE(find_line_end_offsets(string, string.length() - 1).back() == string.length());
+}
+
+TEST_CASE( "line start offsets", "[string_like]" ) {
+    std::string string("foo\nbar\rbaz\r\n\r\nthe end");
+    std::vector<Size> line_end_offsets = find_line_end_offsets(string);
+    REQUIRE(line_start_offset(string, line_end_offsets, 1) == 0);
+    REQUIRE(line_start_offset(string, line_end_offsets, 2) == 4);
+    REQUIRE(line_start_offset(string, line_end_offsets, 3) == 8);
+    REQUIRE(line_start_offset(string, line_end_offsets, 4) == 13);
+    REQUIRE(line_start_offset(string, line_end_offsets, 5) == 15);
+    REQUIRE(string.substr(15) == "the end");
+}
+
+TEST_CASE( "find_first_of and friends with a ByteSet", "[string_like]" ) {
+    std::string string = std::string(40, 'x') + " \tword\r\n" + std::string(40, 'y') + "\n";
+    std::string_view view(string);
+    ByteSet whitespace(" \t\r\n");
+    for (Size pos : { Size(0), Size(41), Size(60), view.length() - 1, view.length(), view.length() + 5 }) {
+        REQUIRE(find_first_of(view, whitespace, pos) == view.find_first_of(" \t\r\n", pos));
+        REQUIRE(find_first_not_of(view, whitespace, pos) == view.find_first_not_of(" \t\r\n", pos));
+        REQUIRE(find_last_of(view, whitespace, pos) == view.find_last_of(" \t\r\n", pos));
+        REQUIRE(find_last_not_of(view, whitespace, pos) == view.find_last_not_of(" \t\r\n", pos));
+    }
+    REQUIRE(find_first_of(std::string_view(), whitespace) == std::string_view::npos);
+    REQUIRE(find_last_not_of(std::string_view(), whitespace) == std::string_view::npos);
+
+    std::vector<Size> line_end_offsets = find_line_end_offsets(view);
+    REQUIRE(line_end_offsets == std::vector<Size>({ 46, 88, 89 }));
+}
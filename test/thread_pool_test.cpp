@@ -0,0 +1,95 @@
+//
+// thread_pool_test.cpp
+//
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <UU/UU.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace UU;
+
+TEST_CASE("thread pool submit", "[thread_pool]" ) {
+    ThreadPool pool(4);
+    REQUIRE(pool.thread_count() == 4);
+    std::vector<std::future<int>> futures;
+    for (int idx = 0; idx < 100; idx++) {
+        futures.push_back(pool.submit([](int n) { return n * n; }, idx));
+    }
+    for (int idx = 0; idx < 100; idx++) {
+        REQUIRE(futures[idx].get() == idx * idx);
+    }
+}
+
+TEST_CASE("thread pool parallel_for", "[thread_pool]" ) {
+    ThreadPool pool(3);
+    std::vector<int> values(1000, 0);
+    pool.parallel_for(0, values.size(), [&values](Size idx) { values[idx] = idx + 1; }, 7);
+    for (Size idx = 0; idx < values.size(); idx++) {
+        REQUIRE(values[idx] == idx + 1);
+    }
+}
+
+TEST_CASE("thread pool nested parallel_for", "[thread_pool]" ) {
+    ThreadPool pool(2);
+    std::atomic<Size> count = 0;
+    pool.parallel_for(0, 8, [&pool, &count](Size) {
+        pool.parallel_for(0, 100, [&count](Size) { count++; });
+    });
+    REQUIRE(count == 800);
+}
+
+TEST_CASE("thread pool parallel_for exception", "[thread_pool]" ) {
+    ThreadPool pool(2);
+    std::atomic<Size> count = 0;
+    bool caught = false;
+    try {
+        pool.parallel_for(0, 50, [&count](Size idx) {
+            count++;
+            if (idx == 17) {
+                throw std::runtime_error("boom");
+            }
+        });
+    }
+    catch (const std::runtime_error &) {
+        caught = true;
+    }
+    REQUIRE(caught);
+    REQUIRE(count == 50);
+}
+
+TEST_CASE("good concurrency count", "[thread_pool]" ) {
+    int count = get_good_concurrency_count();
+    REQUIRE(count >= 1);
+    REQUIRE(cgroup_cpu_limit_from_quota(200000, 100000) == 2);
+    REQUIRE(cgroup_cpu_limit_from_quota(150000, 100000) == 2);
+    REQUIRE(cgroup_cpu_limit_from_quota(50000, 100000) == 1);
+    REQUIRE(cgroup_cpu_limit_from_quota(-1, 100000) == 0);
+#if OS(LINUX)
+    REQUIRE(count <= get_affinity_cpu_count());
+#endif
+}
+
+TEST_CASE("cgroup path from /proc/self/cgroup", "[thread_pool]" ) {
+    std::string v2 = "0::/system.slice/docker-1234.scope\n";
+    REQUIRE(cgroup_path_for_controller(v2, "") == "/system.slice/docker-1234.scope");
+    REQUIRE(cgroup_path_for_controller(v2, "cpu") == "");
+
+    std::string hybrid = 
+        "12:memory:/user.slice\n"
+        "4:cpu,cpuacct:/user.slice/user-1000.slice/session-2.scope\n"
+        "1:name=systemd:/user.slice/user-1000.slice/session-2.scope\n"
+        "0::/user.slice/user-1000.slice/session-2.scope\n";
+    REQUIRE(cgroup_path_for_controller(hybrid, "cpu") == "/user.slice/user-1000.slice/session-2.scope");
+    REQUIRE(cgroup_path_for_controller(hybrid, "cpuacct") == "/user.slice/user-1000.slice/session-2.scope");
+    REQUIRE(cgroup_path_for_controller(hybrid, "memory") == "/user.slice");
+    REQUIRE(cgroup_path_for_controller(hybrid, "cpuset") == "");
+    REQUIRE(cgroup_path_for_controller(hybrid, "") == "/user.slice/user-1000.slice/session-2.scope");
+
+    REQUIRE(cgroup_path_for_controller("", "") == "");
+    REQUIRE(cgroup_path_for_controller("garbage\n", "") == "");
+}